@@ -0,0 +1,201 @@
+#include "../lib/base.h"
+
+#define BENCH_SCRATCH_SIZE (256 * 1024)
+
+BENCH(heap_alloc_free_64) {
+    BENCH_LOOP {
+        void *ptr = heap_allocator.alloc(&heap_allocator, 64);
+        BENCH_KEEP(ptr);
+        heap_allocator.free(&heap_allocator, ptr);
+    }
+}
+
+BENCH(tracking_alloc_free_64) {
+    TrackingAllocator tracker = tracking_allocator_new("bench", &heap_allocator);
+    BENCH_LOOP {
+        void *ptr = tracker.allocator.alloc(&tracker.allocator, 64);
+        BENCH_KEEP(ptr);
+        tracker.allocator.free(&tracker.allocator, ptr);
+    }
+}
+
+BENCH(tracking_alloc_free_64_site) {
+    TrackingAllocator tracker = tracking_allocator_new("bench", &heap_allocator);
+    BENCH_LOOP {
+        void *ptr = TRACKING_ALLOC(&tracker, 64);
+        BENCH_KEEP(ptr);
+        TRACKING_FREE(&tracker, ptr);
+    }
+}
+
+BENCH(arena_alloc_16) {
+    Arena arena = arena_new(1 << 20, &heap_allocator);
+    BENCH_LOOP {
+        if (arena.offset + 16 > arena.capacity) {
+            arena_reset(&arena);
+        }
+        BENCH_KEEP(arena_alloc(&arena, 16));
+    }
+    arena_free(&arena);
+}
+
+BENCH(arena_alloc_uninit_16) {
+    Arena arena = arena_new(1 << 20, &heap_allocator);
+    BENCH_LOOP {
+        if (arena.offset + 16 > arena.capacity) {
+            arena_reset(&arena);
+        }
+        BENCH_KEEP(arena_alloc_uninit(&arena, 16));
+    }
+    arena_free(&arena);
+}
+
+BENCH(pool_alloc_release_16) {
+    Pool pool = pool_new(16, 1024, &heap_allocator);
+    BENCH_LOOP {
+        void *ptr = pool_alloc_uninit(&pool);
+        BENCH_KEEP(ptr);
+        pool_release(&pool, ptr);
+    }
+    pool_free(&pool);
+}
+
+// Scratch buffers are taken, filled the way a caller would and given back.
+BENCH(heap_scratch_256k_zeroed) {
+    BENCH_SET_BYTES(BENCH_SCRATCH_SIZE);
+    BENCH_LOOP {
+        u8 *buffer = (u8 *)heap_allocator.alloc(&heap_allocator, BENCH_SCRATCH_SIZE);
+        memset(buffer, 0xAB, BENCH_SCRATCH_SIZE);
+        BENCH_KEEP(buffer);
+        heap_allocator.free(&heap_allocator, buffer);
+    }
+}
+
+BENCH(heap_scratch_256k_uninit) {
+    BENCH_SET_BYTES(BENCH_SCRATCH_SIZE);
+    BENCH_LOOP {
+        u8 *buffer = (u8 *)heap_allocator.alloc_uninit(&heap_allocator, BENCH_SCRATCH_SIZE);
+        memset(buffer, 0xAB, BENCH_SCRATCH_SIZE);
+        BENCH_KEEP(buffer);
+        heap_allocator.free(&heap_allocator, buffer);
+    }
+}
+
+BENCH(arena_scratch_256k_zeroed) {
+    Arena arena = arena_new(BENCH_SCRATCH_SIZE * 16, &heap_allocator);
+    BENCH_SET_BYTES(BENCH_SCRATCH_SIZE);
+    BENCH_LOOP {
+        if (arena.offset + BENCH_SCRATCH_SIZE > arena.capacity) {
+            arena_reset(&arena);
+        }
+        u8 *buffer = (u8 *)arena_alloc(&arena, BENCH_SCRATCH_SIZE);
+        memset(buffer, 0xAB, BENCH_SCRATCH_SIZE);
+        BENCH_KEEP(buffer);
+    }
+    arena_free(&arena);
+}
+
+BENCH(arena_scratch_256k_uninit) {
+    Arena arena = arena_new(BENCH_SCRATCH_SIZE * 16, &heap_allocator);
+    BENCH_SET_BYTES(BENCH_SCRATCH_SIZE);
+    BENCH_LOOP {
+        if (arena.offset + BENCH_SCRATCH_SIZE > arena.capacity) {
+            arena_reset(&arena);
+        }
+        u8 *buffer = (u8 *)arena_alloc_uninit(&arena, BENCH_SCRATCH_SIZE);
+        memset(buffer, 0xAB, BENCH_SCRATCH_SIZE);
+        BENCH_KEEP(buffer);
+    }
+    arena_free(&arena);
+}
+
+BENCH(arena_virtual_alloc_uninit_16) {
+    Arena arena = arena_new_virtual(1 << 20, 1 << 20, ARENA_VIRTUAL_DEFAULT);
+    BENCH_LOOP {
+        if (arena.offset + 16 > arena.reserved) {
+            arena_reset(&arena);
+        }
+        BENCH_KEEP(arena_alloc_uninit(&arena, 16));
+    }
+    arena_free(&arena);
+}
+
+// Grows one buffer to 64 MB by doubling, touching each new page like a caller appending.
+#define BENCH_GROW_SIZE (64 << 20)
+
+BENCH(heap_realloc_grow_64m) {
+    BENCH_SET_BYTES(BENCH_GROW_SIZE);
+    BENCH_LOOP {
+        usize size = 4096;
+        u8 *buffer = (u8 *)heap_allocator.alloc_uninit(&heap_allocator, size);
+        while (size < BENCH_GROW_SIZE) {
+            buffer = (u8 *)heap_allocator.realloc(&heap_allocator, buffer, size, size * 2);
+            for (usize i = size; i < size * 2; i += 4096) buffer[i] = 1;
+            size *= 2;
+        }
+        BENCH_KEEP(buffer);
+        heap_allocator.free(&heap_allocator, buffer);
+    }
+}
+
+BENCH(arena_virtual_realloc_grow_64m) {
+    Arena arena = arena_new_virtual((usize)1 << 30, BENCH_GROW_SIZE, ARENA_VIRTUAL_DEFAULT);
+    BENCH_SET_BYTES(BENCH_GROW_SIZE);
+    BENCH_LOOP {
+        usize size = 4096;
+        u8 *buffer = (u8 *)arena_alloc_uninit(&arena, size);
+        while (size < BENCH_GROW_SIZE) {
+            buffer = (u8 *)arena_realloc(&arena, buffer, size, size * 2);
+            for (usize i = size; i < size * 2; i += 4096) buffer[i] = 1;
+            size *= 2;
+        }
+        BENCH_KEEP(buffer);
+        arena_reset(&arena);
+    }
+    arena_free(&arena);
+}
+
+// A request's worth of temporaries: a few differently sized buffers, all dropped at the end.
+#define BENCH_TEMP_ALLOCS 8
+
+BENCH(heap_temp_request) {
+    void *buffers[BENCH_TEMP_ALLOCS];
+    BENCH_LOOP {
+        for (usize i = 0; i < BENCH_TEMP_ALLOCS; i++) {
+            buffers[i] = heap_allocator.alloc_uninit(&heap_allocator, 32 << i);
+            BENCH_KEEP(buffers[i]);
+        }
+        for (usize i = 0; i < BENCH_TEMP_ALLOCS; i++) {
+            heap_allocator.free(&heap_allocator, buffers[i]);
+        }
+    }
+}
+
+BENCH(scratch_temp_request) {
+    BENCH_LOOP {
+        Scratch scratch = scratch_begin(NULL, 0);
+        for (usize i = 0; i < BENCH_TEMP_ALLOCS; i++) {
+            BENCH_KEEP(arena_alloc_uninit(scratch.arena, 32 << i));
+        }
+        scratch_end(scratch);
+    }
+    scratch_free();
+}
+
+void bench_suite_allocators(void) {
+    BENCH_RUN(heap_alloc_free_64);
+    BENCH_RUN(tracking_alloc_free_64);
+    BENCH_RUN(tracking_alloc_free_64_site);
+    BENCH_RUN(arena_alloc_16);
+    BENCH_RUN(arena_alloc_uninit_16);
+    BENCH_RUN(pool_alloc_release_16);
+    BENCH_RUN(heap_scratch_256k_zeroed);
+    BENCH_RUN(heap_scratch_256k_uninit);
+    BENCH_RUN(arena_scratch_256k_zeroed);
+    BENCH_RUN(arena_scratch_256k_uninit);
+    BENCH_RUN(arena_virtual_alloc_uninit_16);
+    BENCH_RUN(heap_realloc_grow_64m);
+    BENCH_RUN(arena_virtual_realloc_grow_64m);
+    BENCH_RUN(heap_temp_request);
+    BENCH_RUN(scratch_temp_request);
+}
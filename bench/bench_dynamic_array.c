@@ -0,0 +1,171 @@
+#include "../lib/base.h"
+
+DYNAMIC_ARRAY_DECLARE(BenchArray, bench_array, u64)
+DYNAMIC_ARRAY_IMPLEMENT(BenchArray, bench_array, u64)
+
+#define bench_u64_less(a, b) ((a) < (b))
+DYNAMIC_ARRAY_SORT_DECLARE(BenchArray, bench_array, u64)
+DYNAMIC_ARRAY_SORT_IMPLEMENT(BenchArray, bench_array, u64, bench_u64_less)
+DYNAMIC_ARRAY_RADIX_SORT_DECLARE(BenchArray, bench_array, u64)
+DYNAMIC_ARRAY_RADIX_SORT_IMPLEMENT(BenchArray, bench_array, u64, sort_key_u64)
+
+#define BENCH_ARRAY_LENGTH (1 << 20)
+#define BENCH_SORT_LENGTH 10000000
+
+BENCH(dynamic_array_push) {
+    BenchArray array = bench_array_new(&heap_allocator);
+    BENCH_LOOP {
+        if (array.length == BENCH_ARRAY_LENGTH) {
+            bench_array_reset(&array);
+        }
+        bench_array_push(&array, array.length);
+    }
+    BENCH_KEEP(array.data[0]);
+    bench_array_free(&array);
+}
+
+// Growing from empty every time, so the reallocations are part of the cost.
+BENCH(dynamic_array_push_grow_1m) {
+    BENCH_SET_ITEMS(BENCH_ARRAY_LENGTH);
+    BENCH_LOOP {
+        BenchArray array = bench_array_new(&heap_allocator);
+        for (u64 i = 0; i < BENCH_ARRAY_LENGTH; i++) {
+            bench_array_push(&array, i);
+        }
+        BENCH_KEEP(array.data);
+        bench_array_free(&array);
+    }
+}
+
+// Appending one large array to a small one: a push loop reallocates log2(n) times on the
+// way up, push_many grows to the needed size in a single realloc.
+BENCH(dynamic_array_append_1m_push) {
+    BenchArray source = bench_array_new(&heap_allocator);
+    bench_array_resize(&source, BENCH_ARRAY_LENGTH);
+    BENCH_SET_ITEMS(BENCH_ARRAY_LENGTH);
+    BENCH_LOOP {
+        BenchArray array = bench_array_new(&heap_allocator);
+        for (usize i = 0; i < source.length; i++) {
+            bench_array_push(&array, source.data[i]);
+        }
+        BENCH_KEEP(array.data);
+        bench_array_free(&array);
+    }
+    bench_array_free(&source);
+}
+
+BENCH(dynamic_array_append_1m_push_many) {
+    BenchArray source = bench_array_new(&heap_allocator);
+    bench_array_resize(&source, BENCH_ARRAY_LENGTH);
+    BENCH_SET_ITEMS(BENCH_ARRAY_LENGTH);
+    BENCH_LOOP {
+        BenchArray array = bench_array_new(&heap_allocator);
+        bench_array_push_many(&array, source.data, source.length);
+        BENCH_KEEP(array.data);
+        bench_array_free(&array);
+    }
+    bench_array_free(&source);
+}
+
+// Many medium appends, where growth still has to be geometric to stay amortized O(1).
+BENCH(dynamic_array_append_1m_chunks_1k) {
+    BenchArray source = bench_array_new(&heap_allocator);
+    bench_array_resize(&source, 1024);
+    BENCH_SET_ITEMS(BENCH_ARRAY_LENGTH);
+    BENCH_LOOP {
+        BenchArray array = bench_array_new(&heap_allocator);
+        for (usize i = 0; i < BENCH_ARRAY_LENGTH / 1024; i++) {
+            bench_array_extend(&array, &source);
+        }
+        BENCH_KEEP(array.data);
+        bench_array_free(&array);
+    }
+    bench_array_free(&source);
+}
+
+// Every iteration sorts a fresh copy of the same random input, the copy is part of the
+// timing for all three so they stay comparable.
+static BenchArray bench_sort_input(void) {
+    BenchArray array = bench_array_new(&heap_allocator);
+    bench_array_resize(&array, BENCH_SORT_LENGTH);
+    u64 state = 1;
+    for (usize i = 0; i < array.length; i++) {
+        // splitmix64
+        u64 z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        array.data[i] = z ^ (z >> 31);
+    }
+    return array;
+}
+
+static int bench_sort_compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+BENCH(sort_qsort_10m) {
+    BenchArray input = bench_sort_input();
+    BenchArray array = bench_array_new(&heap_allocator);
+    bench_array_resize(&array, input.length);
+    BENCH_SET_ITEMS(BENCH_SORT_LENGTH);
+    BENCH_LOOP {
+        memcpy(array.data, input.data, sizeof(u64) * input.length);
+        qsort(array.data, array.length, sizeof(u64), bench_sort_compare_u64);
+        BENCH_KEEP(array.data[0]);
+    }
+    bench_array_free(&array);
+    bench_array_free(&input);
+}
+
+BENCH(sort_introsort_10m) {
+    BenchArray input = bench_sort_input();
+    BenchArray array = bench_array_new(&heap_allocator);
+    bench_array_resize(&array, input.length);
+    BENCH_SET_ITEMS(BENCH_SORT_LENGTH);
+    BENCH_LOOP {
+        memcpy(array.data, input.data, sizeof(u64) * input.length);
+        bench_array_sort(&array);
+        BENCH_KEEP(array.data[0]);
+    }
+    bench_array_free(&array);
+    bench_array_free(&input);
+}
+
+BENCH(sort_radix_10m) {
+    BenchArray input = bench_sort_input();
+    BenchArray array = bench_array_new(&heap_allocator);
+    bench_array_resize(&array, input.length);
+    BENCH_SET_ITEMS(BENCH_SORT_LENGTH);
+    BENCH_LOOP {
+        memcpy(array.data, input.data, sizeof(u64) * input.length);
+        bench_array_radix_sort(&array);
+        BENCH_KEEP(array.data[0]);
+    }
+    bench_array_free(&array);
+    bench_array_free(&input);
+}
+
+BENCH(sort_lower_bound_10m) {
+    BenchArray array = bench_sort_input();
+    bench_array_radix_sort(&array);
+    u64 state = 2;
+    BENCH_LOOP {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        BENCH_KEEP(bench_array_lower_bound(&array, state));
+    }
+    bench_array_free(&array);
+}
+
+void bench_suite_dynamic_array(void) {
+    BENCH_RUN(dynamic_array_push);
+    BENCH_RUN(dynamic_array_push_grow_1m);
+    BENCH_RUN(dynamic_array_append_1m_push);
+    BENCH_RUN(dynamic_array_append_1m_push_many);
+    BENCH_RUN(dynamic_array_append_1m_chunks_1k);
+    BENCH_RUN(sort_qsort_10m);
+    BENCH_RUN(sort_introsort_10m);
+    BENCH_RUN(sort_radix_10m);
+    BENCH_RUN(sort_lower_bound_10m);
+}
@@ -0,0 +1,157 @@
+#include "../lib/base.h"
+
+// A 64 MB log-like file, generated once per run and removed at the end of the suite.
+#define BENCH_FILE_SIZE (64 << 20)
+#define BENCH_FILE_LINE_MAX 256
+
+static char bench_file_path[64];
+static u64 bench_file_lines;
+
+static void bench_file_create(void) {
+    strcpy(bench_file_path, "/tmp/c-toolkit-bench-XXXXXX");
+    int fd = mkstemp(bench_file_path);
+    ASSERT(fd >= 0);
+
+    StringBuilder builder = string_builder_new(BENCH_FILE_SIZE + BENCH_FILE_LINE_MAX, &heap_allocator);
+    u64 state = 1;
+    bench_file_lines = 0;
+    while (builder.length < BENCH_FILE_SIZE) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        string_builder_append_cstr(&builder, "2024-01-01T00:00:00Z INFO request id=");
+        string_builder_append_u64(&builder, state >> 40);
+        string_builder_append_cstr(&builder, " path=/api/v1/items latency_us=");
+        string_builder_append_u64(&builder, (state >> 20) & 0xFFFF);
+        // Lines of varying length, some much longer than the rest.
+        for (u64 i = 0; i < ((state >> 8) & 7); i++) {
+            string_builder_append_cstr(&builder, " tag=value");
+        }
+        string_builder_append_byte(&builder, '\n');
+        bench_file_lines++;
+    }
+    ASSERT(write(fd, builder.buffer, builder.length) == (ssize_t)builder.length);
+    close(fd);
+    string_builder_free(&builder);
+}
+
+BENCH(file_lines_fgets) {
+    char line[BENCH_FILE_LINE_MAX];
+    BENCH_SET_ITEMS(bench_file_lines);
+    BENCH_LOOP {
+        FILE *file = fopen(bench_file_path, "rb");
+        u64 lines = 0;
+        u64 bytes = 0;
+        while (fgets(line, sizeof(line), file) != NULL) {
+            bytes += strlen(line);
+            lines++;
+        }
+        fclose(file);
+        ASSERT(lines == bench_file_lines);
+        BENCH_KEEP(bytes);
+    }
+}
+
+// Reading the whole file into a heap copy first, then splitting without allocating.
+BENCH(file_lines_fread_split) {
+    BENCH_SET_ITEMS(bench_file_lines);
+    BENCH_LOOP {
+        FILE *file = fopen(bench_file_path, "rb");
+        String contents = string_new(BENCH_FILE_SIZE + BENCH_FILE_LINE_MAX, &heap_allocator);
+        contents.length = fread(contents.buffer, 1, contents.length, file);
+        fclose(file);
+
+        StringSplitter lines = string_lines(contents);
+        String line;
+        u64 count = 0;
+        u64 bytes = 0;
+        while (string_split_next(&lines, &line)) {
+            bytes += line.length;
+            count++;
+        }
+        ASSERT(count == bench_file_lines);
+        BENCH_KEEP(bytes);
+        string_free(&contents);
+    }
+}
+
+BENCH(file_lines_map_split) {
+    BENCH_SET_ITEMS(bench_file_lines);
+    BENCH_LOOP {
+        String file;
+        ASSERT(file_map(bench_file_path, FILE_MAP_SEQUENTIAL | FILE_MAP_WILLNEED, &file));
+        StringSplitter lines = string_lines(file);
+        String line;
+        u64 count = 0;
+        u64 bytes = 0;
+        while (string_split_next(&lines, &line)) {
+            bytes += line.length;
+            count++;
+        }
+        ASSERT(count == bench_file_lines);
+        BENCH_KEEP(bytes);
+        file_unmap(&file);
+    }
+}
+
+BENCH(file_lines_reader) {
+    BENCH_SET_ITEMS(bench_file_lines);
+    BENCH_LOOP {
+        int fd = open(bench_file_path, O_RDONLY);
+        Reader reader = reader_new(fd, 0, &heap_allocator);
+        String line;
+        u64 count = 0;
+        u64 bytes = 0;
+        while (reader_read_line(&reader, &line)) {
+            bytes += line.length;
+            count++;
+        }
+        ASSERT(count == bench_file_lines);
+        BENCH_KEEP(bytes);
+        reader_free(&reader);
+        close(fd);
+    }
+}
+
+// Writing 64 MB of short fragments to /dev/null, so the cost is the buffering and the
+// number of system calls rather than the device.
+#define BENCH_WRITE_FRAGMENTS ((64 << 20) / 24)
+
+BENCH(file_write_fwrite) {
+    const char *fragment = "key=value count=123456\n";
+    usize length = strlen(fragment);
+    BENCH_SET_ITEMS(BENCH_WRITE_FRAGMENTS);
+    BENCH_LOOP {
+        FILE *file = fopen("/dev/null", "wb");
+        for (u64 i = 0; i < BENCH_WRITE_FRAGMENTS; i++) {
+            fwrite(fragment, 1, length, file);
+        }
+        fclose(file);
+    }
+}
+
+BENCH(file_write_writer) {
+    String fragment = string("key=value count=123456\n", &heap_allocator);
+    BENCH_SET_ITEMS(BENCH_WRITE_FRAGMENTS);
+    BENCH_LOOP {
+        int fd = open("/dev/null", O_WRONLY);
+        Writer writer = writer_new(fd, 0, &heap_allocator);
+        for (u64 i = 0; i < BENCH_WRITE_FRAGMENTS; i++) {
+            writer_write(&writer, fragment);
+        }
+        ASSERT(writer_free(&writer));
+        close(fd);
+    }
+    string_free(&fragment);
+}
+
+void bench_suite_files(void) {
+    bench_file_create();
+
+    BENCH_RUN(file_lines_fgets);
+    BENCH_RUN(file_lines_fread_split);
+    BENCH_RUN(file_lines_map_split);
+    BENCH_RUN(file_lines_reader);
+    BENCH_RUN(file_write_fwrite);
+    BENCH_RUN(file_write_writer);
+
+    unlink(bench_file_path);
+}
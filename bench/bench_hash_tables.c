@@ -0,0 +1,447 @@
+#include "../lib/base.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+HASH_TABLE_DECLARE(BenchChainedTable, bench_chained_table, u64, u64)
+HASH_TABLE_IMPLEMENT(BenchChainedTable, bench_chained_table, u64, u64)
+
+HASH_TABLE_DECLARE_INLINE(BenchInlineTable, bench_inline_table, u64, u64)
+HASH_TABLE_IMPLEMENT_INLINE(BenchInlineTable, bench_inline_table, u64, u64, integer_hash, integer_eq)
+
+FLAT_HASH_TABLE_DECLARE(BenchFlatTable, bench_flat_table, u64, u64)
+FLAT_HASH_TABLE_IMPLEMENT(BenchFlatTable, bench_flat_table, u64, u64)
+
+HASH_SET_DECLARE(BenchSet, bench_set, u64)
+HASH_SET_IMPLEMENT(BenchSet, bench_set, u64)
+
+CONCURRENT_HASH_TABLE_DECLARE(BenchConcurrentTable, bench_concurrent_table, u64, u64)
+CONCURRENT_HASH_TABLE_IMPLEMENT(BenchConcurrentTable, bench_concurrent_table, u64, u64)
+
+#define BENCH_HASH_TABLE_KEYS (1 << 20)
+#define BENCH_HASH_TABLE_LIVE (BENCH_HASH_TABLE_KEYS / 16)
+#define BENCH_HASH_TABLE_SMALL_KEYS 1024
+#define BENCH_HASH_SET_KEYS 10000000
+
+static u64 *bench_keys;
+static u64 *bench_missing_keys;
+static BenchChainedTable bench_loaded_chained_table;
+static BenchInlineTable bench_loaded_inline_table;
+static BenchFlatTable bench_loaded_flat_table;
+static BenchConcurrentTable bench_loaded_concurrent_table;
+static BenchChainedTable bench_small_chained_table;
+static BenchInlineTable bench_small_inline_table;
+
+static u64 bench_random_u64(u64 *state) {
+    // splitmix64
+    u64 z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static u64 *bench_random_keys(usize count, u64 seed) {
+    u64 *keys = (u64 *)heap_allocator.alloc_uninit(&heap_allocator, sizeof(u64) * count);
+    for (usize i = 0; i < count; i++) {
+        keys[i] = bench_random_u64(&seed);
+    }
+    return keys;
+}
+
+BENCH(chained_table_set_1m) {
+    BENCH_SET_ITEMS(BENCH_HASH_TABLE_KEYS);
+    BENCH_LOOP {
+        BenchChainedTable table = bench_chained_table_new(integer_hash, integer_eq, &heap_allocator);
+        for (usize i = 0; i < BENCH_HASH_TABLE_KEYS; i++) {
+            bench_chained_table_set(&table, bench_keys[i], i);
+        }
+        bench_chained_table_free(&table);
+    }
+}
+
+BENCH(chained_table_set_1m_reserved) {
+    BENCH_SET_ITEMS(BENCH_HASH_TABLE_KEYS);
+    BENCH_LOOP {
+        BenchChainedTable table = bench_chained_table_with_capacity(
+            integer_hash, integer_eq, BENCH_HASH_TABLE_KEYS, &heap_allocator);
+        for (usize i = 0; i < BENCH_HASH_TABLE_KEYS; i++) {
+            bench_chained_table_set(&table, bench_keys[i], i);
+        }
+        bench_chained_table_free(&table);
+    }
+}
+
+BENCH(chained_table_set_many_1m_reserved) {
+    BENCH_SET_ITEMS(BENCH_HASH_TABLE_KEYS);
+    BENCH_LOOP {
+        BenchChainedTable table = bench_chained_table_with_capacity(
+            integer_hash, integer_eq, BENCH_HASH_TABLE_KEYS, &heap_allocator);
+        bench_chained_table_set_many(&table, bench_keys, bench_keys, BENCH_HASH_TABLE_KEYS);
+        bench_chained_table_free(&table);
+    }
+}
+
+BENCH(chained_table_get_hit_1m) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_keys[i++ & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_chained_table_get(&bench_loaded_chained_table, key));
+    }
+}
+
+BENCH(chained_table_get_many_hit_1m) {
+    u64 values[64];
+    usize i = 0;
+    BENCH_SET_ITEMS(64);
+    BENCH_LOOP {
+        const u64 *keys = &bench_keys[i & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_chained_table_get_many(&bench_loaded_chained_table, keys, values, NULL, 64));
+        i += 64;
+    }
+}
+
+BENCH(chained_table_get_miss_1m) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_missing_keys[i++ & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_chained_table_contains(&bench_loaded_chained_table, key));
+    }
+}
+
+BENCH(inline_table_get_hit_1m) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_keys[i++ & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_inline_table_get(&bench_loaded_inline_table, key));
+    }
+}
+
+// Small enough to stay in cache, so the indirect calls are a bigger share of the cost.
+BENCH(chained_table_get_hit_1k) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_keys[i++ & (BENCH_HASH_TABLE_SMALL_KEYS - 1)];
+        BENCH_KEEP(bench_chained_table_get(&bench_small_chained_table, key));
+    }
+}
+
+BENCH(inline_table_get_hit_1k) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_keys[i++ & (BENCH_HASH_TABLE_SMALL_KEYS - 1)];
+        BENCH_KEEP(bench_inline_table_get(&bench_small_inline_table, key));
+    }
+}
+
+BENCH(flat_table_set_1m) {
+    BENCH_SET_ITEMS(BENCH_HASH_TABLE_KEYS);
+    BENCH_LOOP {
+        BenchFlatTable table = bench_flat_table_new(integer_hash, integer_eq, &heap_allocator);
+        for (usize i = 0; i < BENCH_HASH_TABLE_KEYS; i++) {
+            bench_flat_table_set(&table, bench_keys[i], i);
+        }
+        bench_flat_table_free(&table);
+    }
+}
+
+BENCH(flat_table_get_hit_1m) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_keys[i++ & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_flat_table_get(&bench_loaded_flat_table, key));
+    }
+}
+
+BENCH(flat_table_get_many_hit_1m) {
+    u64 values[64];
+    usize i = 0;
+    BENCH_SET_ITEMS(64);
+    BENCH_LOOP {
+        const u64 *keys = &bench_keys[i & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_flat_table_get_many(&bench_loaded_flat_table, keys, values, NULL, 64));
+        i += 64;
+    }
+}
+
+BENCH(flat_table_get_miss_1m) {
+    usize i = 0;
+    BENCH_LOOP {
+        u64 key = bench_missing_keys[i++ & (BENCH_HASH_TABLE_KEYS - 1)];
+        BENCH_KEEP(bench_flat_table_contains(&bench_loaded_flat_table, key));
+    }
+}
+
+// Membership at 10M keys, well past the last-level cache. The set and the flat table probe
+// the same way, so the gap between them is the values the table drags along.
+static u64 *bench_set_keys;
+static u64 *bench_set_missing_keys;
+
+static BenchSet bench_set_loaded(usize count) {
+    BenchSet set = bench_set_new(integer_hash, integer_eq, &heap_allocator);
+    bench_set_reserve(&set, count);
+    for (usize i = 0; i < count; i++) {
+        bench_set_insert(&set, bench_set_keys[i]);
+    }
+    return set;
+}
+
+BENCH(hash_set_insert_10m) {
+    BENCH_SET_ITEMS(BENCH_HASH_SET_KEYS);
+    BENCH_LOOP {
+        BenchSet set = bench_set_new(integer_hash, integer_eq, &heap_allocator);
+        for (usize i = 0; i < BENCH_HASH_SET_KEYS; i++) {
+            bench_set_insert(&set, bench_set_keys[i]);
+        }
+        BENCH_KEEP(set.size);
+        bench_set_free(&set);
+    }
+}
+
+static void bench_hash_set_contains_10m(Bench *_bench, const u64 *keys) {
+    BenchSet set = bench_set_loaded(BENCH_HASH_SET_KEYS);
+    usize i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(bench_set_contains(&set, keys[i]));
+        if (++i == BENCH_HASH_SET_KEYS) i = 0;
+    }
+    bench_set_free(&set);
+}
+
+static void bench_flat_table_contains_10m(Bench *_bench, const u64 *keys) {
+    BenchFlatTable table = bench_flat_table_new(integer_hash, integer_eq, &heap_allocator);
+    for (usize i = 0; i < BENCH_HASH_SET_KEYS; i++) {
+        bench_flat_table_set(&table, bench_set_keys[i], i);
+    }
+    usize i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(bench_flat_table_contains(&table, keys[i]));
+        if (++i == BENCH_HASH_SET_KEYS) i = 0;
+    }
+    bench_flat_table_free(&table);
+}
+
+BENCH(hash_set_contains_hit_10m) { bench_hash_set_contains_10m(_bench, bench_set_keys); }
+BENCH(hash_set_contains_miss_10m) { bench_hash_set_contains_10m(_bench, bench_set_missing_keys); }
+BENCH(flat_table_contains_hit_10m) { bench_flat_table_contains_10m(_bench, bench_set_keys); }
+BENCH(flat_table_contains_miss_10m) { bench_flat_table_contains_10m(_bench, bench_set_missing_keys); }
+
+// Bulk algebra between the 10M set and one a tenth the size. Each op leaves the sets as it
+// found them so the loop never has to rebuild 10M keys: the union adds disjoint keys that
+// the difference then takes back out, and the intersection keeps all of the small side.
+BENCH(hash_set_union_difference_10m) {
+    BenchSet set = bench_set_loaded(BENCH_HASH_SET_KEYS);
+    BenchSet other = bench_set_new(integer_hash, integer_eq, &heap_allocator);
+    for (usize i = 0; i < BENCH_HASH_SET_KEYS / 10; i++) {
+        bench_set_insert(&other, bench_set_missing_keys[i]);
+    }
+    BENCH_SET_ITEMS(BENCH_HASH_SET_KEYS / 10 * 2);
+    BENCH_LOOP {
+        bench_set_union(&set, &other);
+        bench_set_difference(&set, &other);
+        BENCH_KEEP(set.size);
+    }
+    bench_set_free(&other);
+    bench_set_free(&set);
+}
+
+BENCH(hash_set_intersect_10m) {
+    BenchSet set = bench_set_loaded(BENCH_HASH_SET_KEYS);
+    BenchSet small = bench_set_loaded(BENCH_HASH_SET_KEYS / 10);
+    BENCH_SET_ITEMS(BENCH_HASH_SET_KEYS / 10);
+    BENCH_LOOP {
+        bench_set_intersect(&small, &set);
+        BENCH_KEEP(small.size);
+    }
+    bench_set_free(&small);
+    bench_set_free(&set);
+}
+
+// Keeps a window of live keys sliding over the key set, so every step frees one entry
+// and allocates another.
+// Per-insert latency while growing from empty, the full rehash shows up in the tail.
+static void bench_chained_table_insert_latency(BenchLatency *_latency, bool incremental) {
+    BenchInlineTable table = bench_inline_table_new(&heap_allocator);
+    bench_inline_table_set_incremental(&table, incremental);
+    for (usize i = 0; i < BENCH_HASH_TABLE_KEYS; i++) {
+        BENCH_SAMPLE {
+            bench_inline_table_set(&table, bench_keys[i], i);
+        }
+    }
+    bench_inline_table_free(&table);
+}
+
+BENCH_LATENCY(inline_table_insert_latency_1m) {
+    bench_chained_table_insert_latency(_latency, false);
+}
+
+BENCH_LATENCY(inline_table_insert_latency_incremental_1m) {
+    bench_chained_table_insert_latency(_latency, true);
+}
+
+// Each op starts the threads, which then share BENCH_CONCURRENT_OPS lookups per thread
+// (a tenth of them writes for the mixed runs) against the loaded 1M key table.
+#define BENCH_CONCURRENT_OPS (1 << 16)
+
+typedef struct {
+    u64 seed;
+    u32 write_percent;
+} BenchConcurrentWorker;
+
+static void *bench_concurrent_worker(void *argument) {
+    BenchConcurrentWorker *worker = (BenchConcurrentWorker *)argument;
+    u64 state = worker->seed;
+    u64 sum = 0;
+    for (usize i = 0; i < BENCH_CONCURRENT_OPS; i++) {
+        u64 random = bench_random_u64(&state);
+        u64 key = bench_keys[random & (BENCH_HASH_TABLE_KEYS - 1)];
+        if ((random >> 32) % 100 < worker->write_percent) {
+            bench_concurrent_table_set(&bench_loaded_concurrent_table, key, i);
+        } else {
+            u64 value = 0;
+            bench_concurrent_table_try_get(&bench_loaded_concurrent_table, key, &value);
+            sum += value;
+        }
+    }
+    BENCH_KEEP(sum);
+    return NULL;
+}
+
+static void bench_concurrent_table(Bench *_bench, u32 thread_count, u32 write_percent) {
+    pthread_t threads[16];
+    BenchConcurrentWorker workers[16];
+    ASSERT(thread_count <= 16);
+
+    BENCH_SET_ITEMS((u64)thread_count * BENCH_CONCURRENT_OPS);
+    u64 seed = 0;
+    BENCH_LOOP {
+        for (u32 i = 0; i < thread_count; i++) {
+            workers[i] = (BenchConcurrentWorker){ .seed = ++seed, .write_percent = write_percent };
+            pthread_create(&threads[i], NULL, bench_concurrent_worker, &workers[i]);
+        }
+        for (u32 i = 0; i < thread_count; i++) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+#define BENCH_CONCURRENT(threads) \
+    BENCH(concurrent_table_read_##threads##_threads) { \
+        bench_concurrent_table(_bench, threads, 0); \
+    } \
+    BENCH(concurrent_table_mixed_##threads##_threads) { \
+        bench_concurrent_table(_bench, threads, 10); \
+    }
+
+BENCH_CONCURRENT(1)
+BENCH_CONCURRENT(2)
+BENCH_CONCURRENT(4)
+BENCH_CONCURRENT(8)
+BENCH_CONCURRENT(16)
+
+static void bench_chained_table_churn(Bench *_bench, Allocator *allocator) {
+    BenchChainedTable table = bench_chained_table_new(integer_hash, integer_eq, allocator);
+    for (usize i = 0; i < BENCH_HASH_TABLE_LIVE; i++) {
+        bench_chained_table_set(&table, bench_keys[i], i);
+    }
+    usize i = 0;
+    BENCH_LOOP {
+        bench_chained_table_remove(&table, bench_keys[i & (BENCH_HASH_TABLE_KEYS - 1)]);
+        bench_chained_table_set(&table, bench_keys[(i + BENCH_HASH_TABLE_LIVE) & (BENCH_HASH_TABLE_KEYS - 1)], i);
+        i++;
+    }
+    ASSERT(table.size == BENCH_HASH_TABLE_LIVE);
+    bench_chained_table_free(&table);
+}
+
+BENCH(chained_table_churn_heap) {
+    bench_chained_table_churn(_bench, &heap_allocator);
+}
+
+BENCH(chained_table_churn_arena) {
+    Arena arena = arena_new_growable(1 << 20, 64 << 20, ARENA_RESET_RELEASE, &heap_allocator);
+    bench_chained_table_churn(_bench, &arena.allocator);
+    arena_free(&arena);
+}
+
+BENCH(chained_table_churn_pool) {
+    Pool pool = pool_new(sizeof(BenchChainedTableEntry), 4096, &heap_allocator);
+    bench_chained_table_churn(_bench, &pool.allocator);
+    pool_free(&pool);
+}
+
+void bench_suite_hash_table(void) {
+    bench_keys = bench_random_keys(BENCH_HASH_TABLE_KEYS, 1);
+    bench_missing_keys = bench_random_keys(BENCH_HASH_TABLE_KEYS, 2);
+
+    bench_loaded_chained_table = bench_chained_table_new(integer_hash, integer_eq, &heap_allocator);
+    bench_loaded_inline_table = bench_inline_table_new(&heap_allocator);
+    bench_loaded_flat_table = bench_flat_table_new(integer_hash, integer_eq, &heap_allocator);
+    bench_loaded_concurrent_table = bench_concurrent_table_new(
+        integer_hash, integer_eq, &heap_allocator);
+    for (usize i = 0; i < BENCH_HASH_TABLE_KEYS; i++) {
+        bench_chained_table_set(&bench_loaded_chained_table, bench_keys[i], i);
+        bench_inline_table_set(&bench_loaded_inline_table, bench_keys[i], i);
+        bench_flat_table_set(&bench_loaded_flat_table, bench_keys[i], i);
+        bench_concurrent_table_set(&bench_loaded_concurrent_table, bench_keys[i], i);
+    }
+    bench_small_chained_table = bench_chained_table_new(integer_hash, integer_eq, &heap_allocator);
+    bench_small_inline_table = bench_inline_table_new(&heap_allocator);
+    for (usize i = 0; i < BENCH_HASH_TABLE_SMALL_KEYS; i++) {
+        bench_chained_table_set(&bench_small_chained_table, bench_keys[i], i);
+        bench_inline_table_set(&bench_small_inline_table, bench_keys[i], i);
+    }
+
+    BENCH_RUN(chained_table_set_1m);
+    BENCH_RUN(chained_table_set_1m_reserved);
+    BENCH_RUN(chained_table_set_many_1m_reserved);
+    BENCH_RUN(chained_table_get_hit_1m);
+    BENCH_RUN(chained_table_get_many_hit_1m);
+    BENCH_RUN(chained_table_get_miss_1m);
+    BENCH_RUN(inline_table_get_hit_1m);
+    BENCH_RUN(chained_table_get_hit_1k);
+    BENCH_RUN(inline_table_get_hit_1k);
+    BENCH_RUN_LATENCY(inline_table_insert_latency_1m);
+    BENCH_RUN_LATENCY(inline_table_insert_latency_incremental_1m);
+    BENCH_RUN(flat_table_set_1m);
+    BENCH_RUN(flat_table_get_hit_1m);
+    BENCH_RUN(flat_table_get_many_hit_1m);
+    BENCH_RUN(flat_table_get_miss_1m);
+
+    bench_set_keys = bench_random_keys(BENCH_HASH_SET_KEYS, 3);
+    bench_set_missing_keys = bench_random_keys(BENCH_HASH_SET_KEYS, 4);
+    BENCH_RUN(hash_set_insert_10m);
+    BENCH_RUN(hash_set_contains_hit_10m);
+    BENCH_RUN(hash_set_contains_miss_10m);
+    BENCH_RUN(flat_table_contains_hit_10m);
+    BENCH_RUN(flat_table_contains_miss_10m);
+    BENCH_RUN(hash_set_union_difference_10m);
+    BENCH_RUN(hash_set_intersect_10m);
+    heap_allocator.free(&heap_allocator, bench_set_keys);
+    heap_allocator.free(&heap_allocator, bench_set_missing_keys);
+
+    // Thread counts past the number of cores only measure the scheduler.
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    BENCH_RUN(concurrent_table_read_1_threads);
+    BENCH_RUN(concurrent_table_mixed_1_threads);
+    if (cores >= 2) BENCH_RUN(concurrent_table_read_2_threads);
+    if (cores >= 2) BENCH_RUN(concurrent_table_mixed_2_threads);
+    if (cores >= 4) BENCH_RUN(concurrent_table_read_4_threads);
+    if (cores >= 4) BENCH_RUN(concurrent_table_mixed_4_threads);
+    if (cores >= 8) BENCH_RUN(concurrent_table_read_8_threads);
+    if (cores >= 8) BENCH_RUN(concurrent_table_mixed_8_threads);
+    if (cores >= 16) BENCH_RUN(concurrent_table_read_16_threads);
+    if (cores >= 16) BENCH_RUN(concurrent_table_mixed_16_threads);
+
+    BENCH_RUN(chained_table_churn_heap);
+    BENCH_RUN(chained_table_churn_arena);
+    BENCH_RUN(chained_table_churn_pool);
+
+    bench_chained_table_free(&bench_loaded_chained_table);
+    bench_inline_table_free(&bench_loaded_inline_table);
+    bench_flat_table_free(&bench_loaded_flat_table);
+    bench_concurrent_table_free(&bench_loaded_concurrent_table);
+    bench_chained_table_free(&bench_small_chained_table);
+    bench_inline_table_free(&bench_small_inline_table);
+    heap_allocator.free(&heap_allocator, bench_keys);
+    heap_allocator.free(&heap_allocator, bench_missing_keys);
+}
@@ -0,0 +1,24 @@
+#define BENCH_ENABLED
+
+#include "bench_allocators.c"
+#include "bench_string.c"
+#include "bench_files.c"
+#include "bench_dynamic_array.c"
+#include "bench_hash_tables.c"
+#include "bench_threads.c"
+
+#define BASE_IMPLEMENTATION
+#include "../lib/base.h"
+
+int main(int argc, char **argv) {
+    bench_init(argc, argv);
+
+    bench_suite_allocators();
+    bench_suite_string();
+    bench_suite_files();
+    bench_suite_dynamic_array();
+    bench_suite_hash_table();
+    bench_suite_threads();
+
+    return BENCH_RESULTS();
+}
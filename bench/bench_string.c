@@ -0,0 +1,501 @@
+#include "../lib/base.h"
+
+FLAT_HASH_TABLE_DECLARE(BenchNameTable, bench_name_table, const char *, u64)
+FLAT_HASH_TABLE_IMPLEMENT(BenchNameTable, bench_name_table, const char *, u64)
+
+FLAT_HASH_TABLE_DECLARE(BenchIdTable, bench_id_table, u64, u64)
+FLAT_HASH_TABLE_IMPLEMENT(BenchIdTable, bench_id_table, u64, u64)
+
+static String bench_string_filled(usize length) {
+    String str = string_new(length, &heap_allocator);
+    for (usize i = 0; i < length; i++) {
+        str.buffer[i] = (u8)('a' + i % 26);
+    }
+    return str;
+}
+
+// The byte-at-a-time FNV-1a that string_hash used to be, for comparison.
+static u64 bench_fnv1a_hash(String str) {
+    u64 hash = 14695981039346656037ULL;
+    for (usize i = 0; i < str.length; i++) {
+        hash ^= str.buffer[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void bench_string_hash(Bench *_bench, usize length, u64 (*hash)(String)) {
+    String str = bench_string_filled(length);
+    BENCH_SET_BYTES(str.length);
+    BENCH_LOOP {
+        BENCH_CLOBBER();
+        BENCH_KEEP(hash(str));
+    }
+    string_free(&str);
+}
+
+#define BENCH_STRING_HASH(length) \
+    BENCH(string_hash_##length) { bench_string_hash(_bench, length, string_hash); } \
+    BENCH(fnv1a_hash_##length) { bench_string_hash(_bench, length, bench_fnv1a_hash); }
+
+BENCH_STRING_HASH(4)
+BENCH_STRING_HASH(8)
+BENCH_STRING_HASH(16)
+BENCH_STRING_HASH(32)
+BENCH_STRING_HASH(64)
+BENCH_STRING_HASH(256)
+BENCH_STRING_HASH(1024)
+BENCH_STRING_HASH(4096)
+
+BENCH(string_eq_64) {
+    String a = bench_string_filled(64);
+    String b = bench_string_filled(64);
+    BENCH_SET_BYTES(a.length);
+    BENCH_LOOP {
+        BENCH_CLOBBER();
+        BENCH_KEEP(string_eq(a, b));
+    }
+    string_free(&a);
+    string_free(&b);
+}
+
+BENCH(string_concat_arena) {
+    Arena arena = arena_new(1 << 20, &heap_allocator);
+    String a = string("Hello, ", &heap_allocator);
+    String b = string("world!", &heap_allocator);
+    BENCH_LOOP {
+        if (arena.offset + a.length + b.length > arena.capacity) {
+            arena_reset(&arena);
+        }
+        BENCH_KEEP(string_concat(a, b, &arena.allocator));
+    }
+    string_free(&a);
+    string_free(&b);
+    arena_free(&arena);
+}
+
+// Building an output from small fragments. concat copies everything built so far on each
+// call, so it only gets the 64 KB size, the builder appends in amortized O(1).
+#define BENCH_FRAGMENT "0123456789abcdef"
+#define BENCH_FRAGMENT_LENGTH 16
+
+static void bench_concat_build(Bench *_bench, usize size) {
+    String fragment = string(BENCH_FRAGMENT, &heap_allocator);
+    BENCH_SET_BYTES(size);
+    BENCH_LOOP {
+        String str = string_new(0, &heap_allocator);
+        for (usize length = 0; length < size; length += fragment.length) {
+            String next = string_concat(str, fragment, &heap_allocator);
+            heap_allocator.free(&heap_allocator, str.buffer);
+            str = next;
+        }
+        BENCH_KEEP(str.buffer);
+        string_free(&str);
+    }
+    string_free(&fragment);
+}
+
+static void bench_builder_build(Bench *_bench, usize size) {
+    String fragment = string(BENCH_FRAGMENT, &heap_allocator);
+    BENCH_SET_BYTES(size);
+    BENCH_LOOP {
+        StringBuilder builder = string_builder_new(0, &heap_allocator);
+        for (usize length = 0; length < size; length += fragment.length) {
+            string_builder_append(&builder, fragment);
+        }
+        String str = string_builder_finish(&builder);
+        BENCH_KEEP(str.buffer);
+        string_free(&str);
+    }
+    string_free(&fragment);
+}
+
+BENCH(string_concat_build_64k) { bench_concat_build(_bench, 64 << 10); }
+BENCH(string_builder_build_64k) { bench_builder_build(_bench, 64 << 10); }
+BENCH(string_builder_build_1m) { bench_builder_build(_bench, 1 << 20); }
+
+// A 1 MB line-oriented report: numbers and short labels, the typical log or CSV output.
+#define BENCH_REPORT_LINES ((1 << 20) / 32)
+
+BENCH(string_builder_report_1m) {
+    BENCH_SET_ITEMS(BENCH_REPORT_LINES);
+    BENCH_LOOP {
+        StringBuilder builder = string_builder_new(0, &heap_allocator);
+        for (u64 i = 0; i < BENCH_REPORT_LINES; i++) {
+            string_builder_append_cstr(&builder, "id=");
+            string_builder_append_u64(&builder, i * 7919);
+            string_builder_append_cstr(&builder, " v=");
+            string_builder_append_f64(&builder, (f64)i * 0.125, 3);
+            string_builder_append_byte(&builder, '\n');
+        }
+        String str = string_builder_finish(&builder);
+        BENCH_KEEP(str.buffer);
+        string_free(&str);
+    }
+}
+
+BENCH(string_builder_report_appendf_1m) {
+    BENCH_SET_ITEMS(BENCH_REPORT_LINES);
+    BENCH_LOOP {
+        StringBuilder builder = string_builder_new(0, &heap_allocator);
+        for (u64 i = 0; i < BENCH_REPORT_LINES; i++) {
+            string_builder_appendf(&builder, "id=%llu v=%.3f\n",
+                                   (unsigned long long)(i * 7919), (f64)i * 0.125);
+        }
+        String str = string_builder_finish(&builder);
+        BENCH_KEEP(str.buffer);
+        string_free(&str);
+    }
+}
+
+// Number texts as a parser meets them: terminated copies for the C library, and views of
+// the same bytes for the String parsers.
+#define BENCH_NUMBERS 4096
+
+typedef struct {
+    char *texts[BENCH_NUMBERS];
+    String views[BENCH_NUMBERS];
+    u64 integers[BENCH_NUMBERS];
+    f64 doubles[BENCH_NUMBERS];
+} BenchNumbers;
+
+static BenchNumbers *bench_numbers_new(bool floats) {
+    BenchNumbers *numbers = (BenchNumbers *)heap_allocator.alloc(&heap_allocator, sizeof(BenchNumbers));
+    u64 state = 1;
+    for (u32 i = 0; i < BENCH_NUMBERS; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        numbers->integers[i] = state >> (state % 64);
+        // Half full-precision doubles, half short decimals like prices and measurements.
+        u64 bits = (state >> 12) | 0x3FF0000000000000ULL;
+        memcpy(&numbers->doubles[i], &bits, sizeof(f64));
+        numbers->doubles[i] *= (f64)(state % 1000000);
+        char *text = (char *)heap_allocator.alloc(&heap_allocator, 32);
+        if (!floats) {
+            snprintf(text, 32, "%llu", (unsigned long long)numbers->integers[i]);
+        } else if (i % 2 == 0) {
+            snprintf(text, 32, "%.17g", numbers->doubles[i]);
+        } else {
+            snprintf(text, 32, "%llu.%02llu", (unsigned long long)(state % 100000),
+                     (unsigned long long)(state >> 40) % 100);
+        }
+        numbers->texts[i] = text;
+        numbers->views[i].buffer = (u8 *)text;
+        numbers->views[i].length = strlen(text);
+    }
+    return numbers;
+}
+
+static void bench_numbers_free(BenchNumbers *numbers) {
+    for (u32 i = 0; i < BENCH_NUMBERS; i++) {
+        heap_allocator.free(&heap_allocator, numbers->texts[i]);
+    }
+    heap_allocator.free(&heap_allocator, numbers);
+}
+
+BENCH(string_parse_u64_4k) {
+    BenchNumbers *numbers = bench_numbers_new(false);
+    u32 i = 0;
+    BENCH_LOOP {
+        u64 value = 0;
+        string_parse_u64(numbers->views[i++ & (BENCH_NUMBERS - 1)], &value);
+        BENCH_KEEP(value);
+    }
+    bench_numbers_free(numbers);
+}
+
+BENCH(strtoull_4k) {
+    BenchNumbers *numbers = bench_numbers_new(false);
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(strtoull(numbers->texts[i++ & (BENCH_NUMBERS - 1)], NULL, 10));
+    }
+    bench_numbers_free(numbers);
+}
+
+BENCH(string_parse_f64_4k) {
+    BenchNumbers *numbers = bench_numbers_new(true);
+    u32 i = 0;
+    BENCH_LOOP {
+        f64 value = 0;
+        string_parse_f64(numbers->views[i++ & (BENCH_NUMBERS - 1)], &value);
+        BENCH_KEEP(value);
+    }
+    bench_numbers_free(numbers);
+}
+
+BENCH(strtod_4k) {
+    BenchNumbers *numbers = bench_numbers_new(true);
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(strtod(numbers->texts[i++ & (BENCH_NUMBERS - 1)], NULL));
+    }
+    bench_numbers_free(numbers);
+}
+
+BENCH(format_u64_4k) {
+    BenchNumbers *numbers = bench_numbers_new(false);
+    char buffer[NUMBER_FORMAT_MAX];
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(format_u64(buffer, numbers->integers[i++ & (BENCH_NUMBERS - 1)]));
+        BENCH_CLOBBER();
+    }
+    bench_numbers_free(numbers);
+}
+
+BENCH(snprintf_u64_4k) {
+    BenchNumbers *numbers = bench_numbers_new(false);
+    char buffer[NUMBER_FORMAT_MAX];
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(snprintf(buffer, sizeof(buffer), "%llu",
+                            (unsigned long long)numbers->integers[i++ & (BENCH_NUMBERS - 1)]));
+        BENCH_CLOBBER();
+    }
+    bench_numbers_free(numbers);
+}
+
+BENCH(format_f64_4k) {
+    BenchNumbers *numbers = bench_numbers_new(true);
+    char buffer[NUMBER_FORMAT_MAX];
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(format_f64(buffer, numbers->doubles[i++ & (BENCH_NUMBERS - 1)]));
+        BENCH_CLOBBER();
+    }
+    bench_numbers_free(numbers);
+}
+
+// %.17g is what it takes to round-trip with printf; it is not the shortest form.
+BENCH(snprintf_f64_4k) {
+    BenchNumbers *numbers = bench_numbers_new(true);
+    char buffer[NUMBER_FORMAT_MAX];
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(snprintf(buffer, sizeof(buffer), "%.17g", numbers->doubles[i++ & (BENCH_NUMBERS - 1)]));
+        BENCH_CLOBBER();
+    }
+    bench_numbers_free(numbers);
+}
+
+// Identifier-like names, the interner's typical input.
+#define BENCH_NAMES (1 << 16)
+
+static char **bench_names_new(void) {
+    char **names = (char **)heap_allocator.alloc(&heap_allocator, sizeof(char *) * BENCH_NAMES);
+    for (u32 i = 0; i < BENCH_NAMES; i++) {
+        names[i] = (char *)heap_allocator.alloc(&heap_allocator, 32);
+        snprintf(names[i], 32, "identifier_%u", (i * 2654435761u) % 1000003);
+    }
+    return names;
+}
+
+static void bench_names_free(char **names) {
+    for (u32 i = 0; i < BENCH_NAMES; i++) {
+        heap_allocator.free(&heap_allocator, names[i]);
+    }
+    heap_allocator.free(&heap_allocator, names);
+}
+
+BENCH(interner_build_64k) {
+    char **names = bench_names_new();
+    BENCH_SET_ITEMS(BENCH_NAMES);
+    BENCH_LOOP {
+        Interner interner = interner_new(&heap_allocator);
+        for (u32 i = 0; i < BENCH_NAMES; i++) {
+            interner_intern_cstr(&interner, names[i]);
+        }
+        BENCH_KEEP(interner_count(&interner));
+        interner_free(&interner);
+    }
+    bench_names_free(names);
+}
+
+BENCH(interner_intern_hit_64k) {
+    char **names = bench_names_new();
+    Interner interner = interner_new(&heap_allocator);
+    for (u32 i = 0; i < BENCH_NAMES; i++) {
+        interner_intern_cstr(&interner, names[i]);
+    }
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(interner_intern_cstr(&interner, names[i++ & (BENCH_NAMES - 1)]));
+    }
+    interner_free(&interner);
+    bench_names_free(names);
+}
+
+// The same lookups once the names are interned: a table keyed by strings has to hash and
+// compare the bytes, one keyed by ids works on integers.
+BENCH(name_table_get_cstr_64k) {
+    char **names = bench_names_new();
+    BenchNameTable table = bench_name_table_new(cstr_hash, cstr_eq, &heap_allocator);
+    for (u32 i = 0; i < BENCH_NAMES; i++) {
+        bench_name_table_set(&table, names[i], i);
+    }
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(bench_name_table_get(&table, names[i++ & (BENCH_NAMES - 1)]));
+    }
+    bench_name_table_free(&table);
+    bench_names_free(names);
+}
+
+BENCH(name_table_get_interned_64k) {
+    char **names = bench_names_new();
+    Interner interner = interner_new(&heap_allocator);
+    u64 *ids = (u64 *)heap_allocator.alloc(&heap_allocator, sizeof(u64) * BENCH_NAMES);
+    BenchIdTable table = bench_id_table_new(integer_hash, integer_eq, &heap_allocator);
+    for (u32 i = 0; i < BENCH_NAMES; i++) {
+        ids[i] = interner_intern_cstr(&interner, names[i]);
+        bench_id_table_set(&table, ids[i], i);
+    }
+    u32 i = 0;
+    BENCH_LOOP {
+        BENCH_KEEP(bench_id_table_get(&table, ids[i++ & (BENCH_NAMES - 1)]));
+    }
+    bench_id_table_free(&table);
+    heap_allocator.free(&heap_allocator, ids);
+    interner_free(&interner);
+    bench_names_free(names);
+}
+
+// The search kernels, each against its scalar version. The text is lowercase ASCII, so
+// find_byte and find scan the whole input and utf8_validate takes its ASCII fast path.
+typedef enum {
+    BENCH_SEARCH_EQ,
+    BENCH_SEARCH_FIND_BYTE,
+    BENCH_SEARCH_FIND,
+    BENCH_SEARCH_RFIND,
+    BENCH_SEARCH_COUNT_BYTE,
+    BENCH_SEARCH_UTF8_VALIDATE,
+    BENCH_SEARCH_UTF8_COUNT
+} BenchSearch;
+
+static void bench_string_search(Bench *_bench, usize length, BenchSearch search, bool scalar) {
+    String text = bench_string_filled(length);
+    String copy = bench_string_filled(length);
+    String needle = string("needle:", &heap_allocator);
+    BENCH_SET_BYTES(length);
+    BENCH_LOOP {
+        BENCH_CLOBBER();
+        switch (search) {
+            case BENCH_SEARCH_EQ:
+                BENCH_KEEP(scalar ? string_eq_scalar(text, copy) : string_eq(text, copy));
+                break;
+            case BENCH_SEARCH_FIND_BYTE:
+                BENCH_KEEP(scalar ? string_find_byte_scalar(text, '\n') : string_find_byte(text, '\n'));
+                break;
+            case BENCH_SEARCH_FIND:
+                BENCH_KEEP(scalar ? string_find_scalar(text, needle) : string_find(text, needle));
+                break;
+            case BENCH_SEARCH_RFIND:
+                BENCH_KEEP(scalar ? string_rfind_scalar(text, needle) : string_rfind(text, needle));
+                break;
+            case BENCH_SEARCH_COUNT_BYTE:
+                BENCH_KEEP(scalar ? string_count_byte_scalar(text, 'e') : string_count_byte(text, 'e'));
+                break;
+            case BENCH_SEARCH_UTF8_VALIDATE:
+                BENCH_KEEP(scalar ? utf8_validate_scalar(text) : utf8_validate(text));
+                break;
+            case BENCH_SEARCH_UTF8_COUNT:
+                BENCH_KEEP(scalar ? utf8_count_scalar(text) : utf8_count(text));
+                break;
+        }
+    }
+    string_free(&text);
+    string_free(&copy);
+    string_free(&needle);
+}
+
+#define BENCH_STRING_SEARCH(op, search, length, suffix) \
+    BENCH(string_##op##_##suffix) { bench_string_search(_bench, length, search, false); } \
+    BENCH(string_##op##_scalar_##suffix) { bench_string_search(_bench, length, search, true); }
+
+#define BENCH_STRING_SEARCH_SIZES(op, search) \
+    BENCH_STRING_SEARCH(op, search, 16, 16) \
+    BENCH_STRING_SEARCH(op, search, 256, 256) \
+    BENCH_STRING_SEARCH(op, search, 4096, 4k) \
+    BENCH_STRING_SEARCH(op, search, 65536, 64k) \
+    BENCH_STRING_SEARCH(op, search, 1 << 20, 1m)
+
+BENCH_STRING_SEARCH_SIZES(eq, BENCH_SEARCH_EQ)
+BENCH_STRING_SEARCH_SIZES(find_byte, BENCH_SEARCH_FIND_BYTE)
+BENCH_STRING_SEARCH_SIZES(find, BENCH_SEARCH_FIND)
+BENCH_STRING_SEARCH_SIZES(rfind, BENCH_SEARCH_RFIND)
+BENCH_STRING_SEARCH_SIZES(count_byte, BENCH_SEARCH_COUNT_BYTE)
+BENCH_STRING_SEARCH_SIZES(utf8_validate, BENCH_SEARCH_UTF8_VALIDATE)
+BENCH_STRING_SEARCH_SIZES(utf8_count, BENCH_SEARCH_UTF8_COUNT)
+
+#define BENCH_RUN_STRING_SEARCH(op) \
+    BENCH_RUN(string_##op##_16); \
+    BENCH_RUN(string_##op##_scalar_16); \
+    BENCH_RUN(string_##op##_256); \
+    BENCH_RUN(string_##op##_scalar_256); \
+    BENCH_RUN(string_##op##_4k); \
+    BENCH_RUN(string_##op##_scalar_4k); \
+    BENCH_RUN(string_##op##_64k); \
+    BENCH_RUN(string_##op##_scalar_64k); \
+    BENCH_RUN(string_##op##_1m); \
+    BENCH_RUN(string_##op##_scalar_1m)
+
+// Mostly multi-byte text, where validation leaves the ASCII fast path.
+BENCH(string_utf8_validate_mixed_64k) {
+    StringBuilder builder = string_builder_new(0, &heap_allocator);
+    while (builder.length < 65536) {
+        string_builder_append_cstr(&builder, "caf\xC3\xA9 \xE2\x82\xAC 42 \xF0\x9F\x98\x80 ");
+    }
+    String text = string_builder_finish(&builder);
+    BENCH_SET_BYTES(text.length);
+    BENCH_LOOP {
+        BENCH_CLOBBER();
+        BENCH_KEEP(utf8_validate(text));
+    }
+    string_free(&text);
+}
+
+void bench_suite_string(void) {
+    BENCH_RUN(string_hash_4);
+    BENCH_RUN(fnv1a_hash_4);
+    BENCH_RUN(string_hash_8);
+    BENCH_RUN(fnv1a_hash_8);
+    BENCH_RUN(string_hash_16);
+    BENCH_RUN(fnv1a_hash_16);
+    BENCH_RUN(string_hash_32);
+    BENCH_RUN(fnv1a_hash_32);
+    BENCH_RUN(string_hash_64);
+    BENCH_RUN(fnv1a_hash_64);
+    BENCH_RUN(string_hash_256);
+    BENCH_RUN(fnv1a_hash_256);
+    BENCH_RUN(string_hash_1024);
+    BENCH_RUN(fnv1a_hash_1024);
+    BENCH_RUN(string_hash_4096);
+    BENCH_RUN(fnv1a_hash_4096);
+    BENCH_RUN(string_eq_64);
+    BENCH_RUN_STRING_SEARCH(eq);
+    BENCH_RUN_STRING_SEARCH(find_byte);
+    BENCH_RUN_STRING_SEARCH(find);
+    BENCH_RUN_STRING_SEARCH(rfind);
+    BENCH_RUN_STRING_SEARCH(count_byte);
+    BENCH_RUN_STRING_SEARCH(utf8_validate);
+    BENCH_RUN_STRING_SEARCH(utf8_count);
+    BENCH_RUN(string_utf8_validate_mixed_64k);
+    BENCH_RUN(string_concat_arena);
+    BENCH_RUN(string_concat_build_64k);
+    BENCH_RUN(string_builder_build_64k);
+    BENCH_RUN(string_builder_build_1m);
+    BENCH_RUN(string_builder_report_1m);
+    BENCH_RUN(string_builder_report_appendf_1m);
+    BENCH_RUN(string_parse_u64_4k);
+    BENCH_RUN(strtoull_4k);
+    BENCH_RUN(string_parse_f64_4k);
+    BENCH_RUN(strtod_4k);
+    BENCH_RUN(format_u64_4k);
+    BENCH_RUN(snprintf_u64_4k);
+    BENCH_RUN(format_f64_4k);
+    BENCH_RUN(snprintf_f64_4k);
+    BENCH_RUN(interner_build_64k);
+    BENCH_RUN(interner_intern_hit_64k);
+    BENCH_RUN(name_table_get_cstr_64k);
+    BENCH_RUN(name_table_get_interned_64k);
+}
@@ -0,0 +1,127 @@
+#include "../lib/base.h"
+
+DYNAMIC_ARRAY_DECLARE(BenchElements, bench_elements, u32)
+DYNAMIC_ARRAY_IMPLEMENT(BenchElements, bench_elements, u32)
+
+#define BENCH_PARALLEL_LENGTH 100000000
+
+static BenchElements bench_elements_filled(void) {
+    BenchElements elements = bench_elements_new(&heap_allocator);
+    bench_elements_resize(&elements, BENCH_PARALLEL_LENGTH);
+    for (usize i = 0; i < elements.length; i++) {
+        elements.data[i] = (u32)i;
+    }
+    return elements;
+}
+
+// A few rounds of multiply and xorshift per element, so the map does some work per load
+// instead of only measuring memory bandwidth.
+static void bench_parallel_map(usize start, usize end, void *context) {
+    BenchElements *elements = (BenchElements *)context;
+    for (usize i = start; i < end; i++) {
+        u32 x = elements->data[i];
+        x = (x ^ (x >> 16)) * 0x45d9f3bu;
+        x = (x ^ (x >> 16)) * 0x45d9f3bu;
+        elements->data[i] = x ^ (x >> 16);
+    }
+}
+
+static void bench_parallel_sum(usize start, usize end, void *partial, void *context) {
+    BenchElements *elements = (BenchElements *)context;
+    u64 sum = 0;
+    for (usize i = start; i < end; i++) {
+        sum += elements->data[i];
+    }
+    *(u64 *)partial += sum;
+}
+
+static void bench_parallel_combine(void *result, const void *partial, void *context) {
+    *(u64 *)result += *(const u64 *)partial;
+    (void)context;
+}
+
+// threads counts the calling thread, which takes part in every parallel_for, so a single
+// thread runs the loop directly with no pool at all.
+static void bench_parallel_map_reduce(Bench *_bench, u32 threads, bool reduce) {
+    BenchElements elements = bench_elements_filled();
+    ThreadPool pool;
+    if (threads > 1) thread_pool_start(&pool, threads - 1, &heap_allocator);
+
+    BENCH_SET_ITEMS(elements.length);
+    BENCH_SET_BYTES(elements.length * sizeof(u32));
+    BENCH_LOOP {
+        if (reduce) {
+            u64 sum = 0;
+            if (threads > 1) {
+                parallel_reduce(&pool, 0, elements.length, 0, &sum, sizeof(sum),
+                                bench_parallel_sum, bench_parallel_combine, &elements);
+            } else {
+                bench_parallel_sum(0, elements.length, &sum, &elements);
+            }
+            BENCH_KEEP(sum);
+        } else {
+            if (threads > 1) {
+                parallel_for(&pool, 0, elements.length, 0, bench_parallel_map, &elements);
+            } else {
+                bench_parallel_map(0, elements.length, &elements);
+            }
+            BENCH_KEEP(elements.data[0]);
+        }
+    }
+
+    if (threads > 1) thread_pool_stop(&pool);
+    bench_elements_free(&elements);
+}
+
+#define BENCH_PARALLEL(threads) \
+    BENCH(parallel_map_100m_threads_##threads) { bench_parallel_map_reduce(_bench, threads, false); } \
+    BENCH(parallel_reduce_100m_threads_##threads) { bench_parallel_map_reduce(_bench, threads, true); }
+
+BENCH_PARALLEL(1)
+BENCH_PARALLEL(2)
+BENCH_PARALLEL(4)
+BENCH_PARALLEL(8)
+
+// One thread per online CPU, however many the machine has.
+BENCH(parallel_map_100m_threads_all) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    bench_parallel_map_reduce(_bench, cpus > 0 ? (u32)cpus : 1, false);
+}
+
+BENCH(parallel_reduce_100m_threads_all) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    bench_parallel_map_reduce(_bench, cpus > 0 ? (u32)cpus : 1, true);
+}
+
+// The overhead on its own: a fork/join of empty tasks.
+static void bench_empty_task(void *context) {
+    (void)context;
+}
+
+BENCH(task_group_spawn_wait_64) {
+    ThreadPool pool;
+    thread_pool_start(&pool, 0, &heap_allocator);
+    BENCH_SET_ITEMS(64);
+    BENCH_LOOP {
+        TaskGroup group = task_group_new(&pool);
+        for (u32 i = 0; i < 64; i++) {
+            task_group_spawn(&group, bench_empty_task, NULL);
+        }
+        task_group_wait(&group);
+    }
+    thread_pool_stop(&pool);
+}
+
+void bench_suite_threads(void) {
+    BENCH_RUN(parallel_map_100m_threads_1);
+    BENCH_RUN(parallel_map_100m_threads_2);
+    BENCH_RUN(parallel_map_100m_threads_4);
+    BENCH_RUN(parallel_map_100m_threads_8);
+    BENCH_RUN(parallel_map_100m_threads_all);
+    BENCH_RUN(parallel_reduce_100m_threads_1);
+    BENCH_RUN(parallel_reduce_100m_threads_2);
+    BENCH_RUN(parallel_reduce_100m_threads_4);
+    BENCH_RUN(parallel_reduce_100m_threads_8);
+    BENCH_RUN(parallel_reduce_100m_threads_all);
+    BENCH_RUN(task_group_spawn_wait_64);
+}
@@ -1,12 +1,42 @@
 #ifndef BASE_DECLARATIONS
 #define BASE_DECLARATIONS
 
+// -std=c99 hides the POSIX declarations (posix_memalign, clock_gettime, ...) on glibc.
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
+#include <float.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <regex.h>
+#include <sys/wait.h>
+
+#if defined(__SSE2__) && !defined(BASE_NO_SIMD)
+#define BASE_SSE2
+#include <emmintrin.h>
+// AVX2 kernels are compiled per function with a target attribute and only called once the
+// CPU is known to support them, so the rest of the build does not need -mavx2.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE_AVX2
+#define BASE_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
 
 // -------------------
 // --- Basic Types ---
@@ -43,54 +73,273 @@ typedef size_t usize;
 // --- Testing ---
 // ---------------
 
-#define TEST(name) static void test_##name(void)
-int TEST_RESULTS(void);
+// Tests register themselves when the program starts, so a file of TEST blocks only has to
+// be included in test/test_main.c, which hands over to test_main. It runs them in parallel
+// on one thread per CPU and prints each one's wall time.
+//
+//     --filter=regex   only tests whose name matches (POSIX extended regex)
+//     --jobs=n         run n tests at a time, 1 runs them one by one
+//     --fork           run each test in a child process, so a crash fails only that test
+//     --list           print the names and exit
+//     --help           print these options and exit
+//
+// TEST_ASSERT can be called from any thread. Failures count against the test running on
+// that thread; those on helper threads a test starts are counted against the test too
+// when it runs alone (--jobs=1, or in its own process with --fork), and otherwise fail
+// the run without naming a test.
+
+typedef struct TestCase TestCase;
+
+struct TestCase {
+    const char *name;
+    const char *file;
+    i32 line;
+    void (*function)(void);
+    TestCase *next;
+    u32 failures;
+    i32 signal;
+    u64 nanoseconds;
+};
+
+void test_register(TestCase *test);
+void test_fail(const char *condition, const char *file, i32 line, const char *function);
+int test_main(int argc, char **argv);
 
 #ifdef TESTS_ENABLED
 
-bool _test_failed = false;
-i32 _tests_ran = 0;
-i32 _tests_failed = 0;
+#define TEST(test_name) \
+    static void test_##test_name(void); \
+    static TestCase test_case_##test_name = { \
+        .name = #test_name, \
+        .file = __FILE__, \
+        .line = __LINE__, \
+        .function = test_##test_name \
+    }; \
+    __attribute__((constructor)) static void test_register_##test_name(void) { \
+        test_register(&test_case_##test_name); \
+    } \
+    static void test_##test_name(void)
 
 #define TEST_ASSERT(condition) do { \
     if (!(condition)) { \
-        fprintf(stderr, "\tASSERTION FAILED: %s at %s:%d in %s()\n", \
-                #condition, __FILE__, __LINE__, __func__); \
-        _test_failed = true; \
-    } \
-} while(0)
-
-#define TEST_RUN(name) do { \
-    printf("Running test %s... \n", #name); \
-    _tests_ran++; \
-    test_##name(); \
-    if (_test_failed) { \
-        _tests_failed++; \
-        _test_failed = false; \
+        test_fail(#condition, __FILE__, __LINE__, __func__); \
     } \
 } while(0)
 
 #else // TESTS_ENABLED
 
+#define TEST(name) static void test_##name(void)
 #define TEST_ASSERT(condition)
-#define TEST_RUN(name)
 
 #endif // TESTS_ENABLED
 
+// --------------------
+// --- Benchmarking ---
+// --------------------
+
+// A benchmark times its BENCH_LOOP body. The runner calibrates the iteration count until
+// one run takes at least the minimum time, then repeats the run and reports min, median
+// and p99 per operation. Setup outside the loop is not timed.
+//
+//     BENCH(string_hash) {
+//         String str = ...;
+//         BENCH_SET_BYTES(str.length);
+//         BENCH_LOOP {
+//             BENCH_KEEP(string_hash(str));
+//         }
+//     }
+
+typedef struct {
+    u64 iterations;
+    u64 remaining;
+    u64 start_ns;
+    u64 end_ns;
+    u64 items_per_op;
+    u64 bytes_per_op;
+} Bench;
+
+u64 bench_now_ns(void);
+
+static inline void bench_start(Bench *bench) {
+    bench->remaining = bench->iterations;
+    bench->start_ns = bench_now_ns();
+}
+
+static inline bool bench_running(Bench *bench) {
+    if (bench->remaining != 0) {
+        bench->remaining--;
+        return true;
+    }
+    bench->end_ns = bench_now_ns();
+    return false;
+}
+
+#define BENCH(name) static void bench_##name(Bench *_bench)
+#define BENCH_LOOP for (bench_start(_bench); bench_running(_bench);)
+// Items processed by one loop iteration, results are then reported per item.
+#define BENCH_SET_ITEMS(items) (_bench->items_per_op = (items))
+// Bytes processed by one loop iteration, enables the throughput column.
+#define BENCH_SET_BYTES(bytes) (_bench->bytes_per_op = (bytes))
+
+// Forces value to be computed and makes the compiler assume memory was read and written.
+#if defined(__GNUC__)
+#define BENCH_KEEP(value) do { \
+    __typeof__(value) _bench_value = (value); \
+    __asm__ __volatile__("" : : "r"(&_bench_value) : "memory"); \
+} while(0)
+#define BENCH_CLOBBER() __asm__ __volatile__("" : : : "memory")
+#else
+extern volatile u64 _bench_sink;
+#define BENCH_KEEP(value) (_bench_sink += (u64)(value))
+#define BENCH_CLOBBER() (_bench_sink++)
+#endif
+
+// A latency benchmark times every BENCH_SAMPLE block on its own and reports the
+// distribution (median, p99, p99.9, max) rather than the mean, for operations where the
+// tail matters. It runs once per repetition with no calibration, and the samples include
+// the cost of reading the clock.
+//
+//     BENCH_LATENCY(table_insert) {
+//         Table table = table_new(...);
+//         for (usize i = 0; i < count; i++) {
+//             BENCH_SAMPLE {
+//                 table_set(&table, keys[i], i);
+//             }
+//         }
+//         table_free(&table);
+//     }
+
+typedef struct {
+    u64 *samples;
+    usize count;
+    usize capacity;
+} BenchLatency;
+
+void bench_latency_grow(BenchLatency *latency);
+
+static inline void bench_record(BenchLatency *latency, u64 ns) {
+    if (latency->count == latency->capacity) bench_latency_grow(latency);
+    latency->samples[latency->count++] = ns;
+}
+
+#define BENCH_LATENCY(name) static void bench_##name(BenchLatency *_latency)
+#define BENCH_SAMPLE \
+    for (u64 _bench_sample_start = bench_now_ns(), _bench_sample_once = 1; \
+         _bench_sample_once; \
+         bench_record(_latency, bench_now_ns() - _bench_sample_start), _bench_sample_once = 0)
+
+void bench_init(int argc, char **argv);
+void bench_run(const char *name, void (*bench)(Bench *));
+void bench_run_latency(const char *name, void (*bench)(BenchLatency *));
+int BENCH_RESULTS(void);
+
+#ifdef BENCH_ENABLED
+
+#define BENCH_RUN(name) bench_run(#name, bench_##name)
+#define BENCH_RUN_LATENCY(name) bench_run_latency(#name, bench_##name)
+
+#else // BENCH_ENABLED
+
+#define BENCH_RUN(name)
+#define BENCH_RUN_LATENCY(name)
+
+#endif // BENCH_ENABLED
+
 // -------------------------
 // --- Memory Allocation ---
 // -------------------------
 
+// C99 has no max_align_t, so take the strictest alignment of the usual suspects.
+typedef union {
+    long long integer;
+    long double floating;
+    void *pointer;
+    void (*function)(void);
+} MaxAlign;
+
+typedef struct {
+    char padding;
+    MaxAlign value;
+} MaxAlignProbe;
+
+#define ALIGNMENT_DEFAULT (offsetof(MaxAlignProbe, value))
+#define CACHE_LINE_SIZE 64
+
+#if defined(__GNUC__)
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define CACHE_ALIGNED
+#define PREFETCH(address) ((void)(address))
+#endif
+
+static inline usize align_up(usize value, usize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// The strictest alignment an object of this size can need, since sizeof is always a
+// multiple of alignof. Keeps small allocations packed without misaligning larger ones.
+static inline usize align_for_size(usize size) {
+    usize lowest_bit = size & (~size + 1);
+    if (lowest_bit == 0 || lowest_bit > ALIGNMENT_DEFAULT) return ALIGNMENT_DEFAULT;
+    return lowest_bit;
+}
+
 typedef struct Allocator Allocator;
 
+// alloc returns zeroed memory. alloc_uninit, alloc_aligned and the grown tail of realloc
+// are left uninitialized for callers that overwrite the memory straight away. Memory is
+// always aligned for any object of the requested size, alloc_aligned can ask for more
+// (like CACHE_LINE_SIZE) but realloc does not preserve the extra alignment.
 struct Allocator {
     void *(*alloc)(Allocator *allocator, usize size);
     void *(*realloc)(Allocator *allocator, void *ptr, usize old_size, usize new_size);
     void (*free)(Allocator *allocator, void *ptr);
+    void *(*alloc_uninit)(Allocator *allocator, usize size);
+    void *(*alloc_aligned)(Allocator *allocator, usize size, usize alignment);
 };
 
+// Allocators written before alloc_uninit existed leave it NULL, so fall back to alloc.
+static inline void *allocator_alloc_uninit(Allocator *allocator, usize size) {
+    if (allocator->alloc_uninit == NULL) return allocator->alloc(allocator, size);
+    return allocator->alloc_uninit(allocator, size);
+}
+
+static inline void *allocator_alloc_aligned(Allocator *allocator, usize size, usize alignment) {
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    if (allocator->alloc_aligned == NULL) {
+        ASSERT(alignment <= ALIGNMENT_DEFAULT && "Allocator does not support over-aligned allocations");
+        return allocator_alloc_uninit(allocator, size);
+    }
+    return allocator->alloc_aligned(allocator, size, alignment);
+}
+
 extern Allocator heap_allocator;
 
+// What arena_reset does with the overflow blocks of a growable arena.
+typedef enum {
+    ARENA_RESET_RETAIN,  // keep them for reuse, so steady-state use never hits the backing allocator
+    ARENA_RESET_RELEASE  // hand them back to the backing allocator
+} ArenaResetPolicy;
+
+// Options for arena_new_virtual. Both fall back to normal pages when the system has none
+// to give, and both commit memory in ARENA_HUGE_PAGE_SIZE steps.
+typedef enum {
+    ARENA_VIRTUAL_DEFAULT = 0,
+    ARENA_VIRTUAL_HUGE_PAGES = 1 << 0,  // ask for transparent huge pages with MADV_HUGEPAGE
+    ARENA_VIRTUAL_HUGETLB = 1 << 1      // map from the MAP_HUGETLB pool, which must fit the whole reservation
+} ArenaVirtualFlags;
+
+#define ARENA_COMMIT_SIZE (64 * 1024)
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    usize capacity;
+};
+
 typedef struct {
     Allocator allocator;
     Allocator *backing_allocator;
@@ -98,14 +347,215 @@ typedef struct {
     usize capacity;
     usize offset;
     void *last_alloc;
+    // Block chaining, only used by growable arenas. The first buffer is always kept,
+    // overflow blocks are chained newest first with their data right after the header.
+    u8 *first_buffer;
+    usize first_capacity;
+    ArenaBlock *block;
+    ArenaBlock *free_blocks;
+    usize block_size;
+    usize max_block_size;
+    ArenaResetPolicy reset_policy;
+    bool growable;
+    // Virtual memory, only used by arena_new_virtual. The buffer is the whole reserved
+    // range and capacity is the committed prefix of it.
+    usize reserved;
+    usize retain;
+    usize commit_size;
+    bool virtual_memory;
 } Arena;
 
 Arena arena_new(usize capacity, Allocator *backing_allocator);
+Arena arena_new_growable(usize block_size, usize max_block_size, ArenaResetPolicy reset_policy,
+                         Allocator *backing_allocator);
+// Reserves reserve_size bytes of address space without committing any memory and commits
+// it in ARENA_COMMIT_SIZE steps as allocations reach it. The buffer never moves, so the last
+// allocation can always be grown in place until the reservation runs out. arena_reset
+// decommits everything past retain_size bytes back to the OS.
+Arena arena_new_virtual(usize reserve_size, usize retain_size, ArenaVirtualFlags flags);
 void *arena_alloc(Arena *arena, usize size);
+void *arena_alloc_uninit(Arena *arena, usize size);
+void *arena_alloc_aligned(Arena *arena, usize size, usize alignment);
 void *arena_realloc(Arena *arena, void *ptr, usize old_size, usize new_size);
 void arena_reset(Arena *arena);
 void arena_free(Arena *arena);
 
+// A position in an arena. arena_restore rolls the arena back to it, dropping everything
+// allocated since in O(1), plus the blocks a growable arena chained on in the meantime
+// (which go back through its reset policy). Marks must be restored innermost first, and
+// restoring past a reset or an older mark is an error.
+typedef struct {
+    ArenaBlock *block;
+    usize offset;
+} ArenaMark;
+
+ArenaMark arena_mark(Arena *arena);
+void arena_restore(Arena *arena, ArenaMark mark);
+
+#if defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// Per-thread growable arenas for temporary memory, created on first use:
+//
+//     String render(Arena *out, ...) {
+//         Scratch scratch = scratch_begin(&out, 1);
+//         ... build temporaries in scratch.arena, copy the result into out ...
+//         scratch_end(scratch);
+//     }
+//
+// conflicts lists the arenas the caller already allocates from (usually an output arena
+// that may itself be a scratch arena further up the stack), scratch_begin never hands one
+// of those out. SCRATCH_ARENA_COUNT arenas cover a chain of scratch users that each pass
+// their scratch arena down as the next one's output. scratch_free releases the calling
+// thread's arenas, call it before a thread that used them exits.
+#ifndef SCRATCH_ARENA_COUNT
+#define SCRATCH_ARENA_COUNT 2
+#endif
+#ifndef SCRATCH_BLOCK_SIZE
+#define SCRATCH_BLOCK_SIZE (64 * 1024)
+#endif
+#ifndef SCRATCH_MAX_BLOCK_SIZE
+#define SCRATCH_MAX_BLOCK_SIZE (64 * 1024 * 1024)
+#endif
+
+typedef struct {
+    Arena *arena;
+    ArenaMark mark;
+} Scratch;
+
+Scratch scratch_begin(Arena **conflicts, usize count);
+void scratch_end(Scratch scratch);
+void scratch_free(void);
+
+// Fixed-size object pool. Objects are carved from large slabs and recycled through an
+// intrusive free list. Requests bigger than object_size are forwarded to the backing
+// allocator and tracked separately, so a container can allocate its occasional backing
+// array (like a hash table's buckets) through the same pool as its nodes.
+typedef struct PoolSlab PoolSlab;
+typedef struct PoolLarge PoolLarge;
+
+struct PoolSlab {
+    PoolSlab *next;
+};
+
+struct PoolLarge {
+    PoolLarge *next;
+    void *base;
+};
+
+typedef struct {
+    Allocator allocator;
+    Allocator *backing_allocator;
+    usize object_size;
+    usize stride;
+    usize objects_per_slab;
+    void *free_list;
+    u8 *bump;
+    u8 *bump_end;
+    PoolSlab *slabs;
+    PoolSlab *spare_slabs;
+    PoolLarge *large;
+} Pool;
+
+Pool pool_new(usize object_size, usize objects_per_slab, Allocator *backing_allocator);
+void *pool_alloc(Pool *pool);
+void *pool_alloc_uninit(Pool *pool);
+void pool_release(Pool *pool, void *ptr);
+void pool_reset(Pool *pool);
+void pool_free(Pool *pool);
+
+// Wraps another allocator and counts what goes through it: allocations, frees, live and
+// peak bytes and a histogram of sizes by power of two. Give each subsystem (or each big
+// container) its own tracker to see where memory goes.
+//
+// Counters are spread over TRACKING_SLOTS cache lines. Live threads own one each and
+// update it without contention, threads past that share the last one with atomic adds.
+// Live bytes reach the shared total (and the peak) in batches of TRACKING_FLUSH_BYTES per
+// slot, so the peak can be low by up to TRACKING_SLOTS * TRACKING_FLUSH_BYTES. Define it
+// as 0 for an exact peak.
+//
+// Every allocation carries a small header with its size and call site. The
+// TRACKING_ALLOC* macros record __FILE__/__LINE__, allocations through the Allocator
+// interface (like from a HASH_TABLE) are counted under one unnamed site.
+#ifndef TRACKING_SLOTS
+#define TRACKING_SLOTS 16
+#endif
+#ifndef TRACKING_FLUSH_BYTES
+#define TRACKING_FLUSH_BYTES (64 * 1024)
+#endif
+#ifndef TRACKING_MAX_SITES
+#define TRACKING_MAX_SITES 256
+#endif
+#define TRACKING_SIZE_CLASSES 40
+
+typedef struct {
+    u64 allocs;
+    u64 frees;
+    u64 allocated_bytes;
+    u64 freed_bytes;
+    i64 pending_bytes;
+    u64 size_classes[TRACKING_SIZE_CLASSES];
+} CACHE_ALIGNED TrackingSlot;
+
+typedef struct {
+    const char *file;
+    u32 line;
+    u64 allocs;
+    u64 frees;
+    u64 live_bytes;
+} TrackingSite;
+
+typedef struct {
+    Allocator allocator;
+    Allocator *backing_allocator;
+    const char *name;
+    i64 live_bytes;
+    i64 peak_bytes;
+    TrackingSlot slots[TRACKING_SLOTS];
+    TrackingSite sites[TRACKING_MAX_SITES];
+} TrackingAllocator;
+
+typedef struct {
+    u64 allocs;
+    u64 frees;
+    u64 live_bytes;
+    u64 peak_bytes;
+    u64 total_bytes;
+    // size_classes[i] counts allocations of [2^(i-1), 2^i) bytes, the last class the rest.
+    u64 size_classes[TRACKING_SIZE_CLASSES];
+} TrackingStats;
+
+TrackingAllocator tracking_allocator_new(const char *name, Allocator *backing_allocator);
+void *tracking_alloc_at(TrackingAllocator *tracker, usize size, const char *file, u32 line);
+void *tracking_alloc_uninit_at(TrackingAllocator *tracker, usize size, const char *file, u32 line);
+void *tracking_realloc_at(TrackingAllocator *tracker, void *ptr, usize old_size, usize new_size,
+                          const char *file, u32 line);
+TrackingStats tracking_allocator_stats(TrackingAllocator *tracker);
+void tracking_allocator_report(TrackingAllocator *tracker, FILE *file);
+// Prints every call site with live allocations and returns how many are live in total.
+// Meant for shutdown, once nothing else allocates from the tracker.
+u64 tracking_allocator_check_leaks(TrackingAllocator *tracker, FILE *file);
+
+#define TRACKING_ALLOC(tracker, size) tracking_alloc_at((tracker), (size), __FILE__, __LINE__)
+#define TRACKING_ALLOC_UNINIT(tracker, size) \
+    tracking_alloc_uninit_at((tracker), (size), __FILE__, __LINE__)
+#define TRACKING_REALLOC(tracker, ptr, old_size, new_size) \
+    tracking_realloc_at((tracker), (ptr), (old_size), (new_size), __FILE__, __LINE__)
+#define TRACKING_FREE(tracker, ptr) ((tracker)->allocator.free(&(tracker)->allocator, (ptr)))
+
+// ---------------
+// --- Hashing ---
+// ---------------
+
+// wyhash: reads 8 bytes per multiply (48 per loop iteration over three independent lanes)
+// and mixes with a 64x64->128 bit multiply. Tables keyed by untrusted input should use a
+// secret seed from hash_random_seed() to make hash flooding impractical.
+u64 hash_bytes(const void *data, usize length, u64 seed);
+u64 hash_random_seed(void);
+
 // ---------------
 // --- Strings ---
 // ---------------
@@ -123,12 +573,222 @@ String string_slice(String string, usize start, usize end);
 bool string_eq(String a, String b);
 bool string_eq_cstr(String a, const char *cstr);
 u64 string_hash(String str);
+u64 string_hash_seeded(String str, u64 seed);
 void string_free(String *string);
 
+// Searching and UTF-8. These run on SSE2 or AVX2 when the CPU has them, picked at runtime,
+// and the portable *_scalar versions they must agree with are exported for comparison.
+// Searches return the index of the first (string_rfind: last) match, or STRING_NOT_FOUND.
+// An empty needle matches at the start (string_rfind: the end).
+#define STRING_NOT_FOUND SIZE_MAX
+
+typedef enum {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+} SimdLevel;
+
+SimdLevel simd_level(void);
+// Caps the level the string kernels use on the calling thread, to test or benchmark the
+// fallbacks without affecting other threads. Levels the CPU or the build does not support
+// are clamped to the best available one.
+void simd_set_level(SimdLevel level);
+
+usize string_find_byte(String str, u8 byte);
+usize string_find(String haystack, String needle);
+usize string_rfind(String haystack, String needle);
+usize string_count_byte(String str, u8 byte);
+// Rejects overlong encodings, surrogates, code points past U+10FFFF and truncated
+// sequences.
+bool utf8_validate(String str);
+// Counts code points, assuming str is valid UTF-8 (every byte that is not a continuation
+// byte starts one).
+usize utf8_count(String str);
+
+bool string_eq_scalar(String a, String b);
+usize string_find_byte_scalar(String str, u8 byte);
+usize string_find_scalar(String haystack, String needle);
+usize string_rfind_scalar(String haystack, String needle);
+usize string_count_byte_scalar(String str, u8 byte);
+bool utf8_validate_scalar(String str);
+usize utf8_count_scalar(String str);
+
+// Builds a String out of pieces. The buffer grows geometrically, so appends are amortized
+// O(1) instead of the full copy a string_concat per piece costs.
+//
+//     StringBuilder builder = string_builder_new(0, &arena.allocator);
+//     string_builder_append_cstr(&builder, "took ");
+//     string_builder_append_u64(&builder, elapsed_ms);
+//     string_builder_appendf(&builder, " ms for %s", name);
+//     String message = string_builder_finish(&builder);
+typedef struct {
+    u8 *buffer;
+    usize length;
+    usize capacity;
+    Allocator *allocator;
+} StringBuilder;
+
+#if defined(__GNUC__)
+#define PRINTF_FORMAT(format_index, first_arg) \
+    __attribute__((format(printf, format_index, first_arg)))
+#else
+#define PRINTF_FORMAT(format_index, first_arg)
+#endif
+
+StringBuilder string_builder_new(usize capacity, Allocator *allocator);
+// Makes room for additional more bytes.
+void string_builder_reserve(StringBuilder *builder, usize additional);
+void string_builder_append(StringBuilder *builder, String str);
+void string_builder_append_cstr(StringBuilder *builder, const char *cstr);
+void string_builder_append_byte(StringBuilder *builder, u8 byte);
+void string_builder_append_u64(StringBuilder *builder, u64 value);
+void string_builder_append_i64(StringBuilder *builder, i64 value);
+// Fixed notation with decimals digits after the point (at most 9), rounded half away from
+// zero. Magnitudes past 9.2e18 (where the integer part no longer fits an i64) go through
+// snprintf.
+void string_builder_append_f64(StringBuilder *builder, f64 value, u32 decimals);
+void string_builder_appendf(StringBuilder *builder, const char *format, ...) PRINTF_FORMAT(2, 3);
+// Hands the buffer over as a String without copying and leaves the builder empty. The
+// String is freed with string_free as usual.
+String string_builder_finish(StringBuilder *builder);
+void string_builder_reset(StringBuilder *builder);
+void string_builder_free(StringBuilder *builder);
+
+// Splits a string into slices of it without allocating. string_lines yields lines without
+// their "\n" or "\r\n", and a trailing newline does not start an empty last line. With
+// string_split every delimiter separates two pieces, so "a,,b," gives "a", "", "b", "".
+//
+//     StringSplitter lines = string_lines(file);
+//     String line;
+//     while (string_split_next(&lines, &line)) { ... }
+typedef struct {
+    String rest;
+    u8 delimiter;
+    bool lines;
+    bool done;
+} StringSplitter;
+
+StringSplitter string_split(String str, u8 delimiter);
+StringSplitter string_lines(String str);
+bool string_split_next(StringSplitter *splitter, String *piece);
+
+// Number parsing takes the whole string: no whitespace, and anything after the number
+// fails the parse, as does overflow. Integers take an optional sign ('-' only for i64).
+// Floats take the usual decimal forms ("1", "-.5", "2.5e-3") and "inf", "infinity" and
+// "nan" in any case, and are correctly rounded: the common cases are exact in hardware or
+// resolved from a 128-bit power-of-five table (Eisel-Lemire), and only the rare inputs
+// neither can decide go through strtod.
+bool string_parse_u64(String str, u64 *value);
+bool string_parse_i64(String str, i64 *value);
+bool string_parse_f64(String str, f64 *value);
+
+// Formats into buffer, which must have room for NUMBER_FORMAT_MAX bytes, and returns the
+// length written. No terminator is added. Doubles come out in the shortest form that
+// parses back to the same value, the closest to it when there is a choice (Schubfach):
+// fixed notation from 1e-6 up to 1e21, and "1.5e-7" style outside.
+#define NUMBER_FORMAT_MAX 32
+
+usize format_u64(char *buffer, u64 value);
+usize format_i64(char *buffer, i64 value);
+usize format_f64(char *buffer, f64 value);
+String string_from_u64(u64 value, Allocator *allocator);
+String string_from_i64(i64 value, Allocator *allocator);
+String string_from_f64(f64 value, Allocator *allocator);
+
+// -------------
+// --- Files ---
+// -------------
+
+// Hints for how a mapped file will be read, passed on to madvise.
+typedef enum {
+    FILE_MAP_DEFAULT = 0,
+    FILE_MAP_SEQUENTIAL = 1 << 0,  // read-ahead aggressively, drop pages once read
+    FILE_MAP_RANDOM = 1 << 1,      // no read-ahead
+    FILE_MAP_WILLNEED = 1 << 2     // start reading the whole file in now
+} FileMapFlags;
+
+// Maps a whole file read-only and returns it as a String over the mapping, without copying.
+// Slices of it stay valid until file_unmap. Returns false if the file cannot be opened or
+// mapped. Empty files map to an empty String.
+bool file_map(const char *path, FileMapFlags flags, String *file);
+void file_unmap(String *file);
+
+// Buffered reading from a file descriptor, for input that cannot be mapped (pipes, stdin,
+// sockets). The buffer is refilled with large reads and records are handed out as slices
+// of it, copied only to move a partial record to the front before the next refill. A
+// record longer than the buffer grows it. Returned slices stay valid until the next call
+// on the reader. Read errors end the input and set error.
+#define READER_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    int fd;
+    u8 *buffer;
+    usize capacity;
+    usize start;
+    usize end;
+    bool eof;
+    bool error;
+    Allocator *allocator;
+} Reader;
+
+// A capacity of 0 picks READER_BUFFER_SIZE. The reader does not own the descriptor.
+Reader reader_new(int fd, usize capacity, Allocator *allocator);
+// Returns the next count bytes without consuming them, fewer only at the end of the input.
+String reader_peek(Reader *reader, usize count);
+void reader_skip(Reader *reader, usize count);
+// Copies up to count bytes out and returns how many, 0 at the end of the input.
+usize reader_read(Reader *reader, void *destination, usize count);
+// The next record up to the delimiter, which is consumed but not included. The last
+// record does not need a delimiter. Returns false at the end of the input.
+bool reader_read_until(Reader *reader, u8 delimiter, String *record);
+// Like reader_read_until with '\n', also dropping a '\r' before it.
+bool reader_read_line(Reader *reader, String *line);
+void reader_free(Reader *reader);
+
+// Buffered writing to a file descriptor. Small writes are copied into the buffer; a write
+// that does not fit goes out together with the buffered bytes in one writev, so large
+// strings are never copied. Write errors are sticky and reported by writer_flush.
+#define WRITER_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    int fd;
+    u8 *buffer;
+    usize capacity;
+    usize length;
+    bool error;
+    Allocator *allocator;
+} Writer;
+
+// A capacity of 0 picks WRITER_BUFFER_SIZE. The writer does not own the descriptor.
+Writer writer_new(int fd, usize capacity, Allocator *allocator);
+void writer_write(Writer *writer, String str);
+void writer_write_cstr(Writer *writer, const char *cstr);
+void writer_write_byte(Writer *writer, u8 byte);
+// Returns false if any write so far has failed.
+bool writer_flush(Writer *writer);
+// Flushes and frees the buffer, returning what writer_flush did.
+bool writer_free(Writer *writer);
+
 // ----------------------
 // --- Dynamic Arrays ---
 // ----------------------
 
+// Arrays grow geometrically, to capacity * NUMERATOR / DENOMINATOR or to what an operation
+// needs if that is more, in a single realloc. Define these before including the header to
+// trade memory for fewer copies (3/2 lets a freed block be reused by a later growth).
+#ifndef DYNAMIC_ARRAY_GROWTH_NUMERATOR
+#define DYNAMIC_ARRAY_GROWTH_NUMERATOR 2
+#endif
+#ifndef DYNAMIC_ARRAY_GROWTH_DENOMINATOR
+#define DYNAMIC_ARRAY_GROWTH_DENOMINATOR 1
+#endif
+
+static inline usize dynamic_array_grown_capacity(usize capacity, usize needed) {
+    usize grown = capacity * DYNAMIC_ARRAY_GROWTH_NUMERATOR / DYNAMIC_ARRAY_GROWTH_DENOMINATOR;
+    if (grown < 8) grown = 8;
+    return grown < needed ? needed : grown;
+}
+
 #define DYNAMIC_ARRAY_DECLARE(name, prefix, type) \
     typedef struct { \
         type *data; \
@@ -138,17 +798,24 @@ void string_free(String *string);
     } name; \
     \
     name prefix##_new(Allocator *allocator); \
+    void prefix##_reserve(name *array, usize capacity); \
+    void prefix##_resize(name *array, usize length); \
     void prefix##_push(name *array, type value); \
+    void prefix##_push_many(name *array, const type *values, usize count); \
+    void prefix##_insert_at(name *array, usize index, type value); \
     type prefix##_pop(name *array); \
+    type prefix##_remove_swap(name *array, usize index); \
+    type prefix##_remove_ordered(name *array, usize index); \
     name prefix##_extend(name *array, name *other); \
     name prefix##_slice(name *array, usize start, usize end); \
+    void prefix##_shrink_to_fit(name *array); \
     void prefix##_reset(name *array); \
     void prefix##_free(name *array); \
 
 #define DYNAMIC_ARRAY_IMPLEMENT(name, prefix, type) \
     name prefix##_new(Allocator *allocator) { \
         name array = { \
-            .data = (type *)allocator->alloc(allocator, sizeof(type)*8), \
+            .data = (type *)allocator_alloc_uninit(allocator, sizeof(type)*8), \
             .length = 0, \
             .capacity = 8, \
             .allocator = allocator \
@@ -156,36 +823,96 @@ void string_free(String *string);
         return array; \
     } \
     \
+    static void prefix##_set_capacity(name *array, usize capacity) { \
+        ASSERT(array->allocator != NULL && "Cannot grow a slice"); \
+        array->data = (type *)array->allocator->realloc( \
+            array->allocator, \
+            array->data, \
+            sizeof(type)*array->capacity, \
+            sizeof(type)*capacity \
+        ); \
+        array->capacity = capacity; \
+    } \
+    \
+    /* Makes room for count more elements. */ \
+    static inline void prefix##_grow(name *array, usize count) { \
+        ASSERT(count <= SIZE_MAX / sizeof(type) - array->length); \
+        usize needed = array->length + count; \
+        if (needed > array->capacity) { \
+            prefix##_set_capacity(array, dynamic_array_grown_capacity(array->capacity, needed)); \
+        } \
+    } \
+    \
+    void prefix##_reserve(name *array, usize capacity) { \
+        if (capacity > array->capacity) { \
+            prefix##_set_capacity(array, capacity); \
+        } \
+    } \
+    \
+    /* New elements are zeroed. */ \
+    void prefix##_resize(name *array, usize length) { \
+        if (length > array->length) { \
+            prefix##_grow(array, length - array->length); \
+            memset(array->data + array->length, 0, sizeof(type)*(length - array->length)); \
+        } \
+        array->length = length; \
+    } \
+    \
     void prefix##_push(name *array, type value) { \
         if (array->length == array->capacity) { \
-            array->data = (type *)array->allocator->realloc( \
-                array->allocator, \
-                array->data, \
-                sizeof(type)*array->capacity, \
-                sizeof(type)*array->capacity*2 \
-            ); \
-            array->capacity *= 2; \
+            prefix##_grow(array, 1); \
         } \
         array->data[array->length++] = value; \
     } \
     \
+    /* values may point into the array itself (extending it with itself or one of its */ \
+    /* slices), so find them again after growing moves the buffer. */ \
+    void prefix##_push_many(name *array, const type *values, usize count) { \
+        usize start = (usize)array->data; \
+        usize address = (usize)values; \
+        bool inside = address >= start && address < start + sizeof(type)*array->capacity; \
+        prefix##_grow(array, count); \
+        if (inside) { \
+            values = array->data + (address - start) / sizeof(type); \
+        } \
+        memcpy(array->data + array->length, values, sizeof(type)*count); \
+        array->length += count; \
+    } \
+    \
+    void prefix##_insert_at(name *array, usize index, type value) { \
+        ASSERT(index <= array->length); \
+        prefix##_grow(array, 1); \
+        memmove(array->data + index + 1, array->data + index, \
+                sizeof(type)*(array->length - index)); \
+        array->data[index] = value; \
+        array->length++; \
+    } \
+    \
     type prefix##_pop(name *array) { \
         ASSERT(array->length > 0); \
         return array->data[--array->length]; \
     } \
     \
+    /* O(1), moves the last element into the hole. */ \
+    type prefix##_remove_swap(name *array, usize index) { \
+        ASSERT(index < array->length); \
+        type value = array->data[index]; \
+        array->data[index] = array->data[--array->length]; \
+        return value; \
+    } \
+    \
+    /* O(n), keeps the order of the remaining elements. */ \
+    type prefix##_remove_ordered(name *array, usize index) { \
+        ASSERT(index < array->length); \
+        type value = array->data[index]; \
+        array->length--; \
+        memmove(array->data + index, array->data + index + 1, \
+                sizeof(type)*(array->length - index)); \
+        return value; \
+    } \
+    \
     name prefix##_extend(name *array, name *other) { \
-        if (array->length + other->length > array->capacity) { \
-            array->data = (type *)array->allocator->realloc( \
-                array->allocator, \
-                array->data, \
-                sizeof(type)*array->capacity, \
-                sizeof(type)*array->capacity*2 \
-            ); \
-            array->capacity *= 2; \
-        } \
-        memcpy(array->data + array->length, other->data, sizeof(type)*other->length); \
-        array->length += other->length; \
+        prefix##_push_many(array, other->data, other->length); \
         return *array; \
     } \
     \
@@ -201,6 +928,14 @@ void string_free(String *string);
         return slice; \
     } \
     \
+    /* Keeps room for one element so the buffer never becomes a zero-sized allocation. */ \
+    void prefix##_shrink_to_fit(name *array) { \
+        usize capacity = array->length == 0 ? 1 : array->length; \
+        if (capacity < array->capacity) { \
+            prefix##_set_capacity(array, capacity); \
+        } \
+    } \
+    \
     void prefix##_reset(name *array) { \
         array->length = 0; \
     } \
@@ -213,6 +948,229 @@ void string_free(String *string);
         array->capacity = 0; \
     } \
 
+// Sorting and searching for a DYNAMIC_ARRAY type, declared separately since not every
+// element type has an order. less_function(a, b) takes two elements by value and is
+// inlined into an introsort (quicksort falling back to heapsort, insertion sort for short
+// ranges), which avoids qsort's indirect comparator call per comparison.
+//
+//     DYNAMIC_ARRAY_SORT_DECLARE(Floats, floats, f64)
+//     DYNAMIC_ARRAY_SORT_IMPLEMENT(Floats, floats, f64, f64_less)
+//
+// The radix variant is a stable LSD radix sort over a 64-bit key that orders the same way
+// as the elements, see the sort_key_* helpers. Byte positions where all keys agree are
+// skipped, so 32-bit keys cost four passes. It needs a temporary copy of the array.
+#ifndef SORT_INSERTION_THRESHOLD
+#define SORT_INSERTION_THRESHOLD 16
+#endif
+
+static inline u64 sort_key_u64(u64 value) {
+    return value;
+}
+
+static inline u64 sort_key_i64(i64 value) {
+    return (u64)value ^ ((u64)1 << 63);
+}
+
+static inline u64 sort_key_i32(i32 value) {
+    return (u64)((u32)value ^ ((u32)1 << 31));
+}
+
+// Negative floats have every bit flipped so larger magnitudes sort first, positive ones
+// only the sign bit. NaNs sort by their bits.
+static inline u64 sort_key_f64(f64 value) {
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & ((u64)1 << 63) ? ~bits : bits ^ ((u64)1 << 63);
+}
+
+static inline u64 sort_key_f32(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (u64)(bits & ((u32)1 << 31) ? ~bits : bits ^ ((u32)1 << 31));
+}
+
+static inline u32 sort_depth_limit(usize length) {
+    u32 depth = 0;
+    while (length > 1) {
+        length >>= 1;
+        depth += 2;
+    }
+    return depth;
+}
+
+#define DYNAMIC_ARRAY_SORT_DECLARE(name, prefix, type) \
+    void prefix##_sort(name *array); \
+    /* Index of the first element not less than value, array->length if there is none. */ \
+    usize prefix##_lower_bound(name *array, type value); \
+    /* Stores the lower bound in index, which is also the insertion point on a miss. */ \
+    bool prefix##_binary_search(name *array, type value, usize *index); \
+
+#define DYNAMIC_ARRAY_SORT_IMPLEMENT(name, prefix, type, less_function) \
+    static inline void prefix##_sort_swap(type *a, type *b) { \
+        type temp = *a; \
+        *a = *b; \
+        *b = temp; \
+    } \
+    \
+    static void prefix##_sort_insertion(type *data, usize length) { \
+        for (usize i = 1; i < length; i++) { \
+            type value = data[i]; \
+            usize j = i; \
+            while (j > 0 && less_function(value, data[j - 1])) { \
+                data[j] = data[j - 1]; \
+                j--; \
+            } \
+            data[j] = value; \
+        } \
+    } \
+    \
+    static void prefix##_sort_heap(type *data, usize length) { \
+        for (usize end = length, start = length / 2; end > 1;) { \
+            if (start > 0) { \
+                start--; \
+            } else { \
+                end--; \
+                prefix##_sort_swap(&data[0], &data[end]); \
+            } \
+            usize root = start; \
+            while (2 * root + 1 < end) { \
+                usize child = 2 * root + 1; \
+                if (child + 1 < end && less_function(data[child], data[child + 1])) child++; \
+                if (!less_function(data[root], data[child])) break; \
+                prefix##_sort_swap(&data[root], &data[child]); \
+                root = child; \
+            } \
+        } \
+    } \
+    \
+    static void prefix##_sort_range(type *data, usize length, u32 depth) { \
+        while (length > SORT_INSERTION_THRESHOLD) { \
+            if (depth == 0) { \
+                prefix##_sort_heap(data, length); \
+                return; \
+            } \
+            depth--; \
+            \
+            /* Median of three, then a Hoare partition around it. Equal keys are split */ \
+            /* evenly between both sides rather than piling up on one. */ \
+            usize middle = (length - 1) / 2; \
+            usize last = length - 1; \
+            if (less_function(data[middle], data[0])) prefix##_sort_swap(&data[0], &data[middle]); \
+            if (less_function(data[last], data[middle])) { \
+                prefix##_sort_swap(&data[middle], &data[last]); \
+                if (less_function(data[middle], data[0])) prefix##_sort_swap(&data[0], &data[middle]); \
+            } \
+            type pivot = data[middle]; \
+            usize i = 0; \
+            usize j = last; \
+            for (;;) { \
+                while (less_function(data[i], pivot)) i++; \
+                while (less_function(pivot, data[j])) j--; \
+                if (i >= j) break; \
+                prefix##_sort_swap(&data[i], &data[j]); \
+                i++; \
+                j--; \
+            } \
+            \
+            /* Recurse into the smaller side so the stack stays O(log n). */ \
+            usize left = j + 1; \
+            if (left < length - left) { \
+                prefix##_sort_range(data, left, depth); \
+                data += left; \
+                length -= left; \
+            } else { \
+                prefix##_sort_range(data + left, length - left, depth); \
+                length = left; \
+            } \
+        } \
+        prefix##_sort_insertion(data, length); \
+    } \
+    \
+    void prefix##_sort(name *array) { \
+        prefix##_sort_range(array->data, array->length, sort_depth_limit(array->length)); \
+    } \
+    \
+    usize prefix##_lower_bound(name *array, type value) { \
+        if (array->length == 0) return 0; \
+        /* The lower bound stays within [base, base + length], the comparison only picks */ \
+        /* which half to keep, so it compiles to a conditional move instead of a branch. */ \
+        type *base = array->data; \
+        usize length = array->length; \
+        while (length > 1) { \
+            usize half = length / 2; \
+            base = less_function(base[half], value) ? base + half : base; \
+            length -= half; \
+        } \
+        return (usize)(base - array->data) + (less_function(*base, value) ? 1 : 0); \
+    } \
+    \
+    bool prefix##_binary_search(name *array, type value, usize *index) { \
+        usize lower = prefix##_lower_bound(array, value); \
+        *index = lower; \
+        return lower < array->length && !less_function(value, array->data[lower]); \
+    } \
+
+#define DYNAMIC_ARRAY_RADIX_SORT_DECLARE(name, prefix, type) \
+    void prefix##_radix_sort(name *array); \
+
+#define DYNAMIC_ARRAY_RADIX_SORT_IMPLEMENT(name, prefix, type, key_function) \
+    void prefix##_radix_sort(name *array) { \
+        usize length = array->length; \
+        type *data = array->data; \
+        if (length <= SORT_INSERTION_THRESHOLD) { \
+            for (usize i = 1; i < length; i++) { \
+                type value = data[i]; \
+                u64 key = key_function(value); \
+                usize j = i; \
+                while (j > 0 && key < key_function(data[j - 1])) { \
+                    data[j] = data[j - 1]; \
+                    j--; \
+                } \
+                data[j] = value; \
+            } \
+            return; \
+        } \
+        \
+        /* One pass builds the histograms of all eight bytes. */ \
+        usize counts[8][256]; \
+        memset(counts, 0, sizeof(counts)); \
+        for (usize i = 0; i < length; i++) { \
+            u64 key = key_function(data[i]); \
+            for (u32 byte = 0; byte < 8; byte++) { \
+                counts[byte][(key >> (byte * 8)) & 0xFF]++; \
+            } \
+        } \
+        \
+        /* Slices have no allocator of their own. */ \
+        Allocator *allocator = array->allocator != NULL ? array->allocator : &heap_allocator; \
+        type *buffer = (type *)allocator_alloc_uninit(allocator, sizeof(type) * length); \
+        type *from = data; \
+        type *to = buffer; \
+        u64 first_key = key_function(data[0]); \
+        for (u32 byte = 0; byte < 8; byte++) { \
+            u32 shift = byte * 8; \
+            usize *count = counts[byte]; \
+            if (count[(first_key >> shift) & 0xFF] == length) continue; \
+            \
+            usize offset = 0; \
+            for (u32 digit = 0; digit < 256; digit++) { \
+                usize digit_count = count[digit]; \
+                count[digit] = offset; \
+                offset += digit_count; \
+            } \
+            for (usize i = 0; i < length; i++) { \
+                to[count[(key_function(from[i]) >> shift) & 0xFF]++] = from[i]; \
+            } \
+            type *temp = from; \
+            from = to; \
+            to = temp; \
+        } \
+        if (from != data) { \
+            memcpy(data, from, sizeof(type) * length); \
+        } \
+        allocator->free(allocator, buffer); \
+    } \
+
 // -------------------
 // --- Hash Tables ---
 // -------------------
@@ -222,151 +1180,287 @@ bool integer_eq(u64 a, u64 b);
 u64 cstr_hash(const char *str);
 bool cstr_eq(const char *a, const char *b);
 
-#define HASH_TABLE_DECLARE(name, prefix, key_type, value_type) \
+// HASH_TABLE calls hash and eq through function pointers stored in the table.
+// HASH_TABLE_DECLARE_INLINE/HASH_TABLE_IMPLEMENT_INLINE take them as macro arguments
+// instead, so they are inlined into every operation and the table does not store them.
+// Both produce the same API apart from prefix##_new.
+//
+// Entries cache their hash, so growing never calls hash again. By default the table grows
+// in one pass over every entry. prefix##_set_incremental switches it to keeping the old
+// buckets around after a grow and moving HASH_TABLE_MIGRATE_BUCKETS of them on every
+// operation, which bounds the latency of the insert that triggers the grow.
+//
+// prefix##_set_many and prefix##_get_many work through the keys HASH_TABLE_BATCH at a
+// time: hash the whole batch, prefetch its buckets, then its first entries, then probe.
+// The loads overlap instead of each key waiting on its own cache misses.
+
+#define HASH_TABLE_MIGRATE_BUCKETS 8
+#define HASH_TABLE_BATCH 16
+
+// Smallest power of two bucket count, at least 8, that holds count entries without growing.
+static inline usize hash_table_bucket_count(usize count) {
+    usize bucket_count = 8;
+    while (bucket_count * 3 / 4 < count) {
+        bucket_count *= 2;
+    }
+    return bucket_count;
+}
+
+#define HASH_TABLE_DECLARE_ENTRY(name, key_type, value_type) \
     typedef struct name##Entry { \
         key_type key; \
         value_type value; \
+        u64 hash; \
         struct name##Entry *next; \
     } name##Entry; \
+
+#define HASH_TABLE_DECLARE_OPERATIONS(name, prefix, key_type, value_type) \
+    void prefix##_reserve(name *table, usize count); \
+    void prefix##_set_incremental(name *table, bool incremental); \
+    void prefix##_set(name *table, key_type key, value_type value); \
+    void prefix##_set_many(name *table, const key_type *keys, const value_type *values, \
+                           usize count); \
+    bool prefix##_contains(name *table, key_type key); \
+    value_type prefix##_get(name *table, key_type key); \
+    usize prefix##_get_many(name *table, const key_type *keys, value_type *values, \
+                            bool *found, usize count); \
+    bool prefix##_remove(name *table, key_type key); \
+    void prefix##_reset(name *table); \
+    void prefix##_free(name *table); \
+
+#define HASH_TABLE_DECLARE(name, prefix, key_type, value_type) \
+    HASH_TABLE_DECLARE_ENTRY(name, key_type, value_type) \
     \
     typedef struct { \
         name##Entry **buckets; \
         usize bucket_count; \
         usize size; \
+        name##Entry **old_buckets; \
+        usize old_bucket_count; \
+        usize migrate_index; \
+        bool incremental; \
         u64 (*hash)(key_type key); \
         bool (*eq)(key_type a, key_type b); \
         Allocator *allocator; \
     } name; \
     \
     name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator); \
-    void prefix##_set(name *table, key_type key, value_type value); \
-    bool prefix##_contains(name *table, key_type key); \
-    value_type prefix##_get(name *table, key_type key); \
-    bool prefix##_remove(name *table, key_type key); \
-    void prefix##_reset(name *table); \
-    void prefix##_free(name *table); \
+    name prefix##_with_capacity(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), \
+                                usize capacity, Allocator *allocator); \
+    HASH_TABLE_DECLARE_OPERATIONS(name, prefix, key_type, value_type) \
 
-#define HASH_TABLE_IMPLEMENT(name, prefix, key_type, value_type) \
-    static void prefix##_grow(name *table) { \
-        usize old_bucket_count = table->bucket_count; \
-        name##Entry **old_buckets = table->buckets; \
-        \
-        table->bucket_count *= 2; \
-        table->buckets = (name##Entry **)table->allocator->alloc( \
-            table->allocator, sizeof(name##Entry *) * table->bucket_count); \
-        table->size = 0; \
+#define HASH_TABLE_DECLARE_INLINE(name, prefix, key_type, value_type) \
+    HASH_TABLE_DECLARE_ENTRY(name, key_type, value_type) \
+    \
+    typedef struct { \
+        name##Entry **buckets; \
+        usize bucket_count; \
+        usize size; \
+        name##Entry **old_buckets; \
+        usize old_bucket_count; \
+        usize migrate_index; \
+        bool incremental; \
+        Allocator *allocator; \
+    } name; \
+    \
+    name prefix##_new(Allocator *allocator); \
+    name prefix##_with_capacity(usize capacity, Allocator *allocator); \
+    HASH_TABLE_DECLARE_OPERATIONS(name, prefix, key_type, value_type) \
+
+#define HASH_TABLE_IMPLEMENT_OPERATIONS(name, prefix, key_type, value_type) \
+    /* Moves up to count old buckets into the new ones, frees them once all are moved. */ \
+    static void prefix##_migrate(name *table, usize count) { \
+        usize end = table->migrate_index + count; \
+        if (end > table->old_bucket_count) end = table->old_bucket_count; \
         \
-        for (usize i = 0; i < old_bucket_count; i++) { \
-            name##Entry *entry = old_buckets[i]; \
+        for (usize i = table->migrate_index; i < end; i++) { \
+            name##Entry *entry = table->old_buckets[i]; \
             while (entry != NULL) { \
                 name##Entry *next = entry->next; \
-                \
-                u64 hash = table->hash(entry->key); \
-                usize bucket_index = hash % table->bucket_count; \
-                \
+                usize bucket_index = entry->hash % table->bucket_count; \
                 entry->next = table->buckets[bucket_index]; \
                 table->buckets[bucket_index] = entry; \
-                table->size++; \
-                \
                 entry = next; \
             } \
+            table->old_buckets[i] = NULL; \
         } \
+        table->migrate_index = end; \
         \
-        table->allocator->free(table->allocator, old_buckets); \
+        if (end == table->old_bucket_count) { \
+            table->allocator->free(table->allocator, table->old_buckets); \
+            table->old_buckets = NULL; \
+            table->old_bucket_count = 0; \
+            table->migrate_index = 0; \
+        } \
     } \
     \
-    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator) { \
-        name table = { \
-            .buckets = (name##Entry **)allocator->alloc(allocator, sizeof(name##Entry *) * 8), \
-            .bucket_count = 8, \
-            .size = 0, \
-            .hash = hash, \
-            .eq = eq, \
-            .allocator = allocator \
-        }; \
-        return table; \
+    static void prefix##_resize(name *table, usize bucket_count, bool incremental) { \
+        if (table->old_buckets != NULL) { \
+            prefix##_migrate(table, table->old_bucket_count); \
+        } \
+        \
+        table->old_buckets = table->buckets; \
+        table->old_bucket_count = table->bucket_count; \
+        table->migrate_index = 0; \
+        \
+        table->bucket_count = bucket_count; \
+        table->buckets = (name##Entry **)table->allocator->alloc( \
+            table->allocator, sizeof(name##Entry *) * table->bucket_count); \
+        \
+        if (!incremental) { \
+            prefix##_migrate(table, table->old_bucket_count); \
+        } \
     } \
     \
-    void prefix##_set(name *table, key_type key, value_type value) { \
-        u64 hash = table->hash(key); \
-        usize bucket_index = hash % table->bucket_count; \
+    void prefix##_reserve(name *table, usize count) { \
+        usize bucket_count = hash_table_bucket_count(count); \
+        if (bucket_count > table->bucket_count) { \
+            prefix##_resize(table, bucket_count, false); \
+        } \
+    } \
+    \
+    /* Returns the link pointing at the entry for key, or at the NULL ending its chain. */ \
+    static name##Entry **prefix##_find(name *table, key_type key, u64 hash) { \
+        if (table->old_buckets != NULL) { \
+            prefix##_migrate(table, HASH_TABLE_MIGRATE_BUCKETS); \
+        } \
         \
-        name##Entry *entry = table->buckets[bucket_index]; \
-        while (entry != NULL) { \
-            if (table->eq(entry->key, key)) { \
-                entry->value = value; \
-                return; \
+        if (table->old_buckets != NULL) { \
+            usize old_index = hash % table->old_bucket_count; \
+            if (old_index >= table->migrate_index) { \
+                name##Entry **link = &table->old_buckets[old_index]; \
+                while (*link != NULL) { \
+                    if ((*link)->hash == hash && prefix##_eq_key(table, (*link)->key, key)) { \
+                        return link; \
+                    } \
+                    link = &(*link)->next; \
+                } \
             } \
-            entry = entry->next; \
         } \
         \
-        name##Entry *new_entry = (name##Entry *)table->allocator->alloc( \
+        name##Entry **link = &table->buckets[hash % table->bucket_count]; \
+        while (*link != NULL) { \
+            if ((*link)->hash == hash && prefix##_eq_key(table, (*link)->key, key)) { \
+                return link; \
+            } \
+            link = &(*link)->next; \
+        } \
+        return link; \
+    } \
+    \
+    void prefix##_set_incremental(name *table, bool incremental) { \
+        table->incremental = incremental; \
+        if (!incremental && table->old_buckets != NULL) { \
+            prefix##_migrate(table, table->old_bucket_count); \
+        } \
+    } \
+    \
+    static void prefix##_set_hashed(name *table, key_type key, u64 hash, value_type value) { \
+        name##Entry **link = prefix##_find(table, key, hash); \
+        if (*link != NULL) { \
+            (*link)->value = value; \
+            return; \
+        } \
+        \
+        /* Always insert into the new buckets, the chain link may belong to the old ones. */ \
+        usize bucket_index = hash % table->bucket_count; \
+        name##Entry *new_entry = (name##Entry *)allocator_alloc_uninit( \
             table->allocator, sizeof(name##Entry)); \
         new_entry->key = key; \
         new_entry->value = value; \
+        new_entry->hash = hash; \
         new_entry->next = table->buckets[bucket_index]; \
         table->buckets[bucket_index] = new_entry; \
         table->size++; \
         \
         if (table->size > table->bucket_count * 3 / 4) { \
-            prefix##_grow(table); \
+            prefix##_resize(table, table->bucket_count * 2, table->incremental); \
         } \
     } \
     \
-    bool prefix##_contains(name *table, key_type key) { \
-        u64 hash = table->hash(key); \
-        usize bucket_index = hash % table->bucket_count; \
-        \
-        name##Entry *entry = table->buckets[bucket_index]; \
-        while (entry != NULL) { \
-            if (table->eq(entry->key, key)) { \
-                return true; \
+    void prefix##_set(name *table, key_type key, value_type value) { \
+        prefix##_set_hashed(table, key, prefix##_hash_key(table, key), value); \
+    } \
+    \
+    /* Hashes keys[0..count) and prefetches their buckets, then the first entry of each. */ \
+    static void prefix##_prefetch_batch(name *table, const key_type *keys, u64 *hashes, \
+                                        usize count) { \
+        for (usize i = 0; i < count; i++) { \
+            hashes[i] = prefix##_hash_key(table, keys[i]); \
+            PREFETCH(&table->buckets[hashes[i] % table->bucket_count]); \
+        } \
+        for (usize i = 0; i < count; i++) { \
+            PREFETCH(table->buckets[hashes[i] % table->bucket_count]); \
+        } \
+    } \
+    \
+    void prefix##_set_many(name *table, const key_type *keys, const value_type *values, \
+                           usize count) { \
+        u64 hashes[HASH_TABLE_BATCH]; \
+        for (usize start = 0; start < count; start += HASH_TABLE_BATCH) { \
+            usize batch = count - start < HASH_TABLE_BATCH ? count - start : HASH_TABLE_BATCH; \
+            prefix##_prefetch_batch(table, keys + start, hashes, batch); \
+            for (usize i = 0; i < batch; i++) { \
+                prefix##_set_hashed(table, keys[start + i], hashes[i], values[start + i]); \
             } \
-            entry = entry->next; \
         } \
-        return false; \
+    } \
+    \
+    bool prefix##_contains(name *table, key_type key) { \
+        u64 hash = prefix##_hash_key(table, key); \
+        return *prefix##_find(table, key, hash) != NULL; \
     } \
     \
     value_type prefix##_get(name *table, key_type key) { \
-        u64 hash = table->hash(key); \
-        usize bucket_index = hash % table->bucket_count; \
-        \
-        name##Entry *entry = table->buckets[bucket_index]; \
-        while (entry != NULL) { \
-            if (table->eq(entry->key, key)) { \
-                return entry->value; \
-            } \
-            entry = entry->next; \
+        u64 hash = prefix##_hash_key(table, key); \
+        name##Entry *entry = *prefix##_find(table, key, hash); \
+        if (entry != NULL) { \
+            return entry->value; \
         } \
         ASSERT(false && "Key not found in hash table"); \
         return (value_type){0}; \
     } \
     \
-    bool prefix##_remove(name *table, key_type key) { \
-        u64 hash = table->hash(key); \
-        usize bucket_index = hash % table->bucket_count; \
-        \
-        name##Entry *entry = table->buckets[bucket_index]; \
-        name##Entry *prev = NULL; \
-        \
-        while (entry != NULL) { \
-            if (table->eq(entry->key, key)) { \
-                if (prev == NULL) { \
-                    table->buckets[bucket_index] = entry->next; \
-                } else { \
-                    prev->next = entry->next; \
+    /* Missing keys leave values[i] untouched. found may be NULL, returns how many were found. */ \
+    usize prefix##_get_many(name *table, const key_type *keys, value_type *values, \
+                            bool *found, usize count) { \
+        u64 hashes[HASH_TABLE_BATCH]; \
+        usize found_count = 0; \
+        for (usize start = 0; start < count; start += HASH_TABLE_BATCH) { \
+            usize batch = count - start < HASH_TABLE_BATCH ? count - start : HASH_TABLE_BATCH; \
+            prefix##_prefetch_batch(table, keys + start, hashes, batch); \
+            for (usize i = 0; i < batch; i++) { \
+                name##Entry *entry = *prefix##_find(table, keys[start + i], hashes[i]); \
+                if (entry != NULL) { \
+                    values[start + i] = entry->value; \
+                    found_count++; \
+                } \
+                if (found != NULL) { \
+                    found[start + i] = entry != NULL; \
                 } \
-                table->allocator->free(table->allocator, entry); \
-                table->size--; \
-                return true; \
             } \
-            prev = entry; \
-            entry = entry->next; \
         } \
-        return false; \
+        return found_count; \
+    } \
+    \
+    bool prefix##_remove(name *table, key_type key) { \
+        u64 hash = prefix##_hash_key(table, key); \
+        name##Entry **link = prefix##_find(table, key, hash); \
+        name##Entry *entry = *link; \
+        if (entry == NULL) { \
+            return false; \
+        } \
+        *link = entry->next; \
+        table->allocator->free(table->allocator, entry); \
+        table->size--; \
+        return true; \
     } \
     \
     void prefix##_reset(name *table) { \
+        if (table->old_buckets != NULL) { \
+            prefix##_migrate(table, table->old_bucket_count); \
+        } \
+        \
         for (usize i = 0; i < table->bucket_count; i++) { \
             name##Entry *entry = table->buckets[i]; \
             while (entry != NULL) { \
@@ -386,214 +1480,4903 @@ bool cstr_eq(const char *a, const char *b);
         table->bucket_count = 0; \
     } \
 
-#endif // BASE_DECLARATIONS
+#define HASH_TABLE_IMPLEMENT(name, prefix, key_type, value_type) \
+    static inline u64 prefix##_hash_key(name *table, key_type key) { \
+        return table->hash(key); \
+    } \
+    \
+    static inline bool prefix##_eq_key(name *table, key_type a, key_type b) { \
+        return table->eq(a, b); \
+    } \
+    \
+    name prefix##_with_capacity(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), \
+                                usize capacity, Allocator *allocator) { \
+        usize bucket_count = hash_table_bucket_count(capacity); \
+        name table = { \
+            .buckets = (name##Entry **)allocator->alloc( \
+                allocator, sizeof(name##Entry *) * bucket_count), \
+            .bucket_count = bucket_count, \
+            .size = 0, \
+            .hash = hash, \
+            .eq = eq, \
+            .allocator = allocator \
+        }; \
+        return table; \
+    } \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator) { \
+        return prefix##_with_capacity(hash, eq, 0, allocator); \
+    } \
+    \
+    HASH_TABLE_IMPLEMENT_OPERATIONS(name, prefix, key_type, value_type) \
 
-// --------------------------------------------------------------------------------------
+#define HASH_TABLE_IMPLEMENT_INLINE(name, prefix, key_type, value_type, hash_function, eq_function) \
+    static inline u64 prefix##_hash_key(name *table, key_type key) { \
+        (void)table; \
+        return hash_function(key); \
+    } \
+    \
+    static inline bool prefix##_eq_key(name *table, key_type a, key_type b) { \
+        (void)table; \
+        return eq_function(a, b); \
+    } \
+    \
+    name prefix##_with_capacity(usize capacity, Allocator *allocator) { \
+        usize bucket_count = hash_table_bucket_count(capacity); \
+        name table = { \
+            .buckets = (name##Entry **)allocator->alloc( \
+                allocator, sizeof(name##Entry *) * bucket_count), \
+            .bucket_count = bucket_count, \
+            .size = 0, \
+            .allocator = allocator \
+        }; \
+        return table; \
+    } \
+    \
+    name prefix##_new(Allocator *allocator) { \
+        return prefix##_with_capacity(0, allocator); \
+    } \
+    \
+    HASH_TABLE_IMPLEMENT_OPERATIONS(name, prefix, key_type, value_type) \
 
-#ifdef BASE_IMPLEMENTATION
-#undef BASE_IMPLEMENTATION
+// ------------------------
+// --- Flat Hash Tables ---
+// ------------------------
 
-// ---------------
-// --- Testing ---
-// ---------------
+// Open-addressing tables in the style of SwissTable. Keys and values live inline in one
+// slot array and a parallel array of control bytes is probed a whole group at a time.
+// A control byte is EMPTY, DELETED or holds the low 7 bits of the slot's hash.
+//
+// prefix##_get_many batches lookups HASH_TABLE_BATCH at a time like HASH_TABLE's: hash the
+// batch and prefetch each key's first group of control bytes and slots, then probe.
 
-#ifdef TESTS_ENABLED
+#define FLAT_GROUP_WIDTH 16
+#define FLAT_CONTROL_EMPTY ((i8)-128)
+#define FLAT_CONTROL_DELETED ((i8)-2)
 
-int TEST_RESULTS(void) {
-    printf("\n=== TEST SUMMARY ===\n");
-    printf("Tests ran: %d, Failed: %d\n", _tests_ran, _tests_failed);
-    printf("Overall: %s\n", (_tests_failed == 0) ? "PASS" : "FAIL");
-    return !(_tests_failed == 0);
+static inline u32 flat_group_match(const i8 *group, i8 h2) {
+#ifdef BASE_SSE2
+    __m128i control = _mm_loadu_si128((const __m128i *)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(h2)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < FLAT_GROUP_WIDTH; i++) {
+        mask |= (u32)(group[i] == h2) << i;
+    }
+    return mask;
+#endif
 }
 
-#else // TESTS_ENABLED
-
-int TEST_RESULTS(void) { return 0; }
-
-#endif // TESTS_ENABLED
-
-// -------------------------
-// --- Memory Allocation ---
-// -------------------------
-
-void *heap_allocator_alloc(Allocator *allocator, usize size) {
-    void *ptr = malloc(size);
-    ASSERT(ptr != NULL);
-    memset(ptr, 0, size);
-    return ptr;
+static inline u32 flat_group_match_empty(const i8 *group) {
+    return flat_group_match(group, FLAT_CONTROL_EMPTY);
 }
 
-void *heap_allocator_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
-    void *new_ptr = realloc(ptr, new_size);
-    ASSERT(new_ptr != NULL);
-    return new_ptr;
+static inline u32 flat_group_match_free(const i8 *group) {
+    // EMPTY and DELETED are the only negative control bytes.
+#ifdef BASE_SSE2
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < FLAT_GROUP_WIDTH; i++) {
+        mask |= (u32)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
 }
 
-void heap_allocator_free(Allocator *allocator, void *ptr) {
-    free(ptr);
+static inline u32 flat_group_first(u32 mask) {
+#if defined(__GNUC__)
+    return (u32)__builtin_ctz(mask);
+#else
+    u32 index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
 }
 
-Allocator heap_allocator = {
-    heap_allocator_alloc,
-    heap_allocator_realloc,
-    heap_allocator_free
-};
+#define FLAT_HASH_TABLE_DECLARE(name, prefix, key_type, value_type) \
+    typedef struct { \
+        key_type key; \
+        value_type value; \
+    } name##Slot; \
+    \
+    typedef struct { \
+        i8 *control; \
+        name##Slot *slots; \
+        usize capacity; \
+        usize size; \
+        usize growth_left; \
+        u64 (*hash)(key_type key); \
+        bool (*eq)(key_type a, key_type b); \
+        Allocator *allocator; \
+    } name; \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator); \
+    void prefix##_set(name *table, key_type key, value_type value); \
+    bool prefix##_contains(name *table, key_type key); \
+    value_type prefix##_get(name *table, key_type key); \
+    usize prefix##_get_many(name *table, const key_type *keys, value_type *values, \
+                            bool *found, usize count); \
+    bool prefix##_remove(name *table, key_type key); \
+    void prefix##_reset(name *table); \
+    void prefix##_free(name *table); \
 
-void *arena_allocator_alloc(Allocator *allocator, usize size) {
-    Arena *arena = (Arena *)allocator;
-    return arena_alloc(arena, size);
-}
+#define FLAT_HASH_TABLE_IMPLEMENT(name, prefix, key_type, value_type) \
+    static void prefix##_allocate(name *table, usize capacity) { \
+        table->control = (i8 *)allocator_alloc_uninit(table->allocator, capacity); \
+        memset(table->control, FLAT_CONTROL_EMPTY, capacity); \
+        table->slots = (name##Slot *)allocator_alloc_uninit( \
+            table->allocator, sizeof(name##Slot) * capacity); \
+        table->capacity = capacity; \
+        table->growth_left = capacity - capacity / 8; \
+    } \
+    \
+    static usize prefix##_find(name *table, key_type key, u64 hash) { \
+        usize group_mask = table->capacity / FLAT_GROUP_WIDTH - 1; \
+        usize group = (hash >> 7) & group_mask; \
+        i8 h2 = (i8)(hash & 0x7F); \
+        \
+        for (usize stride = 1; ; stride++) { \
+            const i8 *control = table->control + group * FLAT_GROUP_WIDTH; \
+            u32 match = flat_group_match(control, h2); \
+            while (match != 0) { \
+                usize index = group * FLAT_GROUP_WIDTH + flat_group_first(match); \
+                if (table->eq(table->slots[index].key, key)) { \
+                    return index; \
+                } \
+                match &= match - 1; \
+            } \
+            if (flat_group_match_empty(control) != 0) { \
+                return table->capacity; \
+            } \
+            group = (group + stride) & group_mask; \
+        } \
+    } \
+    \
+    static usize prefix##_find_free(name *table, u64 hash) { \
+        usize group_mask = table->capacity / FLAT_GROUP_WIDTH - 1; \
+        usize group = (hash >> 7) & group_mask; \
+        \
+        for (usize stride = 1; ; stride++) { \
+            u32 free = flat_group_match_free(table->control + group * FLAT_GROUP_WIDTH); \
+            if (free != 0) { \
+                return group * FLAT_GROUP_WIDTH + flat_group_first(free); \
+            } \
+            group = (group + stride) & group_mask; \
+        } \
+    } \
+    \
+    static void prefix##_rehash(name *table, usize capacity) { \
+        i8 *old_control = table->control; \
+        name##Slot *old_slots = table->slots; \
+        usize old_capacity = table->capacity; \
+        \
+        prefix##_allocate(table, capacity); \
+        \
+        for (usize i = 0; i < old_capacity; i++) { \
+            if (old_control[i] < 0) continue; \
+            u64 hash = table->hash(old_slots[i].key); \
+            usize index = prefix##_find_free(table, hash); \
+            table->control[index] = (i8)(hash & 0x7F); \
+            table->slots[index] = old_slots[i]; \
+        } \
+        table->growth_left -= table->size; \
+        \
+        table->allocator->free(table->allocator, old_control); \
+        table->allocator->free(table->allocator, old_slots); \
+    } \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator) { \
+        name table = { \
+            .size = 0, \
+            .hash = hash, \
+            .eq = eq, \
+            .allocator = allocator \
+        }; \
+        prefix##_allocate(&table, FLAT_GROUP_WIDTH); \
+        return table; \
+    } \
+    \
+    void prefix##_set(name *table, key_type key, value_type value) { \
+        u64 hash = table->hash(key); \
+        usize index = prefix##_find(table, key, hash); \
+        if (index != table->capacity) { \
+            table->slots[index].value = value; \
+            return; \
+        } \
+        \
+        index = prefix##_find_free(table, hash); \
+        if (table->growth_left == 0 && table->control[index] == FLAT_CONTROL_EMPTY) { \
+            /* Out of empty slots: double if mostly live, otherwise just drop tombstones. */ \
+            usize capacity = table->capacity; \
+            if (table->size >= capacity / 16 * 7) { \
+                capacity *= 2; \
+            } \
+            prefix##_rehash(table, capacity); \
+            index = prefix##_find_free(table, hash); \
+        } \
+        \
+        if (table->control[index] == FLAT_CONTROL_EMPTY) { \
+            table->growth_left--; \
+        } \
+        table->control[index] = (i8)(hash & 0x7F); \
+        table->slots[index].key = key; \
+        table->slots[index].value = value; \
+        table->size++; \
+    } \
+    \
+    bool prefix##_contains(name *table, key_type key) { \
+        return prefix##_find(table, key, table->hash(key)) != table->capacity; \
+    } \
+    \
+    value_type prefix##_get(name *table, key_type key) { \
+        usize index = prefix##_find(table, key, table->hash(key)); \
+        ASSERT(index != table->capacity && "Key not found in hash table"); \
+        return table->slots[index].value; \
+    } \
+    \
+    /* Missing keys leave values[i] untouched. found may be NULL, returns how many were found. */ \
+    usize prefix##_get_many(name *table, const key_type *keys, value_type *values, \
+                            bool *found, usize count) { \
+        u64 hashes[HASH_TABLE_BATCH]; \
+        usize group_mask = table->capacity / FLAT_GROUP_WIDTH - 1; \
+        usize found_count = 0; \
+        for (usize start = 0; start < count; start += HASH_TABLE_BATCH) { \
+            usize batch = count - start < HASH_TABLE_BATCH ? count - start : HASH_TABLE_BATCH; \
+            for (usize i = 0; i < batch; i++) { \
+                hashes[i] = table->hash(keys[start + i]); \
+                usize group = ((hashes[i] >> 7) & group_mask) * FLAT_GROUP_WIDTH; \
+                PREFETCH(table->control + group); \
+                PREFETCH(table->slots + group); \
+            } \
+            for (usize i = 0; i < batch; i++) { \
+                usize index = prefix##_find(table, keys[start + i], hashes[i]); \
+                if (index != table->capacity) { \
+                    values[start + i] = table->slots[index].value; \
+                    found_count++; \
+                } \
+                if (found != NULL) { \
+                    found[start + i] = index != table->capacity; \
+                } \
+            } \
+        } \
+        return found_count; \
+    } \
+    \
+    bool prefix##_remove(name *table, key_type key) { \
+        usize index = prefix##_find(table, key, table->hash(key)); \
+        if (index == table->capacity) return false; \
+        \
+        /* A probe only continues past a group that had no empty slot, so the slot can */ \
+        /* become EMPTY again only if its group still has one. */ \
+        const i8 *group = table->control + (index & ~(usize)(FLAT_GROUP_WIDTH - 1)); \
+        if (flat_group_match_empty(group) != 0) { \
+            table->control[index] = FLAT_CONTROL_EMPTY; \
+            table->growth_left++; \
+        } else { \
+            table->control[index] = FLAT_CONTROL_DELETED; \
+        } \
+        table->size--; \
+        return true; \
+    } \
+    \
+    void prefix##_reset(name *table) { \
+        memset(table->control, FLAT_CONTROL_EMPTY, table->capacity); \
+        table->size = 0; \
+        table->growth_left = table->capacity - table->capacity / 8; \
+    } \
+    \
+    void prefix##_free(name *table) { \
+        table->allocator->free(table->allocator, table->control); \
+        table->allocator->free(table->allocator, table->slots); \
+        table->control = NULL; \
+        table->slots = NULL; \
+        table->capacity = 0; \
+        table->size = 0; \
+        table->growth_left = 0; \
+    } \
 
-void *arena_allocator_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
-    Arena *arena = (Arena *)allocator;
-    return arena_realloc(arena, ptr, old_size, new_size);
-}
+// -----------------
+// --- Hash Sets ---
+// -----------------
 
-void arena_allocator_free(Allocator *allocator, void *ptr) {}
+// Flat sets of keys with the same layout and probing as FLAT_HASH_TABLE, minus the value:
+// a control byte and a key per slot, and nothing allocated per element. hash and eq follow
+// the HASH_TABLE conventions (integer_hash/integer_eq, cstr_hash/cstr_eq, ...).
+//
+// prefix##_union, prefix##_intersect and prefix##_difference update the first set in
+// place. Union reserves room for both sets up front so it never grows midway, and
+// intersect and difference walk whichever of the two sets is smaller.
+//
+//     NameSetIterator it = name_set_iterator(&set);
+//     const char *name;
+//     while (name_set_next(&it, &name)) { ... }
+//
+// Inserting or removing while iterating may skip or repeat keys.
 
-Arena arena_new(usize capacity, Allocator *backing_allocator) {
-    Arena arena = {
-        .allocator = {
-            .alloc = arena_allocator_alloc,
-            .realloc = arena_allocator_realloc,
-            .free = arena_allocator_free
-        },
-        .backing_allocator = backing_allocator,
-        .buffer = (u8 *)backing_allocator->alloc(backing_allocator, capacity),
-        .capacity = capacity
-    };
-    return arena;
+// Smallest capacity, a power of two and at least one group, that holds count keys within
+// the 7/8 load factor.
+static inline usize hash_set_capacity(usize count) {
+    usize capacity = FLAT_GROUP_WIDTH;
+    while (capacity - capacity / 8 < count) {
+        capacity *= 2;
+    }
+    return capacity;
 }
 
-void *arena_alloc(Arena *arena, usize size) {
-    ASSERT(arena->buffer != NULL);
-    ASSERT(arena->offset + size <= arena->capacity);
-    void *ptr = arena->buffer + arena->offset;
-    arena->offset += size;
-    arena->last_alloc = ptr;
-    memset(ptr, 0, size);
-    return ptr;
-}
+#define HASH_SET_DECLARE(name, prefix, key_type) \
+    typedef struct { \
+        i8 *control; \
+        key_type *keys; \
+        usize capacity; \
+        usize size; \
+        usize growth_left; \
+        u64 (*hash)(key_type key); \
+        bool (*eq)(key_type a, key_type b); \
+        Allocator *allocator; \
+    } name; \
+    \
+    typedef struct { \
+        const name *set; \
+        usize index; \
+    } name##Iterator; \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator); \
+    void prefix##_reserve(name *set, usize count); \
+    bool prefix##_insert(name *set, key_type key); \
+    bool prefix##_contains(const name *set, key_type key); \
+    bool prefix##_remove(name *set, key_type key); \
+    void prefix##_union(name *set, const name *other); \
+    void prefix##_intersect(name *set, const name *other); \
+    void prefix##_difference(name *set, const name *other); \
+    name##Iterator prefix##_iterator(const name *set); \
+    bool prefix##_next(name##Iterator *iterator, key_type *key); \
+    void prefix##_reset(name *set); \
+    void prefix##_free(name *set); \
+
+#define HASH_SET_IMPLEMENT(name, prefix, key_type) \
+    static void prefix##_allocate(name *set, usize capacity) { \
+        set->control = (i8 *)allocator_alloc_uninit(set->allocator, capacity); \
+        memset(set->control, FLAT_CONTROL_EMPTY, capacity); \
+        set->keys = (key_type *)allocator_alloc_uninit(set->allocator, sizeof(key_type) * capacity); \
+        set->capacity = capacity; \
+        set->growth_left = capacity - capacity / 8; \
+    } \
+    \
+    static usize prefix##_find(const name *set, key_type key, u64 hash) { \
+        usize group_mask = set->capacity / FLAT_GROUP_WIDTH - 1; \
+        usize group = (hash >> 7) & group_mask; \
+        i8 h2 = (i8)(hash & 0x7F); \
+        \
+        for (usize stride = 1; ; stride++) { \
+            const i8 *control = set->control + group * FLAT_GROUP_WIDTH; \
+            u32 match = flat_group_match(control, h2); \
+            while (match != 0) { \
+                usize index = group * FLAT_GROUP_WIDTH + flat_group_first(match); \
+                if (set->eq(set->keys[index], key)) { \
+                    return index; \
+                } \
+                match &= match - 1; \
+            } \
+            if (flat_group_match_empty(control) != 0) { \
+                return set->capacity; \
+            } \
+            group = (group + stride) & group_mask; \
+        } \
+    } \
+    \
+    static usize prefix##_find_free(name *set, u64 hash) { \
+        usize group_mask = set->capacity / FLAT_GROUP_WIDTH - 1; \
+        usize group = (hash >> 7) & group_mask; \
+        \
+        for (usize stride = 1; ; stride++) { \
+            u32 free = flat_group_match_free(set->control + group * FLAT_GROUP_WIDTH); \
+            if (free != 0) { \
+                return group * FLAT_GROUP_WIDTH + flat_group_first(free); \
+            } \
+            group = (group + stride) & group_mask; \
+        } \
+    } \
+    \
+    static void prefix##_rehash(name *set, usize capacity) { \
+        i8 *old_control = set->control; \
+        key_type *old_keys = set->keys; \
+        usize old_capacity = set->capacity; \
+        \
+        prefix##_allocate(set, capacity); \
+        \
+        for (usize i = 0; i < old_capacity; i++) { \
+            if (old_control[i] < 0) continue; \
+            u64 hash = set->hash(old_keys[i]); \
+            usize index = prefix##_find_free(set, hash); \
+            set->control[index] = (i8)(hash & 0x7F); \
+            set->keys[index] = old_keys[i]; \
+        } \
+        set->growth_left -= set->size; \
+        \
+        set->allocator->free(set->allocator, old_control); \
+        set->allocator->free(set->allocator, old_keys); \
+    } \
+    \
+    /* Clears a slot found by prefix##_find, the same way FLAT_HASH_TABLE removes. */ \
+    static void prefix##_erase(name *set, usize index) { \
+        const i8 *group = set->control + (index & ~(usize)(FLAT_GROUP_WIDTH - 1)); \
+        if (flat_group_match_empty(group) != 0) { \
+            set->control[index] = FLAT_CONTROL_EMPTY; \
+            set->growth_left++; \
+        } else { \
+            set->control[index] = FLAT_CONTROL_DELETED; \
+        } \
+        set->size--; \
+    } \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator) { \
+        name set = { \
+            .size = 0, \
+            .hash = hash, \
+            .eq = eq, \
+            .allocator = allocator \
+        }; \
+        prefix##_allocate(&set, FLAT_GROUP_WIDTH); \
+        return set; \
+    } \
+    \
+    void prefix##_reserve(name *set, usize count) { \
+        usize capacity = hash_set_capacity(count); \
+        if (capacity > set->capacity) { \
+            prefix##_rehash(set, capacity); \
+        } \
+    } \
+    \
+    bool prefix##_insert(name *set, key_type key) { \
+        u64 hash = set->hash(key); \
+        if (prefix##_find(set, key, hash) != set->capacity) return false; \
+        \
+        usize index = prefix##_find_free(set, hash); \
+        if (set->growth_left == 0 && set->control[index] == FLAT_CONTROL_EMPTY) { \
+            /* Out of empty slots: double if mostly live, otherwise just drop tombstones. */ \
+            usize capacity = set->capacity; \
+            if (set->size >= capacity / 16 * 7) { \
+                capacity *= 2; \
+            } \
+            prefix##_rehash(set, capacity); \
+            index = prefix##_find_free(set, hash); \
+        } \
+        \
+        if (set->control[index] == FLAT_CONTROL_EMPTY) { \
+            set->growth_left--; \
+        } \
+        set->control[index] = (i8)(hash & 0x7F); \
+        set->keys[index] = key; \
+        set->size++; \
+        return true; \
+    } \
+    \
+    bool prefix##_contains(const name *set, key_type key) { \
+        return prefix##_find(set, key, set->hash(key)) != set->capacity; \
+    } \
+    \
+    bool prefix##_remove(name *set, key_type key) { \
+        usize index = prefix##_find(set, key, set->hash(key)); \
+        if (index == set->capacity) return false; \
+        prefix##_erase(set, index); \
+        return true; \
+    } \
+    \
+    void prefix##_union(name *set, const name *other) { \
+        prefix##_reserve(set, set->size + other->size); \
+        name##Iterator iterator = prefix##_iterator(other); \
+        key_type key; \
+        while (prefix##_next(&iterator, &key)) { \
+            prefix##_insert(set, key); \
+        } \
+    } \
+    \
+    void prefix##_intersect(name *set, const name *other) { \
+        if (other->size < set->size) { \
+            /* Collect the few survivors into a set sized for them and swap it in. */ \
+            name result = prefix##_new(set->hash, set->eq, set->allocator); \
+            prefix##_reserve(&result, other->size); \
+            name##Iterator iterator = prefix##_iterator(other); \
+            key_type key; \
+            while (prefix##_next(&iterator, &key)) { \
+                usize index = prefix##_find(set, key, set->hash(key)); \
+                if (index != set->capacity) prefix##_insert(&result, set->keys[index]); \
+            } \
+            prefix##_free(set); \
+            *set = result; \
+            return; \
+        } \
+        for (usize i = 0; i < set->capacity; i++) { \
+            if (set->control[i] >= 0 && !prefix##_contains(other, set->keys[i])) { \
+                prefix##_erase(set, i); \
+            } \
+        } \
+    } \
+    \
+    void prefix##_difference(name *set, const name *other) { \
+        if (other->size < set->size) { \
+            name##Iterator iterator = prefix##_iterator(other); \
+            key_type key; \
+            while (prefix##_next(&iterator, &key)) { \
+                prefix##_remove(set, key); \
+            } \
+            return; \
+        } \
+        for (usize i = 0; i < set->capacity; i++) { \
+            if (set->control[i] >= 0 && prefix##_contains(other, set->keys[i])) { \
+                prefix##_erase(set, i); \
+            } \
+        } \
+    } \
+    \
+    name##Iterator prefix##_iterator(const name *set) { \
+        name##Iterator iterator = { \
+            .set = set, \
+            .index = 0 \
+        }; \
+        return iterator; \
+    } \
+    \
+    bool prefix##_next(name##Iterator *iterator, key_type *key) { \
+        const name *set = iterator->set; \
+        /* A group at a time, so sparse stretches are skipped 16 slots per load. */ \
+        while (iterator->index < set->capacity) { \
+            usize group = iterator->index & ~(usize)(FLAT_GROUP_WIDTH - 1); \
+            u32 live = ~flat_group_match_free(set->control + group) & ((1u << FLAT_GROUP_WIDTH) - 1); \
+            live &= ~0u << (iterator->index - group); \
+            if (live != 0) { \
+                usize index = group + flat_group_first(live); \
+                *key = set->keys[index]; \
+                iterator->index = index + 1; \
+                return true; \
+            } \
+            iterator->index = group + FLAT_GROUP_WIDTH; \
+        } \
+        return false; \
+    } \
+    \
+    void prefix##_reset(name *set) { \
+        memset(set->control, FLAT_CONTROL_EMPTY, set->capacity); \
+        set->size = 0; \
+        set->growth_left = set->capacity - set->capacity / 8; \
+    } \
+    \
+    void prefix##_free(name *set) { \
+        set->allocator->free(set->allocator, set->control); \
+        set->allocator->free(set->allocator, set->keys); \
+        set->control = NULL; \
+        set->keys = NULL; \
+        set->capacity = 0; \
+        set->size = 0; \
+        set->growth_left = 0; \
+    } \
+
+// -----------------------
+// --- Synchronization ---
+// -----------------------
+
+// Built on the GCC/Clang __atomic builtins. Waiters spin for a while and then yield, so a
+// lock held by a preempted thread does not burn a whole time slice.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
+typedef struct {
+    u32 locked;
+} SpinLock;
+
+static inline bool spin_lock_try(SpinLock *lock) {
+    return __atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void spin_lock_acquire(SpinLock *lock) {
+    u32 spins = 0;
+    while (!spin_lock_try(lock)) {
+        while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED) != 0) {
+            if (++spins < 64) {
+                CPU_RELAX();
+            } else {
+                sched_yield();
+            }
+        }
+    }
+}
+
+static inline void spin_lock_release(SpinLock *lock) {
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+// ------------------------------
+// --- Concurrent Hash Tables ---
+// ------------------------------
+
+// Open-addressing tables that any number of threads can read and write at once.
+//
+// Readers take no locks. Writers lock one of CONCURRENT_STRIPES stripes picked by the top
+// bits of the hash, so writers to different stripes run in parallel. Slots are claimed
+// with a CAS and published by a release store of their hash, after which their key never
+// changes. Overwriting a value bumps the stripe's sequence counter around the store and
+// readers retry until they copy the value between two equal even counts (a seqlock).
+// Removed slots become tombstones until the array fills up.
+//
+// Resizes lock every stripe. Readers count themselves in their stripe for the current
+// epoch (one of two) while they probe, and a resize moves the epoch on and waits for the
+// old one's counts to drop to zero, a grace period after which no reader can still hold
+// what the resize took away. Growing copies the live slots into a new array, publishes
+// it and frees the old one after the grace period; readers carry on meanwhile. An array
+// that is mostly tombstones is instead purged in place, with the epoch closed so readers
+// wait until the live slots have been moved back into the gaps.
+//
+// The table holds its stripes inline and must not be copied once it is shared.
+
+#define CONCURRENT_STRIPES 64
+#define CONCURRENT_SLOT_EMPTY 0
+#define CONCURRENT_SLOT_BUSY 1
+#define CONCURRENT_SLOT_DELETED 2
+#define CONCURRENT_SLOT_RESERVED 3
+
+#define CONCURRENT_EPOCH_CLOSED 2
+
+typedef struct {
+    SpinLock lock;
+    u32 sequence;
+    u32 readers[2];
+} CACHE_ALIGNED ConcurrentStripe;
+
+// Moves hashes off the values reserved for slot states.
+static inline u64 concurrent_slot_hash(u64 hash) {
+    return hash < CONCURRENT_SLOT_RESERVED ? hash + CONCURRENT_SLOT_RESERVED : hash;
+}
+
+static inline ConcurrentStripe *concurrent_stripe(ConcurrentStripe *stripes, u64 hash) {
+    return &stripes[hash >> 58];
+}
+
+static inline u32 concurrent_read_begin(ConcurrentStripe *stripe) {
+    u32 sequence;
+    while ((sequence = __atomic_load_n(&stripe->sequence, __ATOMIC_ACQUIRE)) & 1) {
+        CPU_RELAX();
+    }
+    return sequence;
+}
+
+static inline bool concurrent_read_retry(ConcurrentStripe *stripe, u32 sequence) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&stripe->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+// Counts a reader in for the current epoch and returns which of the two it joined. A
+// reader that counted itself in after the epoch moved on backs out and tries again, so
+// every reader the grace period misses sees whatever the resize published.
+static inline u32 concurrent_epoch_enter(ConcurrentStripe *stripe, u32 *epoch) {
+    u32 spins = 0;
+    for (;;) {
+        u32 current = __atomic_load_n(epoch, __ATOMIC_SEQ_CST);
+        if ((current & CONCURRENT_EPOCH_CLOSED) == 0) {
+            u32 side = current & 1;
+            __atomic_add_fetch(&stripe->readers[side], 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(epoch, __ATOMIC_SEQ_CST) == current) return side;
+            __atomic_sub_fetch(&stripe->readers[side], 1, __ATOMIC_RELEASE);
+        }
+        if (++spins < 64) {
+            CPU_RELAX();
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static inline void concurrent_epoch_leave(ConcurrentStripe *stripe, u32 side) {
+    __atomic_sub_fetch(&stripe->readers[side], 1, __ATOMIC_RELEASE);
+}
+
+// Moves the epoch on, closed or not, and waits out the readers of the old one. Callers
+// hold every stripe lock, so only one runs at a time and each starts with all readers in
+// the current epoch.
+static inline void concurrent_epoch_synchronize(ConcurrentStripe *stripes, u32 *epoch,
+                                                u32 closed) {
+    u32 side = __atomic_load_n(epoch, __ATOMIC_RELAXED) & 1;
+    __atomic_store_n(epoch, (side ^ 1) | closed, __ATOMIC_SEQ_CST);
+    for (usize i = 0; i < CONCURRENT_STRIPES; i++) {
+        u32 spins = 0;
+        while (__atomic_load_n(&stripes[i].readers[side], __ATOMIC_SEQ_CST) != 0) {
+            if (++spins < 64) {
+                CPU_RELAX();
+            } else {
+                sched_yield();
+            }
+        }
+    }
+}
+
+#define CONCURRENT_HASH_TABLE_DECLARE(name, prefix, key_type, value_type) \
+    typedef struct { \
+        u64 hash; \
+        key_type key; \
+        value_type value; \
+    } name##Slot; \
+    \
+    typedef struct { \
+        usize capacity; \
+        name##Slot slots[]; \
+    } name##Array; \
+    \
+    typedef struct { \
+        ConcurrentStripe stripes[CONCURRENT_STRIPES]; \
+        name##Array *array; \
+        u32 epoch; \
+        usize size; \
+        usize used; \
+        u64 (*hash)(key_type key); \
+        bool (*eq)(key_type a, key_type b); \
+        Allocator *allocator; \
+    } name; \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator); \
+    void prefix##_set(name *table, key_type key, value_type value); \
+    bool prefix##_try_get(name *table, key_type key, value_type *value); \
+    bool prefix##_contains(name *table, key_type key); \
+    value_type prefix##_get(name *table, key_type key); \
+    bool prefix##_remove(name *table, key_type key); \
+    usize prefix##_size(name *table); \
+    void prefix##_free(name *table); \
+
+#define CONCURRENT_HASH_TABLE_IMPLEMENT(name, prefix, key_type, value_type) \
+    static name##Array *prefix##_array_new(Allocator *allocator, usize capacity) { \
+        /* Zeroed memory leaves every slot EMPTY. */ \
+        name##Array *array = (name##Array *)allocator->alloc( \
+            allocator, sizeof(name##Array) + sizeof(name##Slot) * capacity); \
+        array->capacity = capacity; \
+        return array; \
+    } \
+    \
+    name prefix##_new(u64 (*hash)(key_type), bool (*eq)(key_type, key_type), Allocator *allocator) { \
+        name table = { \
+            .array = prefix##_array_new(allocator, 16), \
+            .hash = hash, \
+            .eq = eq, \
+            .allocator = allocator \
+        }; \
+        return table; \
+    } \
+    \
+    /* Returns the slot holding key, or NULL. */ \
+    static name##Slot *prefix##_find(name *table, name##Array *array, key_type key, u64 hash) { \
+        usize mask = array->capacity - 1; \
+        for (usize i = hash & mask;; i = (i + 1) & mask) { \
+            name##Slot *slot = &array->slots[i]; \
+            u64 slot_hash = __atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE); \
+            if (slot_hash == CONCURRENT_SLOT_EMPTY) return NULL; \
+            if (slot_hash == hash && table->eq(slot->key, key)) return slot; \
+        } \
+    } \
+    \
+    /* Drops the tombstones of an array no other thread is using. Going round from a slot */ \
+    /* that was already empty, so no probe sequence crosses it, each live slot is put back */ \
+    /* after every slot probed before it. */ \
+    static void prefix##_purge(name##Array *array) { \
+        usize mask = array->capacity - 1; \
+        usize start = 0; \
+        for (usize i = 0; i < array->capacity; i++) { \
+            if (array->slots[i].hash == CONCURRENT_SLOT_EMPTY) { \
+                start = i; \
+            } else if (array->slots[i].hash == CONCURRENT_SLOT_DELETED) { \
+                array->slots[i].hash = CONCURRENT_SLOT_EMPTY; \
+            } \
+        } \
+        \
+        for (usize n = 1; n < array->capacity; n++) { \
+            name##Slot *slot = &array->slots[(start + n) & mask]; \
+            if (slot->hash == CONCURRENT_SLOT_EMPTY) continue; \
+            name##Slot moved = *slot; \
+            slot->hash = CONCURRENT_SLOT_EMPTY; \
+            usize index = moved.hash & mask; \
+            while (array->slots[index].hash != CONCURRENT_SLOT_EMPTY) { \
+                index = (index + 1) & mask; \
+            } \
+            array->slots[index] = moved; \
+        } \
+    } \
+    \
+    static void prefix##_resize(name *table, name##Array *seen) { \
+        for (usize i = 0; i < CONCURRENT_STRIPES; i++) { \
+            spin_lock_acquire(&table->stripes[i].lock); \
+        } \
+        \
+        /* Another writer may have resized while we waited for the locks. */ \
+        name##Array *old_array = table->array; \
+        if (old_array == seen) { \
+            /* Size for at most 3/8 full. */ \
+            usize capacity = 16; \
+            while (capacity * 3 / 8 < table->size + 1) { \
+                capacity *= 2; \
+            } \
+            \
+            if (capacity <= old_array->capacity) { \
+                /* Mostly tombstones: purge them where they are, with readers kept out. */ \
+                concurrent_epoch_synchronize(table->stripes, &table->epoch, \
+                                             CONCURRENT_EPOCH_CLOSED); \
+                prefix##_purge(old_array); \
+                table->used = table->size; \
+                __atomic_store_n(&table->epoch, table->epoch & 1, __ATOMIC_RELEASE); \
+            } else { \
+                name##Array *array = prefix##_array_new(table->allocator, capacity); \
+                usize mask = capacity - 1; \
+                for (usize i = 0; i < old_array->capacity; i++) { \
+                    name##Slot *slot = &old_array->slots[i]; \
+                    if (slot->hash < CONCURRENT_SLOT_RESERVED) continue; \
+                    usize index = slot->hash & mask; \
+                    while (array->slots[index].hash != CONCURRENT_SLOT_EMPTY) { \
+                        index = (index + 1) & mask; \
+                    } \
+                    array->slots[index] = *slot; \
+                } \
+                \
+                table->used = table->size; \
+                __atomic_store_n(&table->array, array, __ATOMIC_RELEASE); \
+                concurrent_epoch_synchronize(table->stripes, &table->epoch, 0); \
+                table->allocator->free(table->allocator, old_array); \
+            } \
+        } \
+        \
+        for (usize i = CONCURRENT_STRIPES; i > 0; i--) { \
+            spin_lock_release(&table->stripes[i - 1].lock); \
+        } \
+    } \
+    \
+    void prefix##_set(name *table, key_type key, value_type value) { \
+        u64 hash = concurrent_slot_hash(table->hash(key)); \
+        ConcurrentStripe *stripe = concurrent_stripe(table->stripes, hash); \
+        \
+        for (;;) { \
+            spin_lock_acquire(&stripe->lock); \
+            /* Resizes hold every stripe lock, so the array cannot change under us. */ \
+            name##Array *array = table->array; \
+            \
+            name##Slot *slot = prefix##_find(table, array, key, hash); \
+            if (slot != NULL) { \
+                __atomic_store_n(&stripe->sequence, stripe->sequence + 1, __ATOMIC_RELAXED); \
+                __atomic_thread_fence(__ATOMIC_RELEASE); \
+                slot->value = value; \
+                __atomic_store_n(&stripe->sequence, stripe->sequence + 1, __ATOMIC_RELEASE); \
+                spin_lock_release(&stripe->lock); \
+                return; \
+            } \
+            \
+            usize used = __atomic_add_fetch(&table->used, 1, __ATOMIC_RELAXED); \
+            if (used > array->capacity * 3 / 4) { \
+                __atomic_sub_fetch(&table->used, 1, __ATOMIC_RELAXED); \
+                spin_lock_release(&stripe->lock); \
+                prefix##_resize(table, array); \
+                continue; \
+            } \
+            \
+            /* No other writer can insert this key, but writers from other stripes */ \
+            /* race for the same empty slots. The first empty slot is past any tombstone */ \
+            /* or copy of the key, since slots never become empty again. */ \
+            usize mask = array->capacity - 1; \
+            for (usize i = hash & mask;; i = (i + 1) & mask) { \
+                slot = &array->slots[i]; \
+                u64 expected = CONCURRENT_SLOT_EMPTY; \
+                if (__atomic_load_n(&slot->hash, __ATOMIC_RELAXED) == CONCURRENT_SLOT_EMPTY && \
+                    __atomic_compare_exchange_n(&slot->hash, &expected, CONCURRENT_SLOT_BUSY, false, \
+                                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) { \
+                    break; \
+                } \
+            } \
+            slot->key = key; \
+            slot->value = value; \
+            __atomic_store_n(&slot->hash, hash, __ATOMIC_RELEASE); \
+            __atomic_add_fetch(&table->size, 1, __ATOMIC_RELAXED); \
+            spin_lock_release(&stripe->lock); \
+            return; \
+        } \
+    } \
+    \
+    bool prefix##_try_get(name *table, key_type key, value_type *value) { \
+        u64 hash = concurrent_slot_hash(table->hash(key)); \
+        ConcurrentStripe *stripe = concurrent_stripe(table->stripes, hash); \
+        u32 side = concurrent_epoch_enter(stripe, &table->epoch); \
+        name##Array *array = __atomic_load_n(&table->array, __ATOMIC_ACQUIRE); \
+        name##Slot *slot = prefix##_find(table, array, key, hash); \
+        \
+        if (slot != NULL && value != NULL) { \
+            u32 sequence; \
+            do { \
+                sequence = concurrent_read_begin(stripe); \
+                *value = slot->value; \
+            } while (concurrent_read_retry(stripe, sequence)); \
+        } \
+        concurrent_epoch_leave(stripe, side); \
+        return slot != NULL; \
+    } \
+    \
+    bool prefix##_contains(name *table, key_type key) { \
+        return prefix##_try_get(table, key, NULL); \
+    } \
+    \
+    value_type prefix##_get(name *table, key_type key) { \
+        value_type value; \
+        bool found = prefix##_try_get(table, key, &value); \
+        ASSERT(found && "Key not found in hash table"); \
+        return value; \
+    } \
+    \
+    bool prefix##_remove(name *table, key_type key) { \
+        u64 hash = concurrent_slot_hash(table->hash(key)); \
+        ConcurrentStripe *stripe = concurrent_stripe(table->stripes, hash); \
+        \
+        spin_lock_acquire(&stripe->lock); \
+        name##Slot *slot = prefix##_find(table, table->array, key, hash); \
+        if (slot != NULL) { \
+            __atomic_store_n(&slot->hash, CONCURRENT_SLOT_DELETED, __ATOMIC_RELEASE); \
+            __atomic_sub_fetch(&table->size, 1, __ATOMIC_RELAXED); \
+        } \
+        spin_lock_release(&stripe->lock); \
+        return slot != NULL; \
+    } \
+    \
+    usize prefix##_size(name *table) { \
+        return __atomic_load_n(&table->size, __ATOMIC_RELAXED); \
+    } \
+    \
+    void prefix##_free(name *table) { \
+        table->allocator->free(table->allocator, table->array); \
+        table->array = NULL; \
+        table->size = 0; \
+        table->used = 0; \
+    } \
+
+// ------------------------
+// --- String Interning ---
+// ------------------------
+
+// Maps each distinct string to a dense u32 id, so equality becomes an integer compare and
+// tables can key on 4 bytes. The bytes of every string are copied once into an arena, NUL
+// terminated and prefixed with their u32 length, and stay put until interner_free.
+//
+// The index is open addressing. A slot packs the top 32 bits of the string hash, which
+// rule out almost every mismatch without touching the bytes, with the id plus one (0 marks
+// an empty slot), next to a pointer to the bytes so a hit costs no further indirection.
+// Lookups of strings that are already interned take no locks and can run on any number of
+// threads. Interning a new string takes a single lock; it is expected to be rare next to
+// lookups. Growing the index publishes a new array and retires the old one, which readers
+// may still be probing, until interner_reclaim (only while no other thread uses the
+// interner) or interner_free.
+//
+// Entries live in chunks that double in size and never move, so ids stay valid without a
+// lock. The interner must not be copied once it is shared.
+
+#define INTERNER_CHUNK_SIZE 1024
+#define INTERNER_MAX_CHUNKS 22
+#define INTERNER_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    const u8 *buffer;
+    usize length;
+    u64 hash;
+} InternerEntry;
+
+typedef struct {
+    u64 hash_id;
+    const u8 *buffer;
+} InternerSlot;
+
+typedef struct InternerIndex {
+    struct InternerIndex *retired_next;
+    usize capacity;
+    InternerSlot slots[];
+} InternerIndex;
+
+typedef struct {
+    SpinLock lock;
+    InternerIndex *index;
+    InternerIndex *retired;
+    InternerEntry *chunks[INTERNER_MAX_CHUNKS];
+    u32 count;
+    Arena arena;
+    Allocator *allocator;
+} Interner;
+
+Interner interner_new(Allocator *allocator);
+// Returns the id of str, copying it in on first sight.
+u32 interner_intern(Interner *interner, String str);
+u32 interner_intern_cstr(Interner *interner, const char *cstr);
+// Looks str up without interning it.
+bool interner_find(Interner *interner, String str, u32 *id);
+// The canonical copy of the string, owned by the interner.
+String interner_string(Interner *interner, u32 id);
+const char *interner_cstr(Interner *interner, u32 id);
+u32 interner_count(Interner *interner);
+void interner_reclaim(Interner *interner);
+void interner_free(Interner *interner);
+
+// -------------------
+// --- Thread Pool ---
+// -------------------
+
+// A fixed set of worker threads running tasks from per-worker Chase-Lev deques. A worker
+// pushes and pops its own deque at the bottom, newest first while the data is still in its
+// cache, and when it runs dry steals the oldest task from the top of someone else's.
+// Tasks spawned by threads outside the pool go through a shared queue.
+//
+//     ThreadPool pool;
+//     thread_pool_start(&pool, 0, &heap_allocator);
+//
+//     TaskGroup group = task_group_new(&pool);
+//     for (usize i = 0; i < files.length; i++) {
+//         task_group_spawn(&group, compress_file, &files.data[i]);
+//     }
+//     task_group_wait(&group);
+//
+//     parallel_for(&pool, 0, samples.length, 0, scale_samples, &samples);
+//     thread_pool_stop(&pool);
+//
+// Waiting never idles a thread: task_group_wait runs queued tasks until its group is
+// done, so tasks can spawn and wait on groups of their own. Tasks allocate temporaries
+// with scratch_begin, whose arenas are per thread and so never contended; each worker
+// frees its own when the pool stops. The pool and any group with tasks in flight must
+// stay at the same address.
+
+// A spawn that finds its worker's deque full runs the task inline instead.
+#define TASK_DEQUE_CAPACITY 4096
+
+typedef void (*TaskFunction)(void *context);
+
+typedef struct TaskGroup TaskGroup;
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    TaskFunction function;
+    void *context;
+    TaskGroup *group;
+} Task;
+
+// Thieves take from top and the owner works at bottom, on cache lines of their own.
+typedef struct {
+    i64 top CACHE_ALIGNED;
+    i64 bottom CACHE_ALIGNED;
+    Task *tasks;
+} TaskDeque;
+
+typedef struct {
+    TaskDeque deque;
+    ThreadPool *pool;
+    pthread_t thread;
+    u32 index;
+} CACHE_ALIGNED ThreadPoolWorker;
+
+struct ThreadPool {
+    ThreadPoolWorker *workers;
+    u32 worker_count;
+    SpinLock queue_lock;
+    Task *queue;
+    usize queue_head;
+    usize queue_length;
+    usize queue_capacity;
+    // Tasks queued anywhere, and workers asleep until there are some.
+    u64 pending;
+    u32 sleepers;
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    Allocator *allocator;
+};
+
+struct TaskGroup {
+    ThreadPool *pool;
+    u64 pending;
+};
+
+// A worker_count of 0 starts one worker per online CPU.
+void thread_pool_start(ThreadPool *pool, u32 worker_count, Allocator *allocator);
+// Runs whatever is still queued, then joins the workers.
+void thread_pool_stop(ThreadPool *pool);
+u32 thread_pool_worker_count(ThreadPool *pool);
+// The calling worker's index below thread_pool_worker_count, or -1 on a thread that is
+// not one of this pool's workers.
+i32 thread_pool_worker_index(ThreadPool *pool);
+
+TaskGroup task_group_new(ThreadPool *pool);
+void task_group_spawn(TaskGroup *group, TaskFunction function, void *context);
+void task_group_wait(TaskGroup *group);
+
+// Splits [start, end) into chunks of grain indices (0 picks about eight per thread) and
+// runs function on each, spread over the pool and the calling thread, returning once all
+// are done. Chunks are handed out from a shared counter, so uneven chunks balance out.
+//
+//     static void scale_samples(usize start, usize end, void *context) {
+//         F32Array *samples = context;
+//         for (usize i = start; i < end; i++) samples->data[i] *= 0.5f;
+//     }
+typedef void (*ParallelForFunction)(usize start, usize end, void *context);
+
+void parallel_for(ThreadPool *pool, usize start, usize end, usize grain,
+                  ParallelForFunction function, void *context);
+
+// Like parallel_for, but each task folds its chunks into a partial of partial_size bytes
+// that starts as a copy of *result, the identity, and the partials are combined into
+// *result on the calling thread once all chunks are done. combine has to be associative
+// and commutative, since which chunks land in which partial varies from run to run.
+typedef void (*ParallelReduceFunction)(usize start, usize end, void *partial, void *context);
+typedef void (*ParallelCombineFunction)(void *result, const void *partial, void *context);
+
+void parallel_reduce(ThreadPool *pool, usize start, usize end, usize grain,
+                     void *result, usize partial_size,
+                     ParallelReduceFunction reduce, ParallelCombineFunction combine, void *context);
+
+#endif // BASE_DECLARATIONS
+
+// --------------------------------------------------------------------------------------
+
+#ifdef BASE_IMPLEMENTATION
+#undef BASE_IMPLEMENTATION
+
+// ---------------
+// --- Testing ---
+// ---------------
+
+#ifdef TESTS_ENABLED
+
+static TestCase *test_registered = NULL;
+static THREAD_LOCAL TestCase *test_current = NULL;
+// The test in flight when it is the only one, which also takes failures from threads it
+// started itself.
+static TestCase *test_alone = NULL;
+static u32 test_unattributed_failures = 0;
+
+static struct {
+    regex_t filter;
+    bool filtered;
+    u32 jobs;
+    bool fork;
+    TestCase **tests;
+    usize count;
+    usize next;
+} test_state;
+
+void test_register(TestCase *test) {
+    test->next = test_registered;
+    test_registered = test;
+}
+
+void test_fail(const char *condition, const char *file, i32 line, const char *function) {
+    fprintf(stderr, "\tASSERTION FAILED: %s at %s:%d in %s()\n", condition, file, line, function);
+    TestCase *test = test_current != NULL ? test_current : __atomic_load_n(&test_alone, __ATOMIC_ACQUIRE);
+    if (test != NULL) {
+        __atomic_add_fetch(&test->failures, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&test_unattributed_failures, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static bool test_option(const char *arg, const char *option, const char **value) {
+    usize length = strlen(option);
+    if (strncmp(arg, option, length) != 0 || arg[length] != '=') return false;
+    *value = arg + length + 1;
+    return true;
+}
+
+// Constructors run in no particular order across files, so sort by where the tests are.
+static int test_compare(const void *a, const void *b) {
+    const TestCase *x = *(TestCase *const *)a;
+    const TestCase *y = *(TestCase *const *)b;
+    int files = strcmp(x->file, y->file);
+    if (files != 0) return files;
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static int test_compare_slowest(const void *a, const void *b) {
+    const TestCase *x = *(TestCase *const *)a;
+    const TestCase *y = *(TestCase *const *)b;
+    return (x->nanoseconds < y->nanoseconds) - (x->nanoseconds > y->nanoseconds);
+}
+
+static void test_run_one(TestCase *test) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (test_state.fork) {
+        // Flushed first so the child does not write out the parent's buffered output too.
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        ASSERT(pid >= 0);
+        if (pid == 0) {
+            test_current = test;
+            test_alone = test;
+            test->function();
+            fflush(stdout);
+            fflush(stderr);
+            _exit(test->failures > 255 ? 255 : (int)test->failures);
+        }
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        if (WIFSIGNALED(status)) {
+            test->signal = WTERMSIG(status);
+        } else {
+            test->failures = (u32)WEXITSTATUS(status);
+        }
+    } else {
+        test_current = test;
+        test->function();
+        test_current = NULL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    test->nanoseconds = (u64)(end.tv_sec - start.tv_sec) * 1000000000ULL + (u64)end.tv_nsec - (u64)start.tv_nsec;
+
+    u32 failures = __atomic_load_n(&test->failures, __ATOMIC_RELAXED);
+    const char *result = test->signal != 0 ? "CRASH" : failures != 0 ? "FAIL" : "PASS";
+    if (test->signal != 0) {
+        printf("%-5s %-48s %10.3f ms  (signal %d)\n", result, test->name, (f64)test->nanoseconds / 1e6, test->signal);
+    } else {
+        printf("%-5s %-48s %10.3f ms\n", result, test->name, (f64)test->nanoseconds / 1e6);
+    }
+    fflush(stdout);
+}
+
+static void *test_worker(void *argument) {
+    (void)argument;
+    for (;;) {
+        usize index = __atomic_fetch_add(&test_state.next, 1, __ATOMIC_RELAXED);
+        if (index >= test_state.count) break;
+        test_run_one(test_state.tests[index]);
+    }
+    // Tests may have used scratch arenas on this thread, like parallel_reduce does.
+    scratch_free();
+    return NULL;
+}
+
+int test_main(int argc, char **argv) {
+    bool list = false;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    test_state.jobs = cpus > 0 ? (u32)cpus : 1;
+    for (int i = 1; i < argc; i++) {
+        const char *value = NULL;
+        if (strcmp(argv[i], "--fork") == 0) {
+            test_state.fork = true;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else if (test_option(argv[i], "--jobs", &value)) {
+            test_state.jobs = (u32)strtoul(value, NULL, 10);
+            if (test_state.jobs == 0) test_state.jobs = 1;
+        } else if (test_option(argv[i], "--filter", &value)) {
+            if (regcomp(&test_state.filter, value, REG_EXTENDED | REG_NOSUB) != 0) {
+                fprintf(stderr, "Invalid filter %s\n", value);
+                return 1;
+            }
+            test_state.filtered = true;
+        } else {
+            // --help asks for the usage, anything else is a mistake.
+            bool help = strcmp(argv[i], "--help") == 0;
+            fprintf(help ? stdout : stderr,
+                    "Usage: %s [--filter=regex] [--jobs=n] [--fork] [--list] [--help]\n", argv[0]);
+            return help ? 0 : 1;
+        }
+    }
+
+    usize registered = 0;
+    for (TestCase *test = test_registered; test != NULL; test = test->next) registered++;
+    test_state.tests = (TestCase **)heap_allocator.alloc(&heap_allocator, sizeof(TestCase *) * (registered + 1));
+    for (TestCase *test = test_registered; test != NULL; test = test->next) {
+        if (test_state.filtered && regexec(&test_state.filter, test->name, 0, NULL, 0) != 0) continue;
+        test_state.tests[test_state.count++] = test;
+    }
+    qsort(test_state.tests, test_state.count, sizeof(TestCase *), test_compare);
+    if (test_state.filtered) regfree(&test_state.filter);
+
+    if (list) {
+        for (usize i = 0; i < test_state.count; i++) {
+            printf("%s\n", test_state.tests[i]->name);
+        }
+        heap_allocator.free(&heap_allocator, test_state.tests);
+        return 0;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    u32 jobs = test_state.jobs < test_state.count ? test_state.jobs : (u32)test_state.count;
+    if (jobs <= 1) {
+        for (usize i = 0; i < test_state.count; i++) {
+            __atomic_store_n(&test_alone, test_state.tests[i], __ATOMIC_RELEASE);
+            test_run_one(test_state.tests[i]);
+            __atomic_store_n(&test_alone, NULL, __ATOMIC_RELEASE);
+        }
+    } else {
+        pthread_t *threads = (pthread_t *)heap_allocator.alloc(&heap_allocator, sizeof(pthread_t) * jobs);
+        for (u32 i = 0; i < jobs; i++) {
+            ASSERT(pthread_create(&threads[i], NULL, test_worker, NULL) == 0);
+        }
+        for (u32 i = 0; i < jobs; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        heap_allocator.free(&heap_allocator, threads);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    f64 elapsed_ms = (f64)(end.tv_sec - start.tv_sec) * 1e3 + (f64)(end.tv_nsec - start.tv_nsec) / 1e6;
+
+    usize failed = 0;
+    for (usize i = 0; i < test_state.count; i++) {
+        if (test_state.tests[i]->failures != 0 || test_state.tests[i]->signal != 0) failed++;
+    }
+
+    printf("\n=== TEST SUMMARY ===\n");
+    qsort(test_state.tests, test_state.count, sizeof(TestCase *), test_compare_slowest);
+    usize slowest = test_state.count < 5 ? test_state.count : 5;
+    for (usize i = 0; i < slowest; i++) {
+        printf("Slowest: %-48s %10.3f ms\n", test_state.tests[i]->name, (f64)test_state.tests[i]->nanoseconds / 1e6);
+    }
+    if (test_unattributed_failures != 0) {
+        printf("%u assertion(s) failed on threads outside any test, rerun with --jobs=1 or --fork to attribute them\n",
+               test_unattributed_failures);
+    }
+    printf("Tests ran: %zu, Failed: %zu, Jobs: %u, Time: %.1f ms\n", test_state.count, failed, jobs, elapsed_ms);
+    bool passed = failed == 0 && test_unattributed_failures == 0;
+    printf("Overall: %s\n", passed ? "PASS" : "FAIL");
+    heap_allocator.free(&heap_allocator, test_state.tests);
+    return passed ? 0 : 1;
+}
+
+#else // TESTS_ENABLED
+
+void test_register(TestCase *test) {}
+void test_fail(const char *condition, const char *file, i32 line, const char *function) {}
+int test_main(int argc, char **argv) { return 0; }
+
+#endif // TESTS_ENABLED
+
+// --------------------
+// --- Benchmarking ---
+// --------------------
+
+u64 bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+void bench_latency_grow(BenchLatency *latency) {
+    latency->capacity = latency->capacity == 0 ? 4096 : latency->capacity * 2;
+    latency->samples = (u64 *)realloc(latency->samples, sizeof(u64) * latency->capacity);
+    ASSERT(latency->samples != NULL);
+}
+
+#ifndef __GNUC__
+volatile u64 _bench_sink = 0;
+#endif
+
+#ifdef BENCH_ENABLED
+
+typedef enum {
+    BENCH_FORMAT_TEXT,
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON
+} BenchFormat;
+
+typedef struct {
+    char name[64];
+    f64 median;
+} BenchBaseline;
+
+static struct {
+    BenchFormat format;
+    const char *filter;
+    u32 repetitions;
+    u64 min_time_ns;
+    f64 max_regression;
+    BenchBaseline *baselines;
+    usize baseline_count;
+    usize ran;
+    usize regressed;
+} bench_state = {
+    .format = BENCH_FORMAT_TEXT,
+    .repetitions = 10,
+    .min_time_ns = 10000000,
+    .max_regression = -1
+};
+
+static void bench_load_baseline(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open baseline %s\n", path);
+        exit(1);
+    }
+    // Expects the CSV written by --csv: name,iterations,min,median,...
+    char line[512];
+    usize capacity = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *comma = strchr(line, ',');
+        if (comma == NULL || strncmp(line, "name,", 5) == 0) continue;
+        char *median = comma;
+        for (u32 column = 0; column < 2 && median != NULL; column++) {
+            median = strchr(median + 1, ',');
+        }
+        if (median == NULL) continue;
+
+        if (bench_state.baseline_count == capacity) {
+            capacity = capacity == 0 ? 32 : capacity * 2;
+            bench_state.baselines = (BenchBaseline *)realloc(
+                bench_state.baselines, sizeof(BenchBaseline) * capacity);
+            ASSERT(bench_state.baselines != NULL);
+        }
+        BenchBaseline *baseline = &bench_state.baselines[bench_state.baseline_count++];
+        usize length = (usize)(comma - line);
+        if (length >= sizeof(baseline->name)) length = sizeof(baseline->name) - 1;
+        memcpy(baseline->name, line, length);
+        baseline->name[length] = '\0';
+        baseline->median = strtod(median + 1, NULL);
+    }
+    fclose(file);
+}
+
+static bool bench_option(const char *arg, const char *option, const char **value) {
+    usize length = strlen(option);
+    if (strncmp(arg, option, length) != 0 || arg[length] != '=') return false;
+    *value = arg + length + 1;
+    return true;
+}
+
+void bench_init(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *value = NULL;
+        if (strcmp(argv[i], "--csv") == 0) {
+            bench_state.format = BENCH_FORMAT_CSV;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            bench_state.format = BENCH_FORMAT_JSON;
+        } else if (bench_option(argv[i], "--filter", &value)) {
+            bench_state.filter = value;
+        } else if (bench_option(argv[i], "--repetitions", &value)) {
+            bench_state.repetitions = (u32)strtoul(value, NULL, 10);
+            if (bench_state.repetitions == 0) bench_state.repetitions = 1;
+        } else if (bench_option(argv[i], "--min-time-ms", &value)) {
+            bench_state.min_time_ns = (u64)(strtod(value, NULL) * 1e6);
+        } else if (bench_option(argv[i], "--baseline", &value)) {
+            bench_load_baseline(value);
+        } else if (bench_option(argv[i], "--max-regression", &value)) {
+            bench_state.max_regression = strtod(value, NULL);
+        } else {
+            bool help = strcmp(argv[i], "--help") == 0;
+            fprintf(help ? stdout : stderr,
+                    "Usage: %s [--csv | --json] [--filter=substring] [--repetitions=n]\n"
+                    "       [--min-time-ms=ms] [--baseline=file.csv] [--max-regression=percent]\n",
+                    argv[0]);
+            exit(help ? 0 : 1);
+        }
+    }
+
+    if (bench_state.format == BENCH_FORMAT_CSV) {
+        printf("name,iterations,ns_per_op_min,ns_per_op_median,ns_per_op_p99,"
+               "ops_per_sec,bytes_per_sec,ns_per_op_max\n");
+    } else if (bench_state.format == BENCH_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+static int bench_compare_f64(const void *a, const void *b) {
+    f64 x = *(const f64 *)a;
+    f64 y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+static int bench_compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+// Index of the sample at percentile p in count sorted samples, rounding up.
+static usize bench_percentile_index(usize count, f64 p) {
+    usize index = (usize)(p * (f64)count + 0.999999);
+    return index == 0 ? 0 : index - 1;
+}
+
+typedef struct {
+    u64 iterations;
+    f64 min;
+    f64 median;
+    f64 p99;
+    f64 p999;
+    f64 max;
+    f64 ops_per_sec;
+    f64 bytes_per_sec;
+} BenchResult;
+
+static void bench_report(const char *name, BenchResult *result, bool latency) {
+    if (bench_state.format == BENCH_FORMAT_CSV) {
+        printf("%s,%llu,%.3f,%.3f,%.3f,%.1f,%.1f,%.3f\n", name,
+               (unsigned long long)result->iterations, result->min, result->median,
+               result->p99, result->ops_per_sec, result->bytes_per_sec, result->max);
+    } else if (bench_state.format == BENCH_FORMAT_JSON) {
+        printf("%s\n  {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op_min\": %.3f, "
+               "\"ns_per_op_median\": %.3f, \"ns_per_op_p99\": %.3f, \"ops_per_sec\": %.1f, "
+               "\"bytes_per_sec\": %.1f, \"ns_per_op_max\": %.3f}",
+               bench_state.ran == 0 ? "" : ",", name, (unsigned long long)result->iterations,
+               result->min, result->median, result->p99, result->ops_per_sec,
+               result->bytes_per_sec, result->max);
+    } else if (latency) {
+        printf("%-40s %12.2f ns p50  p99 %10.2f  p99.9 %10.2f  max %12.2f",
+               name, result->median, result->p99, result->p999, result->max);
+    } else {
+        printf("%-40s %12.2f ns/op  min %10.2f  p99 %10.2f  %10.2f Mops/s",
+               name, result->median, result->min, result->p99, result->ops_per_sec * 1e-6);
+        if (result->bytes_per_sec != 0) {
+            printf("  %8.2f GB/s", result->bytes_per_sec * 1e-9);
+        }
+    }
+
+    for (usize i = 0; i < bench_state.baseline_count; i++) {
+        BenchBaseline *baseline = &bench_state.baselines[i];
+        if (strcmp(baseline->name, name) != 0) continue;
+        f64 delta = (result->median - baseline->median) / baseline->median * 100.0;
+        if (bench_state.format == BENCH_FORMAT_TEXT) {
+            printf("  %+7.1f%% vs baseline", delta);
+        }
+        if (bench_state.max_regression >= 0 && delta > bench_state.max_regression) {
+            fprintf(stderr, "REGRESSION: %s is %.1f%% slower than baseline\n", name, delta);
+            bench_state.regressed++;
+        }
+        break;
+    }
+    if (bench_state.format == BENCH_FORMAT_TEXT) {
+        printf("\n");
+    }
+    fflush(stdout);
+    bench_state.ran++;
+}
+
+static u64 bench_measure(void (*bench)(Bench *), u64 iterations, Bench *state) {
+    Bench run = {
+        .iterations = iterations,
+        .items_per_op = 1
+    };
+    bench(&run);
+    ASSERT(run.end_ns != 0 && "Benchmark has no BENCH_LOOP");
+    *state = run;
+    return run.end_ns - run.start_ns;
+}
+
+void bench_run(const char *name, void (*bench)(Bench *)) {
+    if (bench_state.filter != NULL && strstr(name, bench_state.filter) == NULL) return;
+
+    // Grow the iteration count until a single run reaches the minimum time.
+    Bench run;
+    u64 iterations = 1;
+    u64 elapsed = bench_measure(bench, iterations, &run);
+    while (elapsed < bench_state.min_time_ns) {
+        f64 scale = elapsed == 0 ? 100.0 : 1.4 * (f64)bench_state.min_time_ns / (f64)elapsed;
+        if (scale > 100.0) scale = 100.0;
+        if (scale < 2.0) scale = 2.0;
+        iterations = (u64)((f64)iterations * scale);
+        elapsed = bench_measure(bench, iterations, &run);
+    }
+
+    u32 repetitions = bench_state.repetitions;
+    f64 *samples = (f64 *)malloc(sizeof(f64) * repetitions);
+    ASSERT(samples != NULL);
+    for (u32 i = 0; i < repetitions; i++) {
+        elapsed = bench_measure(bench, iterations, &run);
+        samples[i] = (f64)elapsed / (f64)(iterations * run.items_per_op);
+    }
+    qsort(samples, repetitions, sizeof(f64), bench_compare_f64);
+
+    BenchResult result = {
+        .iterations = iterations,
+        .min = samples[0],
+        .median = samples[repetitions / 2],
+        .p99 = samples[bench_percentile_index(repetitions, 0.99)],
+        .max = samples[repetitions - 1],
+        .ops_per_sec = 1e9 / samples[repetitions / 2]
+    };
+    result.bytes_per_sec = run.bytes_per_op == 0
+        ? 0 : (f64)run.bytes_per_op / (f64)run.items_per_op * result.ops_per_sec;
+    free(samples);
+
+    bench_report(name, &result, false);
+}
+
+void bench_run_latency(const char *name, void (*bench)(BenchLatency *)) {
+    if (bench_state.filter != NULL && strstr(name, bench_state.filter) == NULL) return;
+
+    BenchLatency latency = {0};
+    for (u32 i = 0; i < bench_state.repetitions; i++) {
+        bench(&latency);
+    }
+    ASSERT(latency.count != 0 && "Latency benchmark has no BENCH_SAMPLE");
+    qsort(latency.samples, latency.count, sizeof(u64), bench_compare_u64);
+
+    u64 total = 0;
+    for (usize i = 0; i < latency.count; i++) {
+        total += latency.samples[i];
+    }
+
+    usize count = latency.count;
+    BenchResult result = {
+        .iterations = count,
+        .min = (f64)latency.samples[0],
+        .median = (f64)latency.samples[count / 2],
+        .p99 = (f64)latency.samples[bench_percentile_index(count, 0.99)],
+        .p999 = (f64)latency.samples[bench_percentile_index(count, 0.999)],
+        .max = (f64)latency.samples[count - 1],
+        .ops_per_sec = total == 0 ? 0 : 1e9 * (f64)count / (f64)total
+    };
+    free(latency.samples);
+
+    bench_report(name, &result, true);
+}
+
+int BENCH_RESULTS(void) {
+    if (bench_state.format == BENCH_FORMAT_JSON) {
+        printf("\n]\n");
+    } else if (bench_state.format == BENCH_FORMAT_TEXT) {
+        printf("\n=== BENCH SUMMARY ===\n");
+        printf("Benchmarks ran: %zu, Regressed: %zu\n", bench_state.ran, bench_state.regressed);
+    }
+    free(bench_state.baselines);
+    return bench_state.regressed != 0;
+}
+
+#else // BENCH_ENABLED
+
+void bench_init(int argc, char **argv) {}
+void bench_run(const char *name, void (*bench)(Bench *)) {}
+void bench_run_latency(const char *name, void (*bench)(BenchLatency *)) {}
+int BENCH_RESULTS(void) { return 0; }
+
+#endif // BENCH_ENABLED
+
+// -------------------------
+// --- Memory Allocation ---
+// -------------------------
+
+void *heap_allocator_alloc(Allocator *allocator, usize size) {
+    // calloc can hand out fresh pages from the OS without touching them.
+    void *ptr = calloc(1, size);
+    ASSERT(ptr != NULL);
+    return ptr;
+}
+
+void *heap_allocator_alloc_uninit(Allocator *allocator, usize size) {
+    void *ptr = malloc(size);
+    ASSERT(ptr != NULL);
+    return ptr;
+}
+
+void *heap_allocator_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
+    void *new_ptr = realloc(ptr, new_size);
+    ASSERT(new_ptr != NULL);
+    return new_ptr;
+}
+
+void heap_allocator_free(Allocator *allocator, void *ptr) {
+    free(ptr);
+}
+
+void *heap_allocator_alloc_aligned(Allocator *allocator, usize size, usize alignment) {
+    if (alignment <= ALIGNMENT_DEFAULT) {
+        return heap_allocator_alloc_uninit(allocator, size);
+    }
+    // posix_memalign rather than aligned_alloc, which is C11 and wants size to be a multiple
+    // of the alignment. Both are released with plain free.
+    void *ptr = NULL;
+    int result = posix_memalign(&ptr, alignment, size);
+    ASSERT(result == 0);
+    return ptr;
+}
+
+Allocator heap_allocator = {
+    heap_allocator_alloc,
+    heap_allocator_realloc,
+    heap_allocator_free,
+    heap_allocator_alloc_uninit,
+    heap_allocator_alloc_aligned
+};
+
+void *arena_allocator_alloc(Allocator *allocator, usize size) {
+    Arena *arena = (Arena *)allocator;
+    return arena_alloc(arena, size);
+}
+
+void *arena_allocator_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
+    Arena *arena = (Arena *)allocator;
+    return arena_realloc(arena, ptr, old_size, new_size);
+}
+
+void arena_allocator_free(Allocator *allocator, void *ptr) {}
+
+void *arena_allocator_alloc_uninit(Allocator *allocator, usize size) {
+    Arena *arena = (Arena *)allocator;
+    return arena_alloc_uninit(arena, size);
+}
+
+void *arena_allocator_alloc_aligned(Allocator *allocator, usize size, usize alignment) {
+    Arena *arena = (Arena *)allocator;
+    return arena_alloc_aligned(arena, size, alignment);
+}
+
+static const Allocator arena_allocator_interface = {
+    .alloc = arena_allocator_alloc,
+    .realloc = arena_allocator_realloc,
+    .free = arena_allocator_free,
+    .alloc_uninit = arena_allocator_alloc_uninit,
+    .alloc_aligned = arena_allocator_alloc_aligned
+};
+
+Arena arena_new(usize capacity, Allocator *backing_allocator) {
+    Arena arena = {
+        .allocator = arena_allocator_interface,
+        .backing_allocator = backing_allocator,
+        .buffer = (u8 *)allocator_alloc_uninit(backing_allocator, capacity),
+        .capacity = capacity
+    };
+    arena.first_buffer = arena.buffer;
+    arena.first_capacity = arena.capacity;
+    return arena;
+}
+
+Arena arena_new_growable(usize block_size, usize max_block_size, ArenaResetPolicy reset_policy,
+                         Allocator *backing_allocator) {
+    ASSERT(block_size > 0);
+    ASSERT(block_size <= max_block_size);
+    Arena arena = arena_new(block_size, backing_allocator);
+    arena.block_size = block_size * 2 < max_block_size ? block_size * 2 : max_block_size;
+    arena.max_block_size = max_block_size;
+    arena.reset_policy = reset_policy;
+    arena.growable = true;
+    return arena;
+}
+
+Arena arena_new_virtual(usize reserve_size, usize retain_size, ArenaVirtualFlags flags) {
+    usize commit_size = flags == ARENA_VIRTUAL_DEFAULT ? ARENA_COMMIT_SIZE : ARENA_HUGE_PAGE_SIZE;
+    usize reserved = align_up(reserve_size, commit_size);
+
+    void *buffer = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // Without MAP_NORESERVE the pool pages are set aside up front, so this fails cleanly
+    // here rather than with SIGBUS on first touch when the pool runs dry.
+    if (flags & ARENA_VIRTUAL_HUGETLB) {
+        buffer = mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (buffer == MAP_FAILED) {
+        buffer = mmap(NULL, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    ASSERT(buffer != MAP_FAILED && "Could not reserve address space");
+#ifdef MADV_HUGEPAGE
+    if (flags & ARENA_VIRTUAL_HUGE_PAGES) {
+        madvise(buffer, reserved, MADV_HUGEPAGE);
+    }
+#endif
+
+    Arena arena = {
+        .allocator = arena_allocator_interface,
+        .buffer = (u8 *)buffer,
+        .first_buffer = (u8 *)buffer,
+        .reserved = reserved,
+        .retain = align_up(retain_size, commit_size),
+        .commit_size = commit_size,
+        .virtual_memory = true
+    };
+    return arena;
+}
+
+// Commits the reserved range up to at least size bytes, returns false past the reservation.
+static bool arena_commit(Arena *arena, usize size) {
+    if (size > arena->reserved) return false;
+    usize capacity = align_up(size, arena->commit_size);
+    if (capacity > arena->reserved) capacity = arena->reserved;
+    int result = mprotect(arena->buffer + arena->capacity, capacity - arena->capacity,
+                          PROT_READ | PROT_WRITE);
+    ASSERT(result == 0 && "Could not commit arena memory");
+    arena->capacity = capacity;
+    arena->first_capacity = capacity;
+    return true;
+}
+
+static void arena_decommit(Arena *arena, usize size) {
+    usize capacity = align_up(size, arena->commit_size);
+    if (capacity >= arena->capacity) return;
+    // DONTNEED drops the pages, PROT_NONE makes touching them again an error.
+    madvise(arena->buffer + capacity, arena->capacity - capacity, MADV_DONTNEED);
+    mprotect(arena->buffer + capacity, arena->capacity - capacity, PROT_NONE);
+    arena->capacity = capacity;
+    arena->first_capacity = capacity;
+}
+
+static void arena_next_block(Arena *arena, usize size) {
+    ArenaBlock *block = NULL;
+    for (ArenaBlock **link = &arena->free_blocks; *link != NULL; link = &(*link)->next) {
+        if ((*link)->capacity >= size) {
+            block = *link;
+            *link = block->next;
+            break;
+        }
+    }
+
+    if (block == NULL) {
+        usize capacity = arena->block_size < size ? size : arena->block_size;
+        block = (ArenaBlock *)allocator_alloc_uninit(
+            arena->backing_allocator, align_up(sizeof(ArenaBlock), ALIGNMENT_DEFAULT) + capacity);
+        block->capacity = capacity;
+        arena->block_size *= 2;
+        if (arena->block_size > arena->max_block_size) {
+            arena->block_size = arena->max_block_size;
+        }
+    }
+
+    block->next = arena->block;
+    arena->block = block;
+    arena->buffer = (u8 *)block + align_up(sizeof(ArenaBlock), ALIGNMENT_DEFAULT);
+    arena->capacity = block->capacity;
+    arena->offset = 0;
+}
+
+void *arena_alloc_aligned(Arena *arena, usize size, usize alignment) {
+    ASSERT(arena->buffer != NULL);
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    // Align the address rather than the offset, the buffer itself may be unaligned when
+    // it came from another arena.
+    usize address = (usize)(arena->buffer + arena->offset);
+    usize padding = align_up(address, alignment) - address;
+    if (arena->offset + padding + size > arena->capacity) {
+        if (arena->virtual_memory) {
+            bool committed = arena_commit(arena, arena->offset + padding + size);
+            ASSERT(committed && "Arena is out of memory");
+            void *ptr = arena->buffer + arena->offset + padding;
+            arena->offset += padding + size;
+            arena->last_alloc = ptr;
+            return ptr;
+        }
+        ASSERT(arena->growable && "Arena is out of memory");
+        // New blocks start ALIGNMENT_DEFAULT aligned, only stricter alignments need slack.
+        arena_next_block(arena, alignment <= ALIGNMENT_DEFAULT ? size : size + alignment - 1);
+        address = (usize)arena->buffer;
+        padding = align_up(address, alignment) - address;
+    }
+    void *ptr = arena->buffer + arena->offset + padding;
+    arena->offset += padding + size;
+    arena->last_alloc = ptr;
+    return ptr;
+}
+
+void *arena_alloc_uninit(Arena *arena, usize size) {
+    return arena_alloc_aligned(arena, size, align_for_size(size));
+}
+
+void *arena_alloc(Arena *arena, usize size) {
+    void *ptr = arena_alloc_uninit(arena, size);
+    memset(ptr, 0, size);
+    return ptr;
+}
 
 void *arena_realloc(Arena *arena, void *ptr, usize old_size, usize new_size) {
     ASSERT(arena->buffer != NULL);
     ASSERT(ptr != NULL);
-    i64 difference = new_size - old_size;
 
-    if (ptr == arena->last_alloc) {
-        if (difference <= 0) {
-            arena->offset -= difference;
-            return ptr;
-        }
-        else {
-            ASSERT(arena->offset + difference <= arena->capacity);
-            memset(ptr + old_size, 0, difference);
-            arena->offset += difference;
-            return ptr;
-        }
+    if (ptr == arena->last_alloc) {
+        usize start = (u8 *)ptr - arena->buffer;
+        if (start + new_size <= arena->capacity ||
+            (arena->virtual_memory && arena_commit(arena, start + new_size))) {
+            arena->offset = start + new_size;
+            return ptr;
+        }
+    }
+    else if (new_size <= old_size) {
+        return ptr;
+    }
+
+    void *new_ptr = arena_alloc_uninit(arena, new_size);
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    return new_ptr;
+}
+
+ArenaMark arena_mark(Arena *arena) {
+    ArenaMark mark = {
+        .block = arena->block,
+        .offset = arena->offset
+    };
+    return mark;
+}
+
+void arena_restore(Arena *arena, ArenaMark mark) {
+    ASSERT(arena->block != mark.block || mark.offset <= arena->offset);
+    ArenaBlock *block = arena->block;
+    while (block != mark.block) {
+        ASSERT(block != NULL && "Arena mark is not in this arena");
+        ArenaBlock *next = block->next;
+        if (arena->reset_policy == ARENA_RESET_RELEASE) {
+            arena->backing_allocator->free(arena->backing_allocator, block);
+        } else {
+            block->next = arena->free_blocks;
+            arena->free_blocks = block;
+        }
+        block = next;
+    }
+    arena->block = block;
+    if (block == NULL) {
+        arena->buffer = arena->first_buffer;
+        arena->capacity = arena->first_capacity;
+    } else {
+        arena->buffer = (u8 *)block + align_up(sizeof(ArenaBlock), ALIGNMENT_DEFAULT);
+        arena->capacity = block->capacity;
+    }
+    arena->offset = mark.offset;
+    arena->last_alloc = NULL;
+}
+
+void arena_reset(Arena *arena) {
+    arena_restore(arena, (ArenaMark){0});
+    if (arena->virtual_memory) {
+        arena_decommit(arena, arena->retain);
+    }
+}
+
+void arena_free(Arena *arena) {
+    if (arena->virtual_memory) {
+        munmap(arena->buffer, arena->reserved);
+        arena->first_buffer = NULL;
+        arena->first_capacity = 0;
+        arena->buffer = NULL;
+        arena->capacity = 0;
+        arena->offset = 0;
+        arena->reserved = 0;
+        return;
+    }
+    arena->reset_policy = ARENA_RESET_RELEASE;
+    arena_reset(arena);
+    for (ArenaBlock *block = arena->free_blocks; block != NULL;) {
+        ArenaBlock *next = block->next;
+        arena->backing_allocator->free(arena->backing_allocator, block);
+        block = next;
+    }
+    arena->free_blocks = NULL;
+    arena->backing_allocator->free(arena->backing_allocator, arena->first_buffer);
+    arena->first_buffer = NULL;
+    arena->first_capacity = 0;
+    arena->buffer = NULL;
+    arena->capacity = 0;
+    arena->offset = 0;
+}
+
+static THREAD_LOCAL Arena scratch_arenas[SCRATCH_ARENA_COUNT];
+
+Scratch scratch_begin(Arena **conflicts, usize count) {
+    for (usize i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+        Arena *arena = &scratch_arenas[i];
+        bool conflicting = false;
+        for (usize j = 0; j < count; j++) {
+            if (conflicts[j] == arena) {
+                conflicting = true;
+                break;
+            }
+        }
+        if (conflicting) continue;
+
+        if (arena->first_buffer == NULL) {
+            *arena = arena_new_growable(SCRATCH_BLOCK_SIZE, SCRATCH_MAX_BLOCK_SIZE,
+                                        ARENA_RESET_RETAIN, &heap_allocator);
+        }
+        Scratch scratch = {
+            .arena = arena,
+            .mark = arena_mark(arena)
+        };
+        return scratch;
+    }
+    ASSERT(false && "Every scratch arena conflicts, raise SCRATCH_ARENA_COUNT");
+    return (Scratch){0};
+}
+
+void scratch_end(Scratch scratch) {
+    arena_restore(scratch.arena, scratch.mark);
+}
+
+void scratch_free(void) {
+    for (usize i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+        if (scratch_arenas[i].first_buffer != NULL) {
+            arena_free(&scratch_arenas[i]);
+        }
+    }
+}
+
+static void *pool_large_alloc(Pool *pool, usize size, usize alignment) {
+    usize header = align_up(sizeof(PoolLarge), alignment);
+    u8 *base = (u8 *)allocator_alloc_aligned(pool->backing_allocator, header + size, alignment);
+    PoolLarge *large = (PoolLarge *)(base + header) - 1;
+    large->base = base;
+    large->next = pool->large;
+    pool->large = large;
+    return base + header;
+}
+
+// Unlinks ptr from the large allocations, returns false if it is a pool object instead.
+static bool pool_large_remove(Pool *pool, void *ptr) {
+    for (PoolLarge **link = &pool->large; *link != NULL; link = &(*link)->next) {
+        PoolLarge *large = *link;
+        if ((void *)(large + 1) == ptr) {
+            *link = large->next;
+            pool->backing_allocator->free(pool->backing_allocator, large->base);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool pool_owns_large(Pool *pool, void *ptr) {
+    for (PoolLarge *large = pool->large; large != NULL; large = large->next) {
+        if ((void *)(large + 1) == ptr) return true;
+    }
+    return false;
+}
+
+void *pool_allocator_alloc(Allocator *allocator, usize size) {
+    Pool *pool = (Pool *)allocator;
+    if (size <= pool->object_size) return pool_alloc(pool);
+    void *ptr = pool_large_alloc(pool, size, ALIGNMENT_DEFAULT);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void *pool_allocator_alloc_uninit(Allocator *allocator, usize size) {
+    Pool *pool = (Pool *)allocator;
+    if (size <= pool->object_size) return pool_alloc_uninit(pool);
+    return pool_large_alloc(pool, size, ALIGNMENT_DEFAULT);
+}
+
+void *pool_allocator_alloc_aligned(Allocator *allocator, usize size, usize alignment) {
+    Pool *pool = (Pool *)allocator;
+    if (size <= pool->object_size && alignment <= align_for_size(pool->stride)) {
+        return pool_alloc_uninit(pool);
+    }
+    return pool_large_alloc(pool, size, alignment < ALIGNMENT_DEFAULT ? ALIGNMENT_DEFAULT : alignment);
+}
+
+void *pool_allocator_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
+    Pool *pool = (Pool *)allocator;
+    bool large = pool_owns_large(pool, ptr);
+    if (!large && new_size <= pool->object_size) return ptr;
+
+    void *new_ptr = pool_allocator_alloc_uninit(allocator, new_size);
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    if (large) {
+        pool_large_remove(pool, ptr);
+    } else {
+        pool_release(pool, ptr);
+    }
+    return new_ptr;
+}
+
+void pool_allocator_free(Allocator *allocator, void *ptr) {
+    Pool *pool = (Pool *)allocator;
+    if (ptr == NULL) return;
+    if (pool->large != NULL && pool_large_remove(pool, ptr)) return;
+    pool_release(pool, ptr);
+}
+
+Pool pool_new(usize object_size, usize objects_per_slab, Allocator *backing_allocator) {
+    ASSERT(object_size > 0);
+    ASSERT(objects_per_slab > 0);
+    // Free objects hold the free list link, so they need room for a pointer.
+    usize stride = align_up(object_size < sizeof(void *) ? sizeof(void *) : object_size,
+                            sizeof(void *));
+    Pool pool = {
+        .allocator = {
+            .alloc = pool_allocator_alloc,
+            .realloc = pool_allocator_realloc,
+            .free = pool_allocator_free,
+            .alloc_uninit = pool_allocator_alloc_uninit,
+            .alloc_aligned = pool_allocator_alloc_aligned
+        },
+        .backing_allocator = backing_allocator,
+        .object_size = object_size,
+        .stride = stride,
+        .objects_per_slab = objects_per_slab
+    };
+    return pool;
+}
+
+static void pool_next_slab(Pool *pool) {
+    usize header = align_up(sizeof(PoolSlab), ALIGNMENT_DEFAULT);
+    PoolSlab *slab = pool->spare_slabs;
+    if (slab != NULL) {
+        pool->spare_slabs = slab->next;
+    } else {
+        slab = (PoolSlab *)allocator_alloc_uninit(
+            pool->backing_allocator, header + pool->stride * pool->objects_per_slab);
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->bump = (u8 *)slab + header;
+    pool->bump_end = pool->bump + pool->stride * pool->objects_per_slab;
+}
+
+void *pool_alloc_uninit(Pool *pool) {
+    void *ptr = pool->free_list;
+    if (ptr != NULL) {
+        pool->free_list = *(void **)ptr;
+        return ptr;
+    }
+    // Carve lazily instead of threading a whole new slab onto the free list up front.
+    if (pool->bump == pool->bump_end) {
+        pool_next_slab(pool);
+    }
+    ptr = pool->bump;
+    pool->bump += pool->stride;
+    return ptr;
+}
+
+void *pool_alloc(Pool *pool) {
+    void *ptr = pool_alloc_uninit(pool);
+    memset(ptr, 0, pool->object_size);
+    return ptr;
+}
+
+void pool_release(Pool *pool, void *ptr) {
+    ASSERT(ptr != NULL);
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+}
+
+void pool_reset(Pool *pool) {
+    while (pool->large != NULL) {
+        PoolLarge *large = pool->large;
+        pool->large = large->next;
+        pool->backing_allocator->free(pool->backing_allocator, large->base);
+    }
+    while (pool->slabs != NULL) {
+        PoolSlab *slab = pool->slabs;
+        pool->slabs = slab->next;
+        slab->next = pool->spare_slabs;
+        pool->spare_slabs = slab;
+    }
+    pool->free_list = NULL;
+    pool->bump = NULL;
+    pool->bump_end = NULL;
+}
+
+void pool_free(Pool *pool) {
+    pool_reset(pool);
+    while (pool->spare_slabs != NULL) {
+        PoolSlab *slab = pool->spare_slabs;
+        pool->spare_slabs = slab->next;
+        pool->backing_allocator->free(pool->backing_allocator, slab);
+    }
+}
+
+// Sits right before the user pointer, offset bytes after the start of the backing block.
+typedef struct {
+    usize size;
+    u32 site;
+    u32 offset;
+} TrackingHeader;
+
+// Slot ownership is shared by every tracker: a thread claims one of the first
+// TRACKING_SLOTS - 1 slots on its first tracked allocation and hands it back when it
+// exits. The last slot is left for the threads that found none free.
+static u8 tracking_slot_owned[TRACKING_SLOTS];
+static THREAD_LOCAL u32 tracking_thread_slot = 0;
+static pthread_once_t tracking_slot_once = PTHREAD_ONCE_INIT;
+static pthread_key_t tracking_slot_key;
+
+// An owner updates its slot with plain relaxed stores, the threads sharing the last slot
+// need atomic read-modify-writes.
+#define TRACKING_ADD(counter, value, exclusive) do { \
+    if (exclusive) { \
+        __atomic_store_n((counter), __atomic_load_n((counter), __ATOMIC_RELAXED) + (value), \
+                         __ATOMIC_RELAXED); \
+    } else { \
+        __atomic_add_fetch((counter), (value), __ATOMIC_RELAXED); \
+    } \
+} while(0)
+
+// Runs at thread exit. Anything the thread allocates from a later key destructor goes
+// through the shared slot, since the released one may already have a new owner.
+static void tracking_release_slot(void *slot) {
+    tracking_thread_slot = TRACKING_SLOTS;
+    __atomic_store_n(&tracking_slot_owned[(usize)slot - 1], 0, __ATOMIC_RELEASE);
+}
+
+static void tracking_create_slot_key(void) {
+    pthread_key_create(&tracking_slot_key, tracking_release_slot);
+}
+
+static TrackingSlot *tracking_slot(TrackingAllocator *tracker, bool *exclusive) {
+    if (tracking_thread_slot == 0) {
+        tracking_thread_slot = TRACKING_SLOTS;
+        for (u32 i = 0; i + 1 < TRACKING_SLOTS; i++) {
+            u8 expected = 0;
+            if (__atomic_load_n(&tracking_slot_owned[i], __ATOMIC_RELAXED) == 0 &&
+                __atomic_compare_exchange_n(&tracking_slot_owned[i], &expected, 1, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                pthread_once(&tracking_slot_once, tracking_create_slot_key);
+                pthread_setspecific(tracking_slot_key, (void *)(usize)(i + 1));
+                tracking_thread_slot = i + 1;
+                break;
+            }
+        }
+    }
+    *exclusive = tracking_thread_slot < TRACKING_SLOTS;
+    return &tracker->slots[tracking_thread_slot - 1];
+}
+
+static u32 tracking_size_class(usize size) {
+    if (size == 0) return 0;
+#if defined(__GNUC__)
+    u32 size_class = 64 - (u32)__builtin_clzll((unsigned long long)size);
+#else
+    u32 size_class = 0;
+    for (usize rest = size; rest != 0; rest >>= 1) {
+        size_class++;
+    }
+#endif
+    return size_class < TRACKING_SIZE_CLASSES ? size_class : TRACKING_SIZE_CLASSES - 1;
+}
+
+static void tracking_flush(TrackingAllocator *tracker, TrackingSlot *slot, i64 delta,
+                           bool exclusive) {
+    TRACKING_ADD(&slot->pending_bytes, delta, exclusive);
+    i64 pending = __atomic_load_n(&slot->pending_bytes, __ATOMIC_RELAXED);
+    if (pending < TRACKING_FLUSH_BYTES && pending > -TRACKING_FLUSH_BYTES) return;
+
+    pending = __atomic_exchange_n(&slot->pending_bytes, 0, __ATOMIC_RELAXED);
+    i64 live = __atomic_add_fetch(&tracker->live_bytes, pending, __ATOMIC_RELAXED);
+    i64 peak = __atomic_load_n(&tracker->peak_bytes, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&tracker->peak_bytes, &peak, live, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Finds or claims the site for file:line. Site 0 stands for untagged allocations and sites
+// past TRACKING_MAX_SITES, its counters are derived from the totals rather than kept.
+static u32 tracking_site(TrackingAllocator *tracker, const char *file, u32 line) {
+    if (file == NULL) return 0;
+    u64 hash = integer_hash((u64)(usize)file ^ ((u64)line << 32));
+    for (u32 probe = 0; probe < TRACKING_MAX_SITES - 1; probe++) {
+        u32 index = 1 + (u32)((hash + probe) % (TRACKING_MAX_SITES - 1));
+        TrackingSite *site = &tracker->sites[index];
+        const char *site_file = __atomic_load_n(&site->file, __ATOMIC_ACQUIRE);
+        if (site_file == NULL) {
+            // Claim the line first, racing threads wait for the file to be published.
+            u32 expected = 0;
+            if (__atomic_compare_exchange_n(&site->line, &expected, line, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&site->file, file, __ATOMIC_RELEASE);
+                return index;
+            }
+            while ((site_file = __atomic_load_n(&site->file, __ATOMIC_ACQUIRE)) == NULL) {
+                CPU_RELAX();
+            }
+        }
+        if (site_file == file && site->line == line) return index;
+    }
+    return 0;
+}
+
+static void *tracking_record(TrackingAllocator *tracker, u8 *base, usize size, usize offset,
+                             u32 site) {
+    TrackingHeader *header = (TrackingHeader *)(base + offset) - 1;
+    header->size = size;
+    header->site = site;
+    header->offset = (u32)offset;
+
+    bool exclusive;
+    TrackingSlot *slot = tracking_slot(tracker, &exclusive);
+    TRACKING_ADD(&slot->allocs, 1, exclusive);
+    TRACKING_ADD(&slot->allocated_bytes, size, exclusive);
+    TRACKING_ADD(&slot->size_classes[tracking_size_class(size)], 1, exclusive);
+    tracking_flush(tracker, slot, (i64)size, exclusive);
+
+    if (site != 0) {
+        TrackingSite *tracked = &tracker->sites[site];
+        __atomic_add_fetch(&tracked->allocs, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&tracked->live_bytes, size, __ATOMIC_RELAXED);
+    }
+    return base + offset;
+}
+
+static TrackingHeader *tracking_forget(TrackingAllocator *tracker, void *ptr) {
+    TrackingHeader *header = (TrackingHeader *)ptr - 1;
+
+    bool exclusive;
+    TrackingSlot *slot = tracking_slot(tracker, &exclusive);
+    TRACKING_ADD(&slot->frees, 1, exclusive);
+    TRACKING_ADD(&slot->freed_bytes, header->size, exclusive);
+    tracking_flush(tracker, slot, -(i64)header->size, exclusive);
+
+    if (header->site != 0) {
+        TrackingSite *tracked = &tracker->sites[header->site];
+        __atomic_add_fetch(&tracked->frees, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&tracked->live_bytes, header->size, __ATOMIC_RELAXED);
+    }
+    return header;
+}
+
+#define TRACKING_HEADER_SIZE (align_up(sizeof(TrackingHeader), ALIGNMENT_DEFAULT))
+
+void *tracking_alloc_at(TrackingAllocator *tracker, usize size, const char *file, u32 line) {
+    u8 *base = (u8 *)tracker->backing_allocator->alloc(tracker->backing_allocator,
+                                                       TRACKING_HEADER_SIZE + size);
+    return tracking_record(tracker, base, size, TRACKING_HEADER_SIZE,
+                           tracking_site(tracker, file, line));
+}
+
+void *tracking_alloc_uninit_at(TrackingAllocator *tracker, usize size, const char *file, u32 line) {
+    u8 *base = (u8 *)allocator_alloc_uninit(tracker->backing_allocator, TRACKING_HEADER_SIZE + size);
+    return tracking_record(tracker, base, size, TRACKING_HEADER_SIZE,
+                           tracking_site(tracker, file, line));
+}
+
+void *tracking_realloc_at(TrackingAllocator *tracker, void *ptr, usize old_size, usize new_size,
+                          const char *file, u32 line) {
+    if (ptr == NULL) return tracking_alloc_uninit_at(tracker, new_size, file, line);
+    TrackingHeader *header = tracking_forget(tracker, ptr);
+    u32 site = file == NULL ? header->site : tracking_site(tracker, file, line);
+    u8 *base = (u8 *)ptr - header->offset;
+
+    if (header->offset != TRACKING_HEADER_SIZE) {
+        // Over-aligned blocks cannot go through the backing realloc, which only keeps the
+        // default alignment and would shift the header.
+        u8 *new_base = (u8 *)allocator_alloc_uninit(tracker->backing_allocator,
+                                                     TRACKING_HEADER_SIZE + new_size);
+        memcpy(new_base + TRACKING_HEADER_SIZE, ptr, old_size < new_size ? old_size : new_size);
+        tracker->backing_allocator->free(tracker->backing_allocator, base);
+        return tracking_record(tracker, new_base, new_size, TRACKING_HEADER_SIZE, site);
+    }
+
+    base = (u8 *)tracker->backing_allocator->realloc(tracker->backing_allocator, base,
+                                                     TRACKING_HEADER_SIZE + old_size,
+                                                     TRACKING_HEADER_SIZE + new_size);
+    return tracking_record(tracker, base, new_size, TRACKING_HEADER_SIZE, site);
+}
+
+void *tracking_allocator_alloc(Allocator *allocator, usize size) {
+    return tracking_alloc_at((TrackingAllocator *)allocator, size, NULL, 0);
+}
+
+void *tracking_allocator_alloc_uninit(Allocator *allocator, usize size) {
+    return tracking_alloc_uninit_at((TrackingAllocator *)allocator, size, NULL, 0);
+}
+
+void *tracking_allocator_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
+    return tracking_realloc_at((TrackingAllocator *)allocator, ptr, old_size, new_size, NULL, 0);
+}
+
+void *tracking_allocator_alloc_aligned(Allocator *allocator, usize size, usize alignment) {
+    TrackingAllocator *tracker = (TrackingAllocator *)allocator;
+    usize offset = align_up(sizeof(TrackingHeader), alignment);
+    if (offset < TRACKING_HEADER_SIZE) offset = TRACKING_HEADER_SIZE;
+    u8 *base = (u8 *)allocator_alloc_aligned(tracker->backing_allocator, offset + size, alignment);
+    return tracking_record(tracker, base, size, offset, 0);
+}
+
+void tracking_allocator_free(Allocator *allocator, void *ptr) {
+    if (ptr == NULL) return;
+    TrackingAllocator *tracker = (TrackingAllocator *)allocator;
+    TrackingHeader *header = tracking_forget(tracker, ptr);
+    tracker->backing_allocator->free(tracker->backing_allocator, (u8 *)ptr - header->offset);
+}
+
+TrackingAllocator tracking_allocator_new(const char *name, Allocator *backing_allocator) {
+    TrackingAllocator tracker = {
+        .allocator = {
+            .alloc = tracking_allocator_alloc,
+            .realloc = tracking_allocator_realloc,
+            .free = tracking_allocator_free,
+            .alloc_uninit = tracking_allocator_alloc_uninit,
+            .alloc_aligned = tracking_allocator_alloc_aligned
+        },
+        .backing_allocator = backing_allocator,
+        .name = name
+    };
+    return tracker;
+}
+
+TrackingStats tracking_allocator_stats(TrackingAllocator *tracker) {
+    TrackingStats stats = {0};
+    i64 pending = 0;
+    for (usize i = 0; i < TRACKING_SLOTS; i++) {
+        TrackingSlot *slot = &tracker->slots[i];
+        stats.allocs += __atomic_load_n(&slot->allocs, __ATOMIC_RELAXED);
+        stats.frees += __atomic_load_n(&slot->frees, __ATOMIC_RELAXED);
+        stats.total_bytes += __atomic_load_n(&slot->allocated_bytes, __ATOMIC_RELAXED);
+        pending += __atomic_load_n(&slot->pending_bytes, __ATOMIC_RELAXED);
+        for (usize j = 0; j < TRACKING_SIZE_CLASSES; j++) {
+            stats.size_classes[j] += __atomic_load_n(&slot->size_classes[j], __ATOMIC_RELAXED);
+        }
+    }
+    i64 live = __atomic_load_n(&tracker->live_bytes, __ATOMIC_RELAXED) + pending;
+    i64 peak = __atomic_load_n(&tracker->peak_bytes, __ATOMIC_RELAXED);
+    stats.live_bytes = live < 0 ? 0 : (u64)live;
+    stats.peak_bytes = peak > live ? (u64)peak : stats.live_bytes;
+    return stats;
+}
+
+// Fills in site 0 as the totals minus every tagged site.
+static void tracking_untagged_site(TrackingAllocator *tracker, TrackingStats *stats,
+                                   TrackingSite *untagged) {
+    *untagged = (TrackingSite){ .allocs = stats->allocs, .frees = stats->frees,
+                                .live_bytes = stats->total_bytes };
+    u64 freed_bytes = 0;
+    for (usize i = 0; i < TRACKING_SLOTS; i++) {
+        freed_bytes += __atomic_load_n(&tracker->slots[i].freed_bytes, __ATOMIC_RELAXED);
+    }
+    untagged->live_bytes -= freed_bytes;
+    for (usize i = 1; i < TRACKING_MAX_SITES; i++) {
+        TrackingSite *site = &tracker->sites[i];
+        untagged->allocs -= __atomic_load_n(&site->allocs, __ATOMIC_RELAXED);
+        untagged->frees -= __atomic_load_n(&site->frees, __ATOMIC_RELAXED);
+        untagged->live_bytes -= __atomic_load_n(&site->live_bytes, __ATOMIC_RELAXED);
+    }
+}
+
+static const char *tracking_name(TrackingAllocator *tracker) {
+    return tracker->name != NULL ? tracker->name : "tracking allocator";
+}
+
+void tracking_allocator_report(TrackingAllocator *tracker, FILE *file) {
+    TrackingStats stats = tracking_allocator_stats(tracker);
+    fprintf(file, "=== %s ===\n", tracking_name(tracker));
+    fprintf(file, "allocs %llu, frees %llu, live %llu bytes, peak %llu bytes, total %llu bytes\n",
+            (unsigned long long)stats.allocs, (unsigned long long)stats.frees,
+            (unsigned long long)stats.live_bytes, (unsigned long long)stats.peak_bytes,
+            (unsigned long long)stats.total_bytes);
+    for (usize i = 0; i < TRACKING_SIZE_CLASSES; i++) {
+        if (stats.size_classes[i] == 0) continue;
+        fprintf(file, "  size < %-12llu %llu\n", (unsigned long long)1 << i,
+                (unsigned long long)stats.size_classes[i]);
+    }
+
+    TrackingSite untagged;
+    tracking_untagged_site(tracker, &stats, &untagged);
+    for (usize i = 0; i < TRACKING_MAX_SITES; i++) {
+        TrackingSite *site = i == 0 ? &untagged : &tracker->sites[i];
+        u64 allocs = __atomic_load_n(&site->allocs, __ATOMIC_RELAXED);
+        if (allocs == 0) continue;
+        fprintf(file, "  %s:%u  allocs %llu, frees %llu, live %llu bytes\n",
+                site->file != NULL ? site->file : "(untagged)", site->line,
+                (unsigned long long)allocs,
+                (unsigned long long)__atomic_load_n(&site->frees, __ATOMIC_RELAXED),
+                (unsigned long long)__atomic_load_n(&site->live_bytes, __ATOMIC_RELAXED));
+    }
+}
+
+u64 tracking_allocator_check_leaks(TrackingAllocator *tracker, FILE *file) {
+    TrackingStats stats = tracking_allocator_stats(tracker);
+    TrackingSite untagged;
+    tracking_untagged_site(tracker, &stats, &untagged);
+
+    u64 leaked = 0;
+    for (usize i = 0; i < TRACKING_MAX_SITES; i++) {
+        TrackingSite *site = i == 0 ? &untagged : &tracker->sites[i];
+        u64 live = site->allocs - site->frees;
+        if (live == 0) continue;
+        leaked += live;
+        if (file != NULL) {
+            fprintf(file, "LEAK: %s: %llu allocations, %llu bytes from %s:%u\n",
+                    tracking_name(tracker), (unsigned long long)live,
+                    (unsigned long long)site->live_bytes,
+                    site->file != NULL ? site->file : "(untagged)", site->line);
+        }
+    }
+    return leaked;
+}
+
+// ---------------
+// --- Hashing ---
+// ---------------
+
+static const u64 hash_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static inline void hash_multiply(u64 *a, u64 *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = (__uint128_t)*a * *b;
+    *a = (u64)product;
+    *b = (u64)(product >> 64);
+#else
+    u64 ha = *a >> 32, la = (u32)*a, hb = *b >> 32, lb = (u32)*b;
+    u64 high = ha * hb, middle0 = ha * lb, middle1 = la * hb, low = la * lb;
+    u64 t = low + (middle0 << 32);
+    u64 carry = t < low;
+    u64 lo = t + (middle1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = high + (middle0 >> 32) + (middle1 >> 32) + carry;
+#endif
+}
+
+static inline u64 hash_mix(u64 a, u64 b) {
+    hash_multiply(&a, &b);
+    return a ^ b;
+}
+
+static inline u64 hash_read8(const u8 *p) {
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u64 hash_read4(const u8 *p) {
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+u64 hash_bytes(const void *data, usize length, u64 seed) {
+    const u8 *p = (const u8 *)data;
+    u64 a, b;
+    seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+    if (length <= 16) {
+        if (length >= 4) {
+            // Two overlapping 4 byte reads from each end cover every length from 4 to 16.
+            usize middle = (length >> 3) << 2;
+            a = (hash_read4(p) << 32) | hash_read4(p + middle);
+            b = (hash_read4(p + length - 4) << 32) | hash_read4(p + length - 4 - middle);
+        } else if (length > 0) {
+            a = ((u64)p[0] << 16) | ((u64)p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        usize i = length;
+        if (i >= 48) {
+            u64 seed1 = seed, seed2 = seed;
+            do {
+                seed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ seed);
+                seed1 = hash_mix(hash_read8(p + 16) ^ hash_secret[2], hash_read8(p + 24) ^ seed1);
+                seed2 = hash_mix(hash_read8(p + 32) ^ hash_secret[3], hash_read8(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = hash_read8(p + i - 16);
+        b = hash_read8(p + i - 8);
+    }
+
+    a ^= hash_secret[1];
+    b ^= seed;
+    hash_multiply(&a, &b);
+    return hash_mix(a ^ hash_secret[0] ^ length, b ^ hash_secret[1]);
+}
+
+u64 hash_random_seed(void) {
+    u64 seed = 0;
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (urandom != NULL) {
+        usize read = fread(&seed, sizeof(seed), 1, urandom);
+        fclose(urandom);
+        if (read == 1) return seed;
+    }
+    // No /dev/urandom: fall back to the clock and the stack address (ASLR).
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    seed = hash_mix((u64)ts.tv_nsec ^ ((u64)ts.tv_sec << 32), (u64)(usize)&seed);
+    return seed;
+}
+
+// ---------------
+// --- Strings ---
+// ---------------
+
+String string(const char *cstr, Allocator *allocator) {
+    usize length = strlen(cstr);
+    String str = {
+        .buffer = (u8 *)allocator_alloc_uninit(allocator, length),
+        .length = length,
+        .allocator = allocator
+    };
+    memcpy(str.buffer, cstr, length);
+    return str;
+}
+
+String string_new(usize length, Allocator *allocator) {
+    String str = {
+        .buffer = (u8 *)allocator_alloc_uninit(allocator, length),
+        .length = length,
+        .allocator = allocator
+    };
+    return str;
+}
+
+String string_concat(String a, String b, Allocator *allocator) {
+    String str = {
+        .buffer = (u8 *)allocator_alloc_uninit(allocator, a.length + b.length),
+        .length = a.length + b.length,
+        .allocator = allocator
+    };
+    memcpy(str.buffer, a.buffer, a.length);
+    memcpy(str.buffer + a.length, b.buffer, b.length);
+    return str;
+}
+
+String string_slice(String string, usize start, usize end) {
+    String str = {
+        .buffer = string.buffer + start,
+        .length = end - start,
+        .allocator = NULL
+    };
+    return str;
+}
+
+bool string_eq_cstr(String a, const char *cstr) {
+    String b = {
+        .buffer = (u8 *)cstr,
+        .length = strlen(cstr),
+        .allocator = NULL
+    };
+    return string_eq(a, b);
+}
+
+u64 string_hash(String str) {
+    return hash_bytes(str.buffer, str.length, 0);
+}
+
+u64 string_hash_seeded(String str, u64 seed) {
+    return hash_bytes(str.buffer, str.length, seed);
+}
+
+void string_free(String *string) {
+    ASSERT(string != NULL);
+    ASSERT(string->buffer != NULL);
+    if (string->allocator == NULL) return;
+    string->allocator->free(string->allocator, string->buffer);
+    string->buffer = NULL;
+    string->length = 0;
+}
+
+// ---------------------
+// --- String Search ---
+// ---------------------
+
+static i32 simd_detected_level = -1;
+static THREAD_LOCAL i32 simd_thread_level = -1;
+
+static SimdLevel simd_detect_level(void) {
+#if defined(BASE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+#if defined(BASE_SSE2)
+    return SIMD_SSE2;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+SimdLevel simd_level(void) {
+    if (simd_thread_level >= 0) return (SimdLevel)simd_thread_level;
+    i32 level = __atomic_load_n(&simd_detected_level, __ATOMIC_RELAXED);
+    if (level < 0) {
+        level = (i32)simd_detect_level();
+        __atomic_store_n(&simd_detected_level, level, __ATOMIC_RELAXED);
+    }
+    return (SimdLevel)level;
+}
+
+void simd_set_level(SimdLevel level) {
+    simd_thread_level = -1;
+    SimdLevel detected = simd_level();
+    simd_thread_level = (i32)(level < detected ? level : detected);
+}
+
+bool string_eq_scalar(String a, String b) {
+    if (a.length != b.length) return false;
+    for (usize i = 0; i < a.length; i++) {
+        if (a.buffer[i] != b.buffer[i]) return false;
+    }
+    return true;
+}
+
+usize string_find_byte_scalar(String str, u8 byte) {
+    for (usize i = 0; i < str.length; i++) {
+        if (str.buffer[i] == byte) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+usize string_find_scalar(String haystack, String needle) {
+    if (needle.length > haystack.length) return STRING_NOT_FOUND;
+    if (needle.length == 0) return 0;
+    for (usize i = 0; i + needle.length <= haystack.length; i++) {
+        if (memcmp(haystack.buffer + i, needle.buffer, needle.length) == 0) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+usize string_rfind_scalar(String haystack, String needle) {
+    if (needle.length > haystack.length) return STRING_NOT_FOUND;
+    if (needle.length == 0) return haystack.length;
+    for (usize i = haystack.length - needle.length + 1; i-- > 0;) {
+        if (memcmp(haystack.buffer + i, needle.buffer, needle.length) == 0) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+usize string_count_byte_scalar(String str, u8 byte) {
+    usize count = 0;
+    for (usize i = 0; i < str.length; i++) {
+        count += str.buffer[i] == byte;
+    }
+    return count;
+}
+
+// Length of the well-formed sequence starting at a non-ASCII byte, or 0 if there is none.
+static usize utf8_sequence_length(const u8 *s, usize available) {
+    u8 lead = s[0];
+    usize length;
+    u8 low = 0x80;
+    u8 high = 0xBF;
+    if (lead < 0xC2) {
+        return 0;
+    } else if (lead < 0xE0) {
+        length = 2;
+    } else if (lead < 0xF0) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;   // overlong
+        if (lead == 0xED) high = 0x9F;  // surrogates
+    } else if (lead < 0xF5) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;   // overlong
+        if (lead == 0xF4) high = 0x8F;  // past U+10FFFF
+    } else {
+        return 0;
+    }
+    if (available < length) return 0;
+    if (s[1] < low || s[1] > high) return 0;
+    for (usize i = 2; i < length; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+    }
+    return length;
+}
+
+bool utf8_validate_scalar(String str) {
+    usize i = 0;
+    while (i < str.length) {
+        if (str.buffer[i] < 0x80) {
+            i++;
+            continue;
+        }
+        usize length = utf8_sequence_length(str.buffer + i, str.length - i);
+        if (length == 0) return false;
+        i += length;
+    }
+    return true;
+}
+
+usize utf8_count_scalar(String str) {
+    usize count = 0;
+    for (usize i = 0; i < str.length; i++) {
+        count += (str.buffer[i] & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+#if defined(BASE_SSE2)
+
+// Compares fewer than 16 bytes with at most two overlapping loads per side.
+static inline bool string_eq_small(const u8 *a, const u8 *b, usize length) {
+    if (length >= 8) {
+        u64 a0, a1, b0, b1;
+        memcpy(&a0, a, 8);
+        memcpy(&b0, b, 8);
+        memcpy(&a1, a + length - 8, 8);
+        memcpy(&b1, b + length - 8, 8);
+        return a0 == b0 && a1 == b1;
+    }
+    if (length >= 4) {
+        u32 a0, a1, b0, b1;
+        memcpy(&a0, a, 4);
+        memcpy(&b0, b, 4);
+        memcpy(&a1, a + length - 4, 4);
+        memcpy(&b1, b + length - 4, 4);
+        return a0 == b0 && a1 == b1;
+    }
+    for (usize i = 0; i < length; i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+static bool string_eq_sse2(const u8 *a, const u8 *b, usize length) {
+    if (length < 16) return string_eq_small(a, b, length);
+    usize i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return false;
+    }
+    if (i < length) {
+        // The last 16 bytes, overlapping what was already compared.
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + length - 16));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + length - 16));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return false;
+    }
+    return true;
+}
+
+static usize string_find_byte_sse2(const u8 *s, usize length, u8 byte) {
+    __m128i needle = _mm_set1_epi8((char)byte);
+    usize i = 0;
+    for (; i + 16 <= length; i += 16) {
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s + i)), needle));
+        if (mask != 0) return i + (usize)__builtin_ctz(mask);
+    }
+    for (; i < length; i++) {
+        if (s[i] == byte) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+// Candidates are positions where both the first and the last byte of the needle match,
+// which filters out almost everything before a memcmp of the bytes in between.
+static usize string_find_sse2(const u8 *h, usize length, const u8 *needle, usize needle_length) {
+    __m128i first = _mm_set1_epi8((char)needle[0]);
+    __m128i last = _mm_set1_epi8((char)needle[needle_length - 1]);
+    usize inner = needle_length > 2 ? needle_length - 2 : 0;
+    usize i = 0;
+    for (; i + needle_length - 1 + 16 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(h + i + needle_length - 1));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                        _mm_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            usize bit = (usize)__builtin_ctz(mask);
+            if (memcmp(h + i + bit + 1, needle + 1, inner) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    for (; i + needle_length <= length; i++) {
+        if (h[i] == needle[0] && memcmp(h + i, needle, needle_length) == 0) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+static usize string_rfind_sse2(const u8 *h, usize length, const u8 *needle, usize needle_length) {
+    __m128i first = _mm_set1_epi8((char)needle[0]);
+    __m128i last = _mm_set1_epi8((char)needle[needle_length - 1]);
+    usize inner = needle_length > 2 ? needle_length - 2 : 0;
+    // Candidate positions still to check are [0, end).
+    usize end = length - needle_length + 1;
+    while (end >= 16) {
+        usize i = end - 16;
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(h + i + needle_length - 1));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                        _mm_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            usize bit = 31 - (usize)__builtin_clz(mask);
+            if (memcmp(h + i + bit + 1, needle + 1, inner) == 0) return i + bit;
+            mask &= ~((u32)1 << bit);
+        }
+        end = i;
+    }
+    while (end-- > 0) {
+        if (h[end] == needle[0] && memcmp(h + end, needle, needle_length) == 0) return end;
+    }
+    return STRING_NOT_FOUND;
+}
+
+// Counts the bytes where match is all ones. Matches are subtracted into per-byte counters,
+// which are summed with SAD before they can wrap at 255.
+#define SIMD_COUNT_SSE2(s, length, count, match) do { \
+    usize _i = 0; \
+    while (_i + 16 <= (length)) { \
+        __m128i _counts = _mm_setzero_si128(); \
+        usize _end = (length) - _i > 255 * 16 ? _i + 255 * 16 : (length); \
+        for (; _i + 16 <= _end; _i += 16) { \
+            __m128i _block = _mm_loadu_si128((const __m128i *)((s) + _i)); \
+            _counts = _mm_sub_epi8(_counts, match(_block)); \
+        } \
+        __m128i _sums = _mm_sad_epu8(_counts, _mm_setzero_si128()); \
+        (count) += (usize)_mm_extract_epi16(_sums, 0) + (usize)_mm_extract_epi16(_sums, 4); \
+    } \
+    (s) += _i; \
+    (length) -= _i; \
+} while (0)
+
+static usize string_count_byte_sse2(const u8 *s, usize length, u8 byte) {
+    __m128i needle = _mm_set1_epi8((char)byte);
+    usize count = 0;
+#define STRING_MATCH_BYTE(block) _mm_cmpeq_epi8(block, needle)
+    SIMD_COUNT_SSE2(s, length, count, STRING_MATCH_BYTE);
+#undef STRING_MATCH_BYTE
+    for (usize i = 0; i < length; i++) {
+        count += s[i] == byte;
+    }
+    return count;
+}
+
+static usize utf8_count_sse2(const u8 *s, usize length) {
+    // Continuation bytes are 0x80-0xBF, that is below -64 as signed bytes.
+    __m128i continuation = _mm_set1_epi8(-65);
+    usize count = 0;
+#define UTF8_MATCH_START(block) _mm_cmpgt_epi8(block, continuation)
+    SIMD_COUNT_SSE2(s, length, count, UTF8_MATCH_START);
+#undef UTF8_MATCH_START
+    for (usize i = 0; i < length; i++) {
+        count += (s[i] & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+// Skips 16 bytes at a time while they are all ASCII and decodes the rest one sequence at a
+// time. Mostly-ASCII text, which is what parsers mostly see, runs at vector speed.
+static bool utf8_validate_sse2(const u8 *s, usize length) {
+    usize i = 0;
+    while (i < length) {
+        if (i + 16 <= length) {
+            u32 mask = (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+            if (mask == 0) {
+                i += 16;
+                continue;
+            }
+            i += (usize)__builtin_ctz(mask);
+        } else if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        usize sequence = utf8_sequence_length(s + i, length - i);
+        if (sequence == 0) return false;
+        i += sequence;
+    }
+    return true;
+}
+
+#endif // BASE_SSE2
+
+#if defined(BASE_AVX2)
+
+// The short tails go to the SSE2 kernels, which are not VEX encoded. Clearing the upper
+// halves of the ymm registers first avoids the AVX-SSE transition penalty, which GCC does
+// not insert on its own before these calls.
+
+BASE_TARGET_AVX2
+static bool string_eq_avx2(const u8 *a, const u8 *b, usize length) {
+    if (length < 32) {
+        _mm256_zeroupper();
+        return string_eq_sse2(a, b, length);
+    }
+    usize i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFF) return false;
+    }
+    if (i < length) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + length - 32));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + length - 32));
+        if ((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+BASE_TARGET_AVX2
+static usize string_find_byte_avx2(const u8 *s, usize length, u8 byte) {
+    __m256i needle = _mm256_set1_epi8((char)byte);
+    usize i = 0;
+    for (; i + 32 <= length; i += 32) {
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s + i)), needle));
+        if (mask != 0) return i + (usize)__builtin_ctz(mask);
+    }
+    _mm256_zeroupper();
+    usize rest = string_find_byte_sse2(s + i, length - i, byte);
+    return rest == STRING_NOT_FOUND ? rest : i + rest;
+}
+
+BASE_TARGET_AVX2
+static usize string_find_avx2(const u8 *h, usize length, const u8 *needle, usize needle_length) {
+    __m256i first = _mm256_set1_epi8((char)needle[0]);
+    __m256i last = _mm256_set1_epi8((char)needle[needle_length - 1]);
+    usize inner = needle_length > 2 ? needle_length - 2 : 0;
+    usize i = 0;
+    for (; i + needle_length - 1 + 32 <= length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(h + i + needle_length - 1));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                              _mm256_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            usize bit = (usize)__builtin_ctz(mask);
+            if (memcmp(h + i + bit + 1, needle + 1, inner) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    _mm256_zeroupper();
+    usize rest = string_find_sse2(h + i, length - i, needle, needle_length);
+    return rest == STRING_NOT_FOUND ? rest : i + rest;
+}
+
+BASE_TARGET_AVX2
+static usize string_rfind_avx2(const u8 *h, usize length, const u8 *needle, usize needle_length) {
+    __m256i first = _mm256_set1_epi8((char)needle[0]);
+    __m256i last = _mm256_set1_epi8((char)needle[needle_length - 1]);
+    usize inner = needle_length > 2 ? needle_length - 2 : 0;
+    usize end = length - needle_length + 1;
+    while (end >= 32) {
+        usize i = end - 32;
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(h + i + needle_length - 1));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                              _mm256_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            usize bit = 31 - (usize)__builtin_clz(mask);
+            if (memcmp(h + i + bit + 1, needle + 1, inner) == 0) return i + bit;
+            mask &= ~((u32)1 << bit);
+        }
+        end = i;
+    }
+    if (end == 0) return STRING_NOT_FOUND;
+    _mm256_zeroupper();
+    // The remaining candidates start before end, so a match ends before end + needle_length - 1.
+    return string_rfind_sse2(h, end + needle_length - 1, needle, needle_length);
+}
+
+#define SIMD_COUNT_AVX2(s, length, count, match) do { \
+    usize _i = 0; \
+    while (_i + 32 <= (length)) { \
+        __m256i _counts = _mm256_setzero_si256(); \
+        usize _end = (length) - _i > 255 * 32 ? _i + 255 * 32 : (length); \
+        for (; _i + 32 <= _end; _i += 32) { \
+            __m256i _block = _mm256_loadu_si256((const __m256i *)((s) + _i)); \
+            _counts = _mm256_sub_epi8(_counts, match(_block)); \
+        } \
+        __m256i _sums = _mm256_sad_epu8(_counts, _mm256_setzero_si256()); \
+        __m128i _half = _mm_add_epi64(_mm256_castsi256_si128(_sums), _mm256_extracti128_si256(_sums, 1)); \
+        (count) += (usize)_mm_extract_epi16(_half, 0) + (usize)_mm_extract_epi16(_half, 4); \
+    } \
+    (s) += _i; \
+    (length) -= _i; \
+} while (0)
+
+BASE_TARGET_AVX2
+static usize string_count_byte_avx2(const u8 *s, usize length, u8 byte) {
+    __m256i needle = _mm256_set1_epi8((char)byte);
+    usize count = 0;
+#define STRING_MATCH_BYTE(block) _mm256_cmpeq_epi8(block, needle)
+    SIMD_COUNT_AVX2(s, length, count, STRING_MATCH_BYTE);
+#undef STRING_MATCH_BYTE
+    _mm256_zeroupper();
+    return count + string_count_byte_sse2(s, length, byte);
+}
+
+BASE_TARGET_AVX2
+static usize utf8_count_avx2(const u8 *s, usize length) {
+    __m256i continuation = _mm256_set1_epi8(-65);
+    usize count = 0;
+#define UTF8_MATCH_START(block) _mm256_cmpgt_epi8(block, continuation)
+    SIMD_COUNT_AVX2(s, length, count, UTF8_MATCH_START);
+#undef UTF8_MATCH_START
+    _mm256_zeroupper();
+    return count + utf8_count_sse2(s, length);
+}
+
+BASE_TARGET_AVX2
+static bool utf8_validate_avx2(const u8 *s, usize length) {
+    usize i = 0;
+    while (i + 32 <= length) {
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(s + i)));
+        if (mask == 0) {
+            i += 32;
+            continue;
+        }
+        i += (usize)__builtin_ctz(mask);
+        usize sequence = utf8_sequence_length(s + i, length - i);
+        if (sequence == 0) return false;
+        i += sequence;
+    }
+    _mm256_zeroupper();
+    return utf8_validate_sse2(s + i, length - i);
+}
+
+#endif // BASE_AVX2
+
+bool string_eq(String a, String b) {
+    if (a.length != b.length) return false;
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return string_eq_avx2(a.buffer, b.buffer, a.length);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return string_eq_sse2(a.buffer, b.buffer, a.length);
+#endif
+        default: return string_eq_scalar(a, b);
+    }
+}
+
+usize string_find_byte(String str, u8 byte) {
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return string_find_byte_avx2(str.buffer, str.length, byte);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return string_find_byte_sse2(str.buffer, str.length, byte);
+#endif
+        default: return string_find_byte_scalar(str, byte);
+    }
+}
+
+usize string_find(String haystack, String needle) {
+    if (needle.length > haystack.length) return STRING_NOT_FOUND;
+    if (needle.length == 0) return 0;
+    if (needle.length == 1) return string_find_byte(haystack, needle.buffer[0]);
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return string_find_avx2(haystack.buffer, haystack.length, needle.buffer, needle.length);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return string_find_sse2(haystack.buffer, haystack.length, needle.buffer, needle.length);
+#endif
+        default: return string_find_scalar(haystack, needle);
+    }
+}
+
+usize string_rfind(String haystack, String needle) {
+    if (needle.length > haystack.length) return STRING_NOT_FOUND;
+    if (needle.length == 0) return haystack.length;
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return string_rfind_avx2(haystack.buffer, haystack.length, needle.buffer, needle.length);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return string_rfind_sse2(haystack.buffer, haystack.length, needle.buffer, needle.length);
+#endif
+        default: return string_rfind_scalar(haystack, needle);
+    }
+}
+
+usize string_count_byte(String str, u8 byte) {
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return string_count_byte_avx2(str.buffer, str.length, byte);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return string_count_byte_sse2(str.buffer, str.length, byte);
+#endif
+        default: return string_count_byte_scalar(str, byte);
+    }
+}
+
+bool utf8_validate(String str) {
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return utf8_validate_avx2(str.buffer, str.length);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return utf8_validate_sse2(str.buffer, str.length);
+#endif
+        default: return utf8_validate_scalar(str);
+    }
+}
+
+usize utf8_count(String str) {
+    switch (simd_level()) {
+#if defined(BASE_AVX2)
+        case SIMD_AVX2: return utf8_count_avx2(str.buffer, str.length);
+#endif
+#if defined(BASE_SSE2)
+        case SIMD_SSE2: return utf8_count_sse2(str.buffer, str.length);
+#endif
+        default: return utf8_count_scalar(str);
+    }
+}
+
+StringBuilder string_builder_new(usize capacity, Allocator *allocator) {
+    StringBuilder builder = {
+        .buffer = capacity > 0 ? (u8 *)allocator_alloc_uninit(allocator, capacity) : NULL,
+        .length = 0,
+        .capacity = capacity,
+        .allocator = allocator
+    };
+    return builder;
+}
+
+void string_builder_reserve(StringBuilder *builder, usize additional) {
+    ASSERT(additional <= SIZE_MAX - builder->length);
+    usize needed = builder->length + additional;
+    if (needed <= builder->capacity) return;
+
+    usize capacity = dynamic_array_grown_capacity(builder->capacity, needed);
+    if (builder->buffer == NULL) {
+        builder->buffer = (u8 *)allocator_alloc_uninit(builder->allocator, capacity);
+    } else {
+        builder->buffer = (u8 *)builder->allocator->realloc(
+            builder->allocator, builder->buffer, builder->capacity, capacity);
+    }
+    builder->capacity = capacity;
+}
+
+void string_builder_append(StringBuilder *builder, String str) {
+    string_builder_reserve(builder, str.length);
+    memcpy(builder->buffer + builder->length, str.buffer, str.length);
+    builder->length += str.length;
+}
+
+void string_builder_append_cstr(StringBuilder *builder, const char *cstr) {
+    usize length = strlen(cstr);
+    string_builder_reserve(builder, length);
+    memcpy(builder->buffer + builder->length, cstr, length);
+    builder->length += length;
+}
+
+void string_builder_append_byte(StringBuilder *builder, u8 byte) {
+    if (builder->length == builder->capacity) {
+        string_builder_reserve(builder, 1);
+    }
+    builder->buffer[builder->length++] = byte;
+}
+
+static const char string_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes the digits of value ending just before end, two at a time, and returns where
+// they start.
+static char *string_format_u64(char *end, u64 value) {
+    while (value >= 100) {
+        const char *pair = &string_digit_pairs[(value % 100) * 2];
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (value >= 10) {
+        const char *pair = &string_digit_pairs[value * 2];
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+void string_builder_append_u64(StringBuilder *builder, u64 value) {
+    string_builder_reserve(builder, NUMBER_FORMAT_MAX);
+    builder->length += format_u64((char *)builder->buffer + builder->length, value);
+}
+
+void string_builder_append_i64(StringBuilder *builder, i64 value) {
+    string_builder_reserve(builder, NUMBER_FORMAT_MAX);
+    builder->length += format_i64((char *)builder->buffer + builder->length, value);
+}
+
+void string_builder_append_f64(StringBuilder *builder, f64 value, u32 decimals) {
+    static const u64 powers_of_10[10] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+    ASSERT(decimals <= 9);
+
+    if (value != value) {
+        string_builder_append_cstr(builder, "nan");
+        return;
+    }
+    bool negative = value < 0 || (value == 0 && 1.0 / value < 0);
+    f64 magnitude = negative ? -value : value;
+    if (magnitude > 9.2e18) {
+        if (magnitude == 1.0 / 0.0) {
+            string_builder_append_cstr(builder, negative ? "-inf" : "inf");
+        } else {
+            string_builder_appendf(builder, "%.*f", (int)decimals, value);
+        }
+        return;
+    }
+
+    u64 scale = powers_of_10[decimals];
+    u64 integer = (u64)magnitude;
+    u64 fraction = (u64)((magnitude - (f64)integer) * (f64)scale + 0.5);
+    if (fraction >= scale) {
+        integer++;
+        fraction -= scale;
+    }
+
+    char digits[32];
+    char *end = digits + sizeof(digits);
+    char *start = end;
+    if (decimals > 0) {
+        start = string_format_u64(end, fraction);
+        while ((usize)(end - start) < decimals) *--start = '0';
+        *--start = '.';
+    }
+    start = string_format_u64(start, integer);
+    if (negative) *--start = '-';
+
+    usize length = (usize)(end - start);
+    string_builder_reserve(builder, length);
+    memcpy(builder->buffer + builder->length, start, length);
+    builder->length += length;
+}
+
+void string_builder_appendf(StringBuilder *builder, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    // Formats straight into the spare capacity and only retries if it did not fit.
+    va_list retry;
+    va_copy(retry, args);
+    usize available = builder->capacity - builder->length;
+    int length = vsnprintf(available > 0 ? (char *)builder->buffer + builder->length : NULL,
+                           available, format, args);
+    va_end(args);
+    ASSERT(length >= 0);
+
+    // vsnprintf always writes a terminator, which needs one byte past the text.
+    if ((usize)length >= available) {
+        string_builder_reserve(builder, (usize)length + 1);
+        vsnprintf((char *)builder->buffer + builder->length, (usize)length + 1, format, retry);
+    }
+    va_end(retry);
+    builder->length += (usize)length;
+}
+
+String string_builder_finish(StringBuilder *builder) {
+    // An empty String still needs a buffer for string_free.
+    if (builder->buffer == NULL) {
+        string_builder_reserve(builder, 1);
+    }
+    String str = {
+        .buffer = builder->buffer,
+        .length = builder->length,
+        .allocator = builder->allocator
+    };
+    builder->buffer = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    return str;
+}
+
+void string_builder_reset(StringBuilder *builder) {
+    builder->length = 0;
+}
+
+void string_builder_free(StringBuilder *builder) {
+    if (builder->buffer != NULL) {
+        builder->allocator->free(builder->allocator, builder->buffer);
+    }
+    builder->buffer = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+}
+
+StringSplitter string_split(String str, u8 delimiter) {
+    StringSplitter splitter = {
+        .rest = str,
+        .delimiter = delimiter,
+        .lines = false,
+        .done = false
+    };
+    return splitter;
+}
+
+StringSplitter string_lines(String str) {
+    StringSplitter splitter = {
+        .rest = str,
+        .delimiter = '\n',
+        .lines = true,
+        .done = str.length == 0
+    };
+    return splitter;
+}
+
+bool string_split_next(StringSplitter *splitter, String *piece) {
+    if (splitter->done) return false;
+
+    String rest = splitter->rest;
+    const u8 *end = rest.length > 0
+        ? (const u8 *)memchr(rest.buffer, splitter->delimiter, rest.length)
+        : NULL;
+    usize length = end != NULL ? (usize)(end - rest.buffer) : rest.length;
+    if (end != NULL) {
+        splitter->rest = string_slice(rest, length + 1, rest.length);
+        splitter->done = splitter->lines && splitter->rest.length == 0;
+    } else {
+        splitter->done = true;
+    }
+
+    if (splitter->lines && end != NULL && length > 0 && rest.buffer[length - 1] == '\r') {
+        length--;
+    }
+    *piece = string_slice(rest, 0, length);
+    return true;
+}
+
+// ---------------
+// --- Numbers ---
+// ---------------
+
+// Digits are parsed eight at a time: the bytes are loaded as one little-endian word,
+// checked to all be '0'..'9' with two masks, and combined pairwise, then in fours, then
+// in eights with three multiplies.
+static inline u64 number_load_eight(const u8 *p) {
+    u64 chunk;
+    memcpy(&chunk, p, sizeof(chunk));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    chunk = __builtin_bswap64(chunk);
+#endif
+    return chunk;
+}
+
+static inline bool number_is_eight_digits(u64 chunk) {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+static inline u64 number_eight_digits(u64 chunk) {
+    chunk -= 0x3030303030303030ULL;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = ((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+             ((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+    return (u32)chunk;
+}
+
+static inline bool number_is_digit(u8 c) {
+    return (u8)(c - '0') < 10;
+}
+
+// Accumulates at most max_digits digits starting at p into *value and returns where it
+// stopped. *value wraps if the digits do not fit, so callers bound max_digits.
+static const u8 *number_parse_digits(const u8 *p, const u8 *end, usize max_digits, u64 *value) {
+    const u8 *limit = (usize)(end - p) > max_digits ? p + max_digits : end;
+    u64 result = *value;
+    while (limit - p >= 8) {
+        u64 chunk = number_load_eight(p);
+        if (!number_is_eight_digits(chunk)) break;
+        result = result * 100000000 + number_eight_digits(chunk);
+        p += 8;
+    }
+    while (p < limit && number_is_digit(*p)) {
+        result = result * 10 + (u64)(*p - '0');
+        p++;
+    }
+    *value = result;
+    return p;
+}
+
+static bool number_parse_magnitude(const u8 *p, const u8 *end, u64 *value) {
+    if (p == end) return false;
+    while (p < end && *p == '0') p++;
+    const u8 *digits = p;
+    u64 result = 0;
+    p = number_parse_digits(p, end, 20, &result);
+    if (p != end) return false;
+
+    // Up to 19 digits always fit. With 20 the product wrapped if the first 19 are past
+    // UINT64_MAX / 10, or equal to it with a last digit past UINT64_MAX % 10.
+    if (p - digits == 20) {
+        u64 head = 0;
+        number_parse_digits(digits, end, 19, &head);
+        u64 last = (u64)(digits[19] - '0');
+        if (head > UINT64_MAX / 10 || (head == UINT64_MAX / 10 && last > UINT64_MAX % 10)) {
+            return false;
+        }
+    }
+    *value = result;
+    return true;
+}
+
+bool string_parse_u64(String str, u64 *value) {
+    const u8 *p = str.buffer;
+    const u8 *end = p + str.length;
+    if (p < end && *p == '+') p++;
+    return number_parse_magnitude(p, end, value);
+}
+
+bool string_parse_i64(String str, i64 *value) {
+    const u8 *p = str.buffer;
+    const u8 *end = p + str.length;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    u64 magnitude;
+    if (!number_parse_magnitude(p, end, &magnitude)) return false;
+    if (magnitude > (u64)INT64_MAX + negative) return false;
+    // Negated as unsigned so INT64_MIN does not overflow.
+    *value = negative ? (i64)((u64)0 - magnitude) : (i64)magnitude;
+    return true;
+}
+
+static inline u64 number_multiply(u64 a, u64 b, u64 *high) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *high = (u64)(product >> 64);
+    return (u64)product;
+#else
+    u64 a_low = (u32)a, a_high = a >> 32;
+    u64 b_low = (u32)b, b_high = b >> 32;
+    u64 low_low = a_low * b_low;
+    u64 high_low = a_high * b_low;
+    u64 low_high = a_low * b_high;
+    u64 cross = (low_low >> 32) + (u32)high_low + low_high;
+    *high = a_high * b_high + (high_low >> 32) + (cross >> 32);
+    return (cross << 32) | (u32)low_low;
+#endif
+}
+
+static inline f64 number_f64_from_bits(u64 bits) {
+    f64 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#define NUMBER_F64_INFINITY_BITS 0x7FF0000000000000ULL
+#define NUMBER_F64_NAN_BITS 0x7FF8000000000000ULL
+
+static const f64 number_exact_powers_of_10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// 5^q for q from -342 to 324 as 128-bit significands (high word first), shifted so the
+// top bit is set. Truncated, apart from q from -27 to -1, which are one more than that.
+// Parsing needs q up to 308, formatting up to 324 for the smallest subnormals.
+static const u64 number_powers_of_5[667 * 2] = {
+    0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL,
+    0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+    0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL,
+    0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+    0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL,
+    0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+    0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL,
+    0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+    0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL,
+    0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+    0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL,
+    0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+    0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL,
+    0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+    0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL,
+    0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+    0x84a57695fe98746dULL, 0x014bb630f7604b57ULL,
+    0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+    0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL,
+    0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+    0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL,
+    0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+    0xfd00b897478238d0ULL, 0x8920b098955522b4ULL,
+    0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+    0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL,
+    0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+    0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL,
+    0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+    0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL,
+    0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+    0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL,
+    0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+    0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL,
+    0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+    0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL,
+    0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+    0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL,
+    0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+    0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL,
+    0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+    0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL,
+    0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+    0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL,
+    0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+    0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL,
+    0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+    0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL,
+    0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+    0xa37fce126597973cULL, 0xe50ff107bab528a0ULL,
+    0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+    0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL,
+    0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+    0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL,
+    0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+    0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL,
+    0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+    0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL,
+    0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+    0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL,
+    0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+    0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL,
+    0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+    0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL,
+    0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+    0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL,
+    0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+    0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL,
+    0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+    0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL,
+    0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+    0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL,
+    0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+    0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL,
+    0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+    0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL,
+    0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+    0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL,
+    0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+    0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL,
+    0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+    0xc987434744ac874eULL, 0xa327ffb266b56220ULL,
+    0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+    0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL,
+    0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+    0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL,
+    0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+    0xc0314325637a1939ULL, 0xfa911155fefb5308ULL,
+    0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+    0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL,
+    0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+    0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL,
+    0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+    0xb749faed14125d36ULL, 0xcef980ec671f667bULL,
+    0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+    0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL,
+    0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+    0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL,
+    0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+    0xaecc49914078536dULL, 0x58fae9f773886e18ULL,
+    0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+    0x888f99797a5e012dULL, 0x6d8406c952429603ULL,
+    0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+    0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL,
+    0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+    0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL,
+    0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+    0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL,
+    0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+    0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL,
+    0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+    0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL,
+    0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+    0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL,
+    0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+    0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL,
+    0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+    0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL,
+    0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+    0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL,
+    0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+    0xb913179899f68584ULL, 0x28e2557b59846e3fULL,
+    0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+    0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL,
+    0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+    0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL,
+    0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+    0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL,
+    0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+    0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL,
+    0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+    0xd77485cb25823ac7ULL, 0x7d633293366b828bULL,
+    0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+    0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL,
+    0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+    0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL,
+    0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+    0xcd795be870516656ULL, 0x67902e276c921f8bULL,
+    0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+    0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL,
+    0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+    0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL,
+    0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+    0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL,
+    0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+    0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL,
+    0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+    0xef340a98172aace4ULL, 0x86fb897116c87c34ULL,
+    0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+    0xbae0a846d2195712ULL, 0x8974836059cca109ULL,
+    0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+    0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL,
+    0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+    0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL,
+    0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+    0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL,
+    0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+    0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL,
+    0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+    0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL,
+    0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+    0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL,
+    0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+    0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL,
+    0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+    0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL,
+    0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+    0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL,
+    0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+    0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL,
+    0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+    0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL,
+    0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+    0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL,
+    0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+    0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL,
+    0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+    0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL,
+    0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+    0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL,
+    0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+    0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL,
+    0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+    0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL,
+    0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+    0x8c974f7383725573ULL, 0x1e414218c73a13fbULL,
+    0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+    0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL,
+    0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+    0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL,
+    0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+    0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL,
+    0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+    0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL,
+    0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+    0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL,
+    0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+    0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL,
+    0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+    0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL,
+    0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+    0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL,
+    0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+    0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL,
+    0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+    0xbe89523386091465ULL, 0xf6bbb397f1135823ULL,
+    0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+    0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL,
+    0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+    0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL,
+    0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+    0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL,
+    0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+    0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL,
+    0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+    0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL,
+    0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+    0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL,
+    0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+    0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL,
+    0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+    0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL,
+    0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+    0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL,
+    0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+    0x811ccc668829b887ULL, 0x0806357d5a3f525fULL,
+    0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+    0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL,
+    0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+    0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL,
+    0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+    0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL,
+    0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+    0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL,
+    0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+    0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL,
+    0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+    0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL,
+    0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+    0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL,
+    0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+    0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL,
+    0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+    0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL,
+    0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+    0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL,
+    0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+    0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL,
+    0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+    0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL,
+    0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+    0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL,
+    0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+    0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL,
+    0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+    0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL,
+    0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+    0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL,
+    0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+    0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL,
+    0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+    0xc24452da229b021bULL, 0xfbe85badce996168ULL,
+    0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+    0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL,
+    0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+    0xed246723473e3813ULL, 0x290123e9aab23b68ULL,
+    0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+    0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL,
+    0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+    0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL,
+    0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+    0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL,
+    0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+    0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL,
+    0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+    0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL,
+    0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+    0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL,
+    0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+    0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+    0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+    0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+    0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+    0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+    0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+    0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+    0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+    0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+    0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+    0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+    0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+    0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+    0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+    0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+    0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+    0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+    0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+    0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL,
+    0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+    0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+    0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+    0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+    0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+    0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+    0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+    0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+    0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+    0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+    0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+    0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+    0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL,
+    0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL,
+    0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL,
+    0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL,
+    0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL,
+    0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL,
+    0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+    0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL,
+    0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+    0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+    0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+    0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL,
+    0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+    0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+    0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL,
+    0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+    0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+    0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+    0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+    0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+    0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL,
+    0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL,
+    0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL,
+    0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL,
+    0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL,
+    0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL,
+    0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL,
+    0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL,
+    0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL,
+    0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL,
+    0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL,
+    0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL,
+    0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL,
+    0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+    0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL,
+    0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+    0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL,
+    0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+    0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL,
+    0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+    0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL,
+    0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+    0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL,
+    0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+    0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL,
+    0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+    0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL,
+    0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+    0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL,
+    0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+    0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL,
+    0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+    0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL,
+    0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+    0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL,
+    0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+    0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL,
+    0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+    0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL,
+    0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+    0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL,
+    0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+    0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL,
+    0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+    0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL,
+    0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+    0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL,
+    0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+    0x924d692ca61be758ULL, 0x593c2626705f9c56ULL,
+    0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+    0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL,
+    0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+    0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL,
+    0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+    0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL,
+    0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+    0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL,
+    0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+    0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL,
+    0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+    0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL,
+    0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+    0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL,
+    0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+    0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL,
+    0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+    0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL,
+    0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+    0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL,
+    0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+    0x9ae757596946075fULL, 0x3375788de9b06958ULL,
+    0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+    0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL,
+    0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+    0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL,
+    0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+    0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL,
+    0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+    0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL,
+    0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+    0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL,
+    0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+    0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL,
+    0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+    0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL,
+    0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+    0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL,
+    0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+    0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL,
+    0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+    0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL,
+    0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+    0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL,
+    0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+    0x802221226be55a64ULL, 0xc2494954da2c9789ULL,
+    0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+    0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL,
+    0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+    0x9c69a97284b578d7ULL, 0xff2a760414536efbULL,
+    0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+    0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL,
+    0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+    0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL,
+    0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+    0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL,
+    0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+    0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL,
+    0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+    0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL,
+    0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+    0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL,
+    0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+    0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL,
+    0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+    0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL,
+    0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+    0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL,
+    0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+    0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL,
+    0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+    0xa59bc234db398c25ULL, 0x43fab9837e699095ULL,
+    0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+    0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL,
+    0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+    0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL,
+    0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+    0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL,
+    0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+    0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL,
+    0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+    0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL,
+    0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+    0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL,
+    0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+    0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL,
+    0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+    0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL,
+    0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+    0x8fa475791a569d10ULL, 0xf96e017d694487bcULL,
+    0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+    0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL,
+    0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+    0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL,
+    0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+    0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL,
+    0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+    0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL,
+    0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+    0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL,
+    0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+    0x82a45b450226b39cULL, 0xecc0024661173473ULL,
+    0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+    0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL,
+    0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+    0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL,
+    0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+    0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL,
+    0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+    0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL,
+    0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+    0x98165af37b2153deULL, 0xc3727a337a8b704aULL,
+    0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+    0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL,
+    0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+    0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL,
+    0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+    0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL,
+    0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+    0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL,
+    0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+    0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL,
+    0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+    0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL,
+    0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+    0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL,
+    0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+    0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL,
+    0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+    0x83ea2b892091e44dULL, 0x934aed0aab460432ULL,
+    0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+    0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL,
+    0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+    0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL,
+    0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+    0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL,
+    0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+    0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL,
+    0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+    0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL,
+    0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+    0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL,
+    0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+    0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL,
+    0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+    0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL,
+    0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+    0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL,
+    0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+    0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL,
+    0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+    0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL,
+    0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+    0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL,
+    0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+    0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL,
+    0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+    0x8533285c936b35deULL, 0xd53a88958f87275fULL,
+    0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+    0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL,
+    0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+    0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL,
+    0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+    0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL,
+    0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+    0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL,
+    0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+    0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL,
+    0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+    0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL,
+    0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+    0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL,
+    0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+    0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL,
+    0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+    0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL,
+    0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+    0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL,
+    0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+    0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL,
+    0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+    0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL,
+    0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+    0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL,
+    0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+    0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL,
+    0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+    0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL,
+    0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+    0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL,
+    0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+    0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL,
+    0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+    0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL,
+    0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+    0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL,
+    0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+    0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL,
+    0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+    0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL,
+    0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+    0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL,
+    0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+    0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL,
+    0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+    0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL,
+    0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+    0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL,
+    0xb201833b35d63f73ULL, 0x2cd2cc6551e513daULL,
+    0xde81e40a034bcf4fULL, 0xf8077f7ea65e58d1ULL,
+    0x8b112e86420f6191ULL, 0xfb04afaf27faf782ULL,
+    0xadd57a27d29339f6ULL, 0x79c5db9af1f9b563ULL,
+    0xd94ad8b1c7380874ULL, 0x18375281ae7822bcULL,
+    0x87cec76f1c830548ULL, 0x8f2293910d0b15b5ULL,
+    0xa9c2794ae3a3c69aULL, 0xb2eb3875504ddb22ULL,
+    0xd433179d9c8cb841ULL, 0x5fa60692a46151ebULL,
+    0x849feec281d7f328ULL, 0xdbc7c41ba6bcd333ULL,
+    0xa5c7ea73224deff3ULL, 0x12b9b522906c0800ULL,
+    0xcf39e50feae16befULL, 0xd768226b34870a00ULL,
+    0x81842f29f2cce375ULL, 0xe6a1158300d46640ULL,
+    0xa1e53af46f801c53ULL, 0x60495ae3c1097fd0ULL,
+    0xca5e89b18b602368ULL, 0x385bb19cb14bdfc4ULL,
+    0xfcf62c1dee382c42ULL, 0x46729e03dd9ed7b5ULL,
+    0x9e19db92b4e31ba9ULL, 0x6c07a2c26a8346d1ULL
+};
+
+// Eisel-Lemire: finds the double nearest to mantissa * 10^exponent from the top bits of
+// mantissa times the 128-bit 5^exponent, and returns its bits without the sign. Returns
+// false in the rare cases where the truncated product cannot tell which way to round.
+static bool number_eisel_lemire(u64 mantissa, i64 exponent, u64 *bits) {
+    if (mantissa == 0 || exponent < -342) {
+        *bits = 0;
+        return true;
+    }
+    if (exponent > 308) {
+        *bits = NUMBER_F64_INFINITY_BITS;
+        return true;
+    }
+
+    i32 q = (i32)exponent;
+    u32 shift = (u32)__builtin_clzll(mantissa);
+    mantissa <<= shift;
+    const u64 *power = &number_powers_of_5[(q + 342) * 2];
+    u64 high;
+    u64 low = number_multiply(mantissa, power[0], &high);
+    // The 9 bits below the 55 that are kept are all ones, so the low half of the power can
+    // still carry into them.
+    if ((high & 0x1FF) == 0x1FF) {
+        u64 carry;
+        number_multiply(mantissa, power[1], &carry);
+        low += carry;
+        if (carry > low) high++;
+    }
+    if (low == UINT64_MAX && (q < -27 || q > 55)) return false;
+
+    u32 upper_bit = (u32)(high >> 63);
+    u64 significand = high >> (upper_bit + 9);
+    // floor(q * log2(10)) + 63, plus the bias.
+    i32 power2 = (((152170 + 65536) * q) >> 16) + 63 + (i32)upper_bit - (i32)shift + 1023;
+
+    if (power2 <= 0) {
+        // Subnormal: shift down to the fixed exponent and round, possibly up into the
+        // smallest normal.
+        if (-power2 + 1 >= 64) {
+            *bits = 0;
+            return true;
+        }
+        significand >>= -power2 + 1;
+        significand += significand & 1;
+        significand >>= 1;
+        power2 = significand < (1ULL << 52) ? 0 : 1;
+        *bits = significand | ((u64)power2 << 52);
+        return true;
+    }
+
+    // An exact product sitting halfway between two doubles rounds to even. Only small
+    // powers can be exact, and only then is low zero.
+    if (low <= 1 && q >= -4 && q <= 23 && (significand & 3) == 1 &&
+        (significand << (upper_bit + 9)) == high) {
+        significand &= ~1ULL;
+    }
+    significand += significand & 1;
+    significand >>= 1;
+    if (significand >= (2ULL << 52)) {
+        significand = 1ULL << 52;
+        power2++;
+    }
+    significand &= ~(1ULL << 52);
+    if (power2 >= 0x7FF) {
+        *bits = NUMBER_F64_INFINITY_BITS;
+        return true;
+    }
+    *bits = significand | ((u64)power2 << 52);
+    return true;
+}
+
+static bool number_match_word(const u8 *p, const u8 *end, const char *word) {
+    usize length = strlen(word);
+    if ((usize)(end - p) != length) return false;
+    for (usize i = 0; i < length; i++) {
+        if ((p[i] | 0x20) != (u8)word[i]) return false;
+    }
+    return true;
+}
+
+bool string_parse_f64(String str, f64 *value) {
+    const u8 *p = str.buffer;
+    const u8 *end = p + str.length;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    u64 sign = (u64)negative << 63;
+    if (number_match_word(p, end, "inf") || number_match_word(p, end, "infinity")) {
+        *value = number_f64_from_bits(sign | NUMBER_F64_INFINITY_BITS);
+        return true;
+    }
+    if (number_match_word(p, end, "nan")) {
+        *value = number_f64_from_bits(sign | NUMBER_F64_NAN_BITS);
+        return true;
+    }
+
+    // Split into at most 19 significant digits and a power of ten. Leading zeros do not
+    // count, and digits past the 19th only move the exponent, noting whether they were
+    // anything but zeros.
+    const u8 *start = p;
+    u64 mantissa = 0;
+    i64 exponent = 0;
+    bool truncated = false;
+    while (p < end && *p == '0') p++;
+    const u8 *integer = p;
+    p = number_parse_digits(p, end, 19, &mantissa);
+    usize digits = (usize)(p - integer);
+    for (; p < end && number_is_digit(*p); p++) {
+        exponent++;
+        truncated |= *p != '0';
+    }
+    bool any_digits = p > start;
+
+    if (p < end && *p == '.') {
+        p++;
+        const u8 *fraction = p;
+        if (digits == 0) {
+            while (p < end && *p == '0') p++;
+        }
+        const u8 *significant = p;
+        p = number_parse_digits(p, end, 19 - digits, &mantissa);
+        digits += (usize)(p - significant);
+        exponent -= p - fraction;
+        for (; p < end && number_is_digit(*p); p++) {
+            truncated |= *p != '0';
+        }
+        any_digits |= p > fraction;
+    }
+    if (!any_digits) return false;
+
+    if (p < end && (*p | 0x20) == 'e') {
+        p++;
+        bool exponent_negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exponent_negative = *p == '-';
+            p++;
+        }
+        if (p == end || !number_is_digit(*p)) return false;
+        // Anything this large is already zero or infinity, so stop counting there.
+        i64 explicit_exponent = 0;
+        for (; p < end && number_is_digit(*p); p++) {
+            if (explicit_exponent < 100000) explicit_exponent = explicit_exponent * 10 + (*p - '0');
+        }
+        exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+    }
+    if (p != end) return false;
+
+    // Clinger's fast path: both the mantissa and the power of ten are exact doubles, so
+    // one rounded multiply or divide gives the correctly rounded result.
+#if FLT_EVAL_METHOD == 0
+    if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        f64 result = (f64)mantissa;
+        if (exponent < 0) {
+            result /= number_exact_powers_of_10[-exponent];
+        } else {
+            result *= number_exact_powers_of_10[exponent];
+        }
+        *value = negative ? -result : result;
+        return true;
+    }
+#endif
+
+    // Truncated digits put the value between mantissa and mantissa + 1, which is only good
+    // enough if both round the same way.
+    u64 bits, upper_bits;
+    if (number_eisel_lemire(mantissa, exponent, &bits) &&
+        (!truncated || (number_eisel_lemire(mantissa + 1, exponent, &upper_bits) && bits == upper_bits))) {
+        *value = number_f64_from_bits(sign | bits);
+        return true;
+    }
+
+    // Whatever is left is rare enough to hand to strtod, on a terminated copy since str
+    // is not. The syntax was checked above, so it reads exactly what we did.
+    char local[128];
+    char *copy = str.length < sizeof(local)
+        ? local
+        : (char *)allocator_alloc_uninit(&heap_allocator, str.length + 1);
+    memcpy(copy, str.buffer, str.length);
+    copy[str.length] = '\0';
+    *value = strtod(copy, NULL);
+    if (copy != local) heap_allocator.free(&heap_allocator, copy);
+    return true;
+}
+
+usize format_u64(char *buffer, u64 value) {
+    char digits[20];
+    char *start = string_format_u64(digits + sizeof(digits), value);
+    usize length = (usize)(digits + sizeof(digits) - start);
+    memcpy(buffer, start, length);
+    return length;
+}
+
+usize format_i64(char *buffer, i64 value) {
+    if (value >= 0) return format_u64(buffer, (u64)value);
+    buffer[0] = '-';
+    // Negated as unsigned so INT64_MIN does not overflow.
+    return 1 + format_u64(buffer + 1, (u64)0 - (u64)value);
+}
+
+// Schubfach (Giulietti, "The Schubfach way to render doubles", the algorithm behind the
+// JDK's Double.toString): the double and the bounds of its rounding interval are scaled by
+// a power of ten that leaves the interval just over 1 wide, a 64x126-bit multiply each.
+// The scaled interval holds at most one multiple of 10 and at most two integers, so the
+// shortest decimal that reads back as the double, the closest one if there are two, falls
+// out of a few comparisons.
+
+// 10^e for e from -292 to 324 as g = floor(10^e / 2^r) + 1 for the r that puts g in
+// [2^125, 2^126), split into g1 * 2^63 + g0. The power-of-five table has the same
+// significand two bits wider, so this is exact.
+static inline void number_schubfach_power(i32 e, u64 *g1, u64 *g0) {
+    const u64 *power = &number_powers_of_5[(e + 342) * 2];
+    u64 high = power[0];
+    u64 low = power[1];
+    if (e >= -27 && e < 0) {
+        if (low == 0) high--;
+        low--;
+    }
+    low = (low >> 2) | (high << 62);
+    high >>= 2;
+    low++;
+    if (low == 0) high++;
+    *g1 = (high << 1) | (low >> 63);
+    *g0 = low & ((1ULL << 63) - 1);
+}
+
+// g * cp / 2^127 rounded to odd: the integer part, with the lowest bit set if anything was
+// cut off.
+static inline u64 number_schubfach_round(u64 g1, u64 g0, u64 cp) {
+    u64 x1;
+    number_multiply(g0, cp, &x1);
+    u64 y1;
+    u64 y0 = number_multiply(g1, cp, &y1);
+    u64 z = (y0 >> 1) + x1;
+    u64 integral = y1 + (z >> 63);
+    return integral | (((z & ((1ULL << 63) - 1)) + ((1ULL << 63) - 1)) >> 63);
+}
+
+// Sets *decimal * 10^*exponent to the shortest decimal that reads back as c * 2^q.
+static void number_schubfach(i32 q, u64 c, u64 *decimal, i32 *exponent) {
+    u64 cb = c << 2;
+    u64 cbr = cb + 2;
+    u64 cbl;
+    i32 k;
+    // k = floor(log10(2^q)), or floor(log10(3/4 2^q)) when the interval is lopsided: a
+    // power of two has its lower neighbour twice as close as its upper one.
+    if (c != (1ULL << 52) || q == -1074) {
+        cbl = cb - 2;
+        k = (i32)(((i64)q * 661971961083LL) >> 41);
+    } else {
+        cbl = cb - 1;
+        k = (i32)(((i64)q * 661971961083LL - 274743187321LL) >> 41);
+    }
+    // Plus floor(log2(10^-k)).
+    i32 h = q + (i32)(((i64)-k * 913124641741LL) >> 38) + 2;
+
+    u64 g1, g0;
+    number_schubfach_power(-k, &g1, &g0);
+    u64 vb = number_schubfach_round(g1, g0, cb << h);
+    u64 vbl = number_schubfach_round(g1, g0, cbl << h);
+    u64 vbr = number_schubfach_round(g1, g0, cbr << h);
+    // Even significands round to themselves from the bounds, so the bounds are included.
+    u64 out = c & 1;
+
+    *exponent = k;
+    u64 s = vb >> 2;
+    if (s >= 10) {
+        // One digit shorter: at most one of the multiples of 10 around s is inside.
+        u64 sp10 = s / 10 * 10;
+        u64 tp10 = sp10 + 10;
+        bool upin = vbl + out <= sp10 << 2;
+        bool wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin) {
+            *decimal = upin ? sp10 : tp10;
+            return;
+        }
+    }
+    u64 t = s + 1;
+    bool uin = vbl + out <= s << 2;
+    bool win = (t << 2) + out <= vbr;
+    if (uin != win) {
+        *decimal = uin ? s : t;
+        return;
+    }
+    // Both are inside: the closer one, the even one on a tie.
+    u64 middle = (s + t) << 1;
+    *decimal = vb < middle || (vb == middle && (s & 1) == 0) ? s : t;
+}
+
+usize format_f64(char *buffer, f64 value) {
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char *out = buffer;
+    u64 magnitude = bits & ~(1ULL << 63);
+    if (magnitude > NUMBER_F64_INFINITY_BITS) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    if (bits >> 63) *out++ = '-';
+    if (magnitude == NUMBER_F64_INFINITY_BITS) {
+        memcpy(out, "inf", 3);
+        return (usize)(out - buffer) + 3;
+    }
+    if (magnitude == 0) {
+        *out++ = '0';
+        return (usize)(out - buffer);
+    }
+
+    u64 fraction = magnitude & ((1ULL << 52) - 1);
+    i32 biased = (i32)(magnitude >> 52);
+    u64 decimal;
+    i32 k;
+    if (biased != 0) {
+        u64 c = fraction | (1ULL << 52);
+        i32 shift = 1075 - biased;
+        if (shift > 0 && shift < 53 && (c >> shift) << shift == c) {
+            // A whole number below 2^53, its digits are already the shortest.
+            decimal = c >> shift;
+            k = 0;
+        } else {
+            number_schubfach(-shift, c, &decimal, &k);
+        }
+    } else {
+        number_schubfach(-1074, fraction, &decimal, &k);
+    }
+
+    char digits[24];
+    i32 length = (i32)format_u64(digits, decimal);
+    while (digits[length - 1] == '0') {
+        length--;
+        k++;
+    }
+    // The value is 0.digits * 10^point.
+    i32 point = length + k;
+
+    if (k >= 0 && point <= 21) {
+        // 1234e7 -> 12340000000
+        memcpy(out, digits, (usize)length);
+        memset(out + length, '0', (usize)k);
+        out += point;
+    } else if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memcpy(out, digits, (usize)point);
+        out[point] = '.';
+        memcpy(out + point + 1, digits + point, (usize)(length - point));
+        out += length + 1;
+    } else if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        out[0] = '0';
+        out[1] = '.';
+        memset(out + 2, '0', (usize)-point);
+        memcpy(out + 2 - point, digits, (usize)length);
+        out += 2 - point + length;
+    } else {
+        // 1234e30 -> 1.234e33
+        *out++ = digits[0];
+        if (length > 1) {
+            *out++ = '.';
+            memcpy(out, digits + 1, (usize)(length - 1));
+            out += length - 1;
+        }
+        *out++ = 'e';
+        i32 exponent = point - 1;
+        if (exponent < 0) {
+            *out++ = '-';
+            exponent = -exponent;
+        }
+        out += format_u64(out, (u64)exponent);
+    }
+    return (usize)(out - buffer);
+}
+
+String string_from_u64(u64 value, Allocator *allocator) {
+    char buffer[NUMBER_FORMAT_MAX];
+    usize length = format_u64(buffer, value);
+    String str = string_new(length, allocator);
+    memcpy(str.buffer, buffer, length);
+    return str;
+}
+
+String string_from_i64(i64 value, Allocator *allocator) {
+    char buffer[NUMBER_FORMAT_MAX];
+    usize length = format_i64(buffer, value);
+    String str = string_new(length, allocator);
+    memcpy(str.buffer, buffer, length);
+    return str;
+}
+
+String string_from_f64(f64 value, Allocator *allocator) {
+    char buffer[NUMBER_FORMAT_MAX];
+    usize length = format_f64(buffer, value);
+    String str = string_new(length, allocator);
+    memcpy(str.buffer, buffer, length);
+    return str;
+}
+
+// -------------
+// --- Files ---
+// -------------
+
+bool file_map(const char *path, FileMapFlags flags, String *file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return false;
     }
-    else {
-        if (difference <= 0) {
-            return ptr;
-        }
-        else {
-            void *new_ptr = arena_alloc(arena, new_size);
-            memcpy(new_ptr, ptr, old_size);
-            arena->last_alloc = new_ptr;
-            return new_ptr;
-        }
+
+    // mmap rejects empty mappings, and string_free wants a buffer.
+    if (info.st_size == 0) {
+        close(fd);
+        file->buffer = (u8 *)"";
+        file->length = 0;
+        file->allocator = NULL;
+        return true;
     }
+
+    usize length = (usize)info.st_size;
+    void *buffer = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (buffer == MAP_FAILED) return false;
+
+    if (flags & FILE_MAP_SEQUENTIAL) madvise(buffer, length, MADV_SEQUENTIAL);
+    if (flags & FILE_MAP_RANDOM) madvise(buffer, length, MADV_RANDOM);
+    if (flags & FILE_MAP_WILLNEED) madvise(buffer, length, MADV_WILLNEED);
+
+    file->buffer = (u8 *)buffer;
+    file->length = length;
+    file->allocator = NULL;
+    return true;
 }
 
-void arena_reset(Arena *arena) {
-    arena->offset = 0;
+void file_unmap(String *file) {
+    if (file->length > 0) {
+        munmap(file->buffer, file->length);
+    }
+    file->buffer = NULL;
+    file->length = 0;
 }
 
-void arena_free(Arena *arena) {
-    arena->backing_allocator->free(arena->backing_allocator, arena->buffer);
-    arena->buffer = NULL;
-    arena->capacity = 0;
-    arena->offset = 0;
+Reader reader_new(int fd, usize capacity, Allocator *allocator) {
+    if (capacity == 0) capacity = READER_BUFFER_SIZE;
+    Reader reader = {
+        .fd = fd,
+        .buffer = (u8 *)allocator_alloc_uninit(allocator, capacity),
+        .capacity = capacity,
+        .allocator = allocator
+    };
+    return reader;
 }
 
-// ---------------
-// --- Strings ---
-// ---------------
+// Reads more input after the buffered bytes, first moving them to the front and growing
+// the buffer if it is full. Returns false once nothing more can be read.
+static bool reader_fill(Reader *reader) {
+    if (reader->eof) return false;
 
-String string(const char *cstr, Allocator *allocator) {
-    usize length = strlen(cstr);
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == reader->capacity) {
+        reader->buffer = (u8 *)reader->allocator->realloc(
+            reader->allocator, reader->buffer, reader->capacity, reader->capacity * 2);
+        reader->capacity *= 2;
+    }
+
+    for (;;) {
+        ssize_t count = read(reader->fd, reader->buffer + reader->end, reader->capacity - reader->end);
+        if (count > 0) {
+            reader->end += (usize)count;
+            return true;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        reader->error = count < 0;
+        reader->eof = true;
+        return false;
+    }
+}
+
+String reader_peek(Reader *reader, usize count) {
+    while (reader->end - reader->start < count && reader_fill(reader)) {}
+    usize available = reader->end - reader->start;
     String str = {
-        .buffer = (u8 *)allocator->alloc(allocator, length),
-        .length = length,
-        .allocator = allocator
+        .buffer = reader->buffer + reader->start,
+        .length = available < count ? available : count,
+        .allocator = NULL
     };
-    memcpy(str.buffer, cstr, length + 1);
     return str;
 }
 
-String string_new(usize length, Allocator *allocator) {
-    String str = {
-        .buffer = (u8 *)allocator->alloc(allocator, length),
-        .length = length,
+void reader_skip(Reader *reader, usize count) {
+    while (count > 0) {
+        usize available = reader->end - reader->start;
+        if (available == 0 && !reader_fill(reader)) return;
+        available = reader->end - reader->start;
+        usize skipped = available < count ? available : count;
+        reader->start += skipped;
+        count -= skipped;
+    }
+}
+
+usize reader_read(Reader *reader, void *destination, usize count) {
+    usize copied = 0;
+    while (copied < count) {
+        usize available = reader->end - reader->start;
+        if (available == 0) {
+            // Large reads skip the buffer.
+            if (count - copied >= reader->capacity && !reader->eof) {
+                ssize_t result = read(reader->fd, (u8 *)destination + copied, count - copied);
+                if (result > 0) {
+                    copied += (usize)result;
+                    continue;
+                }
+                if (result < 0 && errno == EINTR) continue;
+                reader->error = result < 0;
+                reader->eof = true;
+                break;
+            }
+            if (!reader_fill(reader)) break;
+            available = reader->end - reader->start;
+        }
+        usize chunk = available < count - copied ? available : count - copied;
+        memcpy((u8 *)destination + copied, reader->buffer + reader->start, chunk);
+        reader->start += chunk;
+        copied += chunk;
+    }
+    return copied;
+}
+
+bool reader_read_until(Reader *reader, u8 delimiter, String *record) {
+    // Bytes before scanned are known not to hold the delimiter.
+    usize scanned = 0;
+    for (;;) {
+        u8 *start = reader->buffer + reader->start;
+        usize available = reader->end - reader->start;
+        u8 *end = available > scanned
+            ? (u8 *)memchr(start + scanned, delimiter, available - scanned)
+            : NULL;
+        if (end != NULL) {
+            record->buffer = start;
+            record->length = (usize)(end - start);
+            record->allocator = NULL;
+            reader->start += record->length + 1;
+            return true;
+        }
+        scanned = available;
+        if (!reader_fill(reader)) {
+            if (available == 0) return false;
+            record->buffer = reader->buffer + reader->start;
+            record->length = available;
+            record->allocator = NULL;
+            reader->start = reader->end;
+            return true;
+        }
+    }
+}
+
+bool reader_read_line(Reader *reader, String *line) {
+    if (!reader_read_until(reader, '\n', line)) return false;
+    if (line->length > 0 && line->buffer[line->length - 1] == '\r') {
+        line->length--;
+    }
+    return true;
+}
+
+void reader_free(Reader *reader) {
+    reader->allocator->free(reader->allocator, reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+    reader->start = 0;
+    reader->end = 0;
+}
+
+Writer writer_new(int fd, usize capacity, Allocator *allocator) {
+    if (capacity == 0) capacity = WRITER_BUFFER_SIZE;
+    Writer writer = {
+        .fd = fd,
+        .buffer = (u8 *)allocator_alloc_uninit(allocator, capacity),
+        .capacity = capacity,
         .allocator = allocator
     };
-    return str;
+    return writer;
 }
 
-String string_concat(String a, String b, Allocator *allocator) {
-    String str = {
-        .buffer = (u8 *)allocator->alloc(allocator, a.length + b.length),
-        .length = a.length + b.length,
-        .allocator = allocator
+// Writes all of the vectors, retrying after short writes.
+static void writer_write_vectors(Writer *writer, struct iovec *vectors, int count) {
+    while (count > 0 && !writer->error) {
+        ssize_t written = writev(writer->fd, vectors, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            writer->error = true;
+            return;
+        }
+        usize remaining = (usize)written;
+        while (count > 0 && remaining >= vectors->iov_len) {
+            remaining -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if (count > 0) {
+            vectors->iov_base = (u8 *)vectors->iov_base + remaining;
+            vectors->iov_len -= remaining;
+        }
+    }
+}
+
+void writer_write(Writer *writer, String str) {
+    if (str.length <= writer->capacity - writer->length) {
+        memcpy(writer->buffer + writer->length, str.buffer, str.length);
+        writer->length += str.length;
+        return;
+    }
+
+    // Small writes that only overflow the buffer refill it after a flush, larger ones go
+    // out directly behind the buffered bytes.
+    struct iovec vectors[2] = {
+        { .iov_base = writer->buffer, .iov_len = writer->length },
+        { .iov_base = str.buffer, .iov_len = str.length }
     };
-    memcpy(str.buffer, a.buffer, a.length);
-    memcpy(str.buffer + a.length, b.buffer, b.length);
-    return str;
+    if (str.length < writer->capacity / 2) {
+        writer_write_vectors(writer, vectors, 1);
+        memcpy(writer->buffer, str.buffer, str.length);
+        writer->length = str.length;
+    } else {
+        writer_write_vectors(writer, vectors, 2);
+        writer->length = 0;
+    }
 }
 
-String string_slice(String string, usize start, usize end) {
+void writer_write_cstr(Writer *writer, const char *cstr) {
     String str = {
-        .buffer = string.buffer + start,
-        .length = end - start,
+        .buffer = (u8 *)cstr,
+        .length = strlen(cstr),
         .allocator = NULL
     };
-    return str;
-}
-
-bool string_eq(String a, String b) {
-    if (a.length != b.length) return false;
-    for (usize i = 0; i < a.length; i++) {
-        if (a.buffer[i] != b.buffer[i]) return false;
-    }
-    return true;
+    writer_write(writer, str);
 }
 
-bool string_eq_cstr(String a, const char *cstr) {
-    usize length = strlen(cstr);
-    if (a.length != length) return false;
-    for (usize i = 0; i < a.length; i++) {
-        if (a.buffer[i] != cstr[i]) return false;
+void writer_write_byte(Writer *writer, u8 byte) {
+    if (writer->length == writer->capacity) {
+        writer_flush(writer);
     }
-    return true;
+    writer->buffer[writer->length++] = byte;
 }
 
-u64 string_hash(String str) {
-    // FNV-1a hash for strings
-    u64 hash = 14695981039346656037ULL; // FNV offset basis
-    for (usize i = 0; i < str.length; i++) {
-        hash ^= str.buffer[i];
-        hash *= 1099511628211ULL; // FNV prime
-    }
-    return hash;
+bool writer_flush(Writer *writer) {
+    struct iovec vector = { .iov_base = writer->buffer, .iov_len = writer->length };
+    writer_write_vectors(writer, &vector, 1);
+    writer->length = 0;
+    return !writer->error;
 }
 
-void string_free(String *string) {
-    ASSERT(string != NULL);
-    ASSERT(string->buffer != NULL);
-    if (string->allocator == NULL) return;
-    string->allocator->free(string->allocator, string->buffer);
-    string->buffer = NULL;
-    string->length = 0;
+bool writer_free(Writer *writer) {
+    bool flushed = writer_flush(writer);
+    writer->allocator->free(writer->allocator, writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+    return flushed;
 }
 
 // -------------------
@@ -615,17 +6398,571 @@ bool integer_eq(u64 a, u64 b) {
 }
 
 u64 cstr_hash(const char *str) {
-    // FNV-1a hash for strings
-    u64 hash = 14695981039346656037ULL; // FNV offset basis
-    for (usize i = 0; i < strlen(str); i++) {
-        hash ^= str[i];
-        hash *= 1099511628211ULL; // FNV prime
-    }
-    return hash;
+    return hash_bytes(str, strlen(str), 0);
 }
 
 bool cstr_eq(const char *a, const char *b) {
     return strcmp(a, b) == 0;
 }
 
+// ------------------------
+// --- String Interning ---
+// ------------------------
+
+static InternerIndex *interner_index_new(Allocator *allocator, usize capacity) {
+    InternerIndex *index = (InternerIndex *)allocator->alloc(
+        allocator, sizeof(InternerIndex) + sizeof(InternerSlot) * capacity);
+    index->capacity = capacity;
+    return index;
+}
+
+static inline u64 interner_slot(u64 hash, u32 id) {
+    return (hash & 0xFFFFFFFF00000000ULL) | ((u64)id + 1);
+}
+
+// Chunk k holds INTERNER_CHUNK_SIZE << k entries, starting at id
+// INTERNER_CHUNK_SIZE * (2^k - 1).
+static inline InternerEntry *interner_entry(Interner *interner, u32 id) {
+    u64 scaled = (u64)id / INTERNER_CHUNK_SIZE + 1;
+    u32 chunk = 63 - (u32)__builtin_clzll(scaled);
+    u64 start = (((u64)1 << chunk) - 1) * INTERNER_CHUNK_SIZE;
+    InternerEntry *entries = __atomic_load_n(&interner->chunks[chunk], __ATOMIC_ACQUIRE);
+    return &entries[id - start];
+}
+
+Interner interner_new(Allocator *allocator) {
+    Interner interner = {
+        .index = interner_index_new(allocator, 64),
+        .arena = arena_new_growable(INTERNER_BLOCK_SIZE, 16 * INTERNER_BLOCK_SIZE,
+                                    ARENA_RESET_RELEASE, allocator),
+        .allocator = allocator
+    };
+    return interner;
+}
+
+static bool interner_probe(InternerIndex *index, String str, u64 hash, u32 *id) {
+    usize mask = index->capacity - 1;
+    u64 tag = hash & 0xFFFFFFFF00000000ULL;
+    for (usize i = hash & mask;; i = (i + 1) & mask) {
+        InternerSlot *slot = &index->slots[i];
+        u64 hash_id = __atomic_load_n(&slot->hash_id, __ATOMIC_ACQUIRE);
+        if (hash_id == 0) return false;
+        if ((hash_id & 0xFFFFFFFF00000000ULL) != tag) continue;
+
+        // The length sits right before the bytes.
+        u32 length;
+        memcpy(&length, slot->buffer - sizeof(u32), sizeof(u32));
+        if (length == str.length && memcmp(slot->buffer, str.buffer, str.length) == 0) {
+            *id = (u32)hash_id - 1;
+            return true;
+        }
+    }
+}
+
+bool interner_find(Interner *interner, String str, u32 *id) {
+    InternerIndex *index = __atomic_load_n(&interner->index, __ATOMIC_ACQUIRE);
+    return interner_probe(index, str, string_hash(str), id);
+}
+
+static void interner_insert_slot(InternerIndex *index, InternerEntry *entry, u32 id) {
+    usize mask = index->capacity - 1;
+    usize i = entry->hash & mask;
+    while (index->slots[i].hash_id != 0) {
+        i = (i + 1) & mask;
+    }
+    index->slots[i].buffer = entry->buffer;
+    __atomic_store_n(&index->slots[i].hash_id, interner_slot(entry->hash, id), __ATOMIC_RELEASE);
+}
+
+// Rebuilds the index at twice the size from the entries, which keep their full hashes.
+static void interner_grow(Interner *interner) {
+    InternerIndex *old_index = interner->index;
+    InternerIndex *index = interner_index_new(interner->allocator, old_index->capacity * 2);
+    for (u32 id = 0; id < interner->count; id++) {
+        interner_insert_slot(index, interner_entry(interner, id), id);
+    }
+    old_index->retired_next = interner->retired;
+    interner->retired = old_index;
+    __atomic_store_n(&interner->index, index, __ATOMIC_RELEASE);
+}
+
+u32 interner_intern(Interner *interner, String str) {
+    u64 hash = string_hash(str);
+    u32 id;
+    if (interner_probe(__atomic_load_n(&interner->index, __ATOMIC_ACQUIRE), str, hash, &id)) {
+        return id;
+    }
+
+    spin_lock_acquire(&interner->lock);
+    // Another thread may have interned it since the lookup above.
+    if (interner_probe(interner->index, str, hash, &id)) {
+        spin_lock_release(&interner->lock);
+        return id;
+    }
+
+    id = interner->count;
+    ASSERT(id < UINT32_MAX && "Interner is full");
+    if (((usize)id + 1) * 2 > interner->index->capacity) {
+        interner_grow(interner);
+    }
+
+    u64 scaled = (u64)id / INTERNER_CHUNK_SIZE + 1;
+    u32 chunk = 63 - (u32)__builtin_clzll(scaled);
+    if (interner->chunks[chunk] == NULL) {
+        ASSERT(chunk < INTERNER_MAX_CHUNKS);
+        InternerEntry *entries = (InternerEntry *)allocator_alloc_uninit(
+            interner->allocator, sizeof(InternerEntry) * ((usize)INTERNER_CHUNK_SIZE << chunk));
+        __atomic_store_n(&interner->chunks[chunk], entries, __ATOMIC_RELEASE);
+    }
+
+    ASSERT(str.length < UINT32_MAX && "String too long to intern");
+    u32 length = (u32)str.length;
+    u8 *buffer = (u8 *)arena_alloc_aligned(&interner->arena, sizeof(u32) + str.length + 1,
+                                           sizeof(u32));
+    memcpy(buffer, &length, sizeof(u32));
+    buffer += sizeof(u32);
+    memcpy(buffer, str.buffer, str.length);
+    buffer[str.length] = '\0';
+    InternerEntry *entry = interner_entry(interner, id);
+    entry->buffer = buffer;
+    entry->length = str.length;
+    entry->hash = hash;
+
+    // The release store of the slot publishes the entry and its bytes to readers.
+    interner_insert_slot(interner->index, entry, id);
+    __atomic_store_n(&interner->count, id + 1, __ATOMIC_RELEASE);
+    spin_lock_release(&interner->lock);
+    return id;
+}
+
+u32 interner_intern_cstr(Interner *interner, const char *cstr) {
+    String str = {
+        .buffer = (u8 *)cstr,
+        .length = strlen(cstr),
+        .allocator = NULL
+    };
+    return interner_intern(interner, str);
+}
+
+String interner_string(Interner *interner, u32 id) {
+    ASSERT(id < __atomic_load_n(&interner->count, __ATOMIC_ACQUIRE));
+    InternerEntry *entry = interner_entry(interner, id);
+    String str = {
+        .buffer = (u8 *)entry->buffer,
+        .length = entry->length,
+        .allocator = NULL
+    };
+    return str;
+}
+
+const char *interner_cstr(Interner *interner, u32 id) {
+    return (const char *)interner_string(interner, id).buffer;
+}
+
+u32 interner_count(Interner *interner) {
+    return __atomic_load_n(&interner->count, __ATOMIC_ACQUIRE);
+}
+
+void interner_reclaim(Interner *interner) {
+    while (interner->retired != NULL) {
+        InternerIndex *next = interner->retired->retired_next;
+        interner->allocator->free(interner->allocator, interner->retired);
+        interner->retired = next;
+    }
+}
+
+void interner_free(Interner *interner) {
+    interner_reclaim(interner);
+    interner->allocator->free(interner->allocator, interner->index);
+    interner->index = NULL;
+    for (u32 i = 0; i < INTERNER_MAX_CHUNKS; i++) {
+        if (interner->chunks[i] != NULL) {
+            interner->allocator->free(interner->allocator, interner->chunks[i]);
+            interner->chunks[i] = NULL;
+        }
+    }
+    interner->count = 0;
+    arena_free(&interner->arena);
+}
+
+// -------------------
+// --- Thread Pool ---
+// -------------------
+
+static THREAD_LOCAL ThreadPoolWorker *thread_pool_current_worker = NULL;
+static THREAD_LOCAL u32 thread_pool_steal_seed = 0;
+
+// Slots are written and read a word at a time with relaxed atomics. A thief can read a
+// slot the owner is overwriting only after the deque wrapped around under it, and then
+// its CAS on top fails and the torn copy is dropped.
+static inline void task_store(Task *slot, Task task) {
+    __atomic_store_n(&slot->function, task.function, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->context, task.context, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->group, task.group, __ATOMIC_RELAXED);
+}
+
+static inline Task task_load(Task *slot) {
+    Task task = {
+        .function = __atomic_load_n(&slot->function, __ATOMIC_RELAXED),
+        .context = __atomic_load_n(&slot->context, __ATOMIC_RELAXED),
+        .group = __atomic_load_n(&slot->group, __ATOMIC_RELAXED)
+    };
+    return task;
+}
+
+// The deque operations follow Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+// Work-Stealing for Weak Memory Models".
+static bool task_deque_push(TaskDeque *deque, Task task) {
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= TASK_DEQUE_CAPACITY) return false;
+    task_store(&deque->tasks[bottom & (TASK_DEQUE_CAPACITY - 1)], task);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool task_deque_pop(TaskDeque *deque, Task *task) {
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *task = task_load(&deque->tasks[bottom & (TASK_DEQUE_CAPACITY - 1)]);
+    if (top < bottom) return true;
+
+    // The last task, which a thief may be taking at the same time.
+    bool won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+static bool task_deque_steal(TaskDeque *deque, Task *task) {
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) return false;
+    *task = task_load(&deque->tasks[top & (TASK_DEQUE_CAPACITY - 1)]);
+    return __atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static ThreadPoolWorker *thread_pool_worker_of(ThreadPool *pool) {
+    ThreadPoolWorker *worker = thread_pool_current_worker;
+    return worker != NULL && worker->pool == pool ? worker : NULL;
+}
+
+// Takes a task from the caller's own deque, then the shared queue, then another worker's
+// deque, starting at a random one so thieves spread out.
+static bool thread_pool_take(ThreadPool *pool, ThreadPoolWorker *self, Task *task) {
+    bool found = self != NULL && task_deque_pop(&self->deque, task);
+
+    if (!found && __atomic_load_n(&pool->queue_length, __ATOMIC_RELAXED) > 0) {
+        spin_lock_acquire(&pool->queue_lock);
+        if (pool->queue_length > 0) {
+            *task = pool->queue[pool->queue_head];
+            pool->queue_head = (pool->queue_head + 1) & (pool->queue_capacity - 1);
+            __atomic_store_n(&pool->queue_length, pool->queue_length - 1, __ATOMIC_RELAXED);
+            found = true;
+        }
+        spin_lock_release(&pool->queue_lock);
+    }
+
+    if (!found) {
+        u32 seed = thread_pool_steal_seed;
+        if (seed == 0) seed = (u32)hash_mix((u64)(usize)&seed, 0) | 1;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        thread_pool_steal_seed = seed;
+
+        u32 count = pool->worker_count;
+        for (u32 i = 0; i < count && !found; i++) {
+            ThreadPoolWorker *victim = &pool->workers[(seed + i) % count];
+            if (victim != self) found = task_deque_steal(&victim->deque, task);
+        }
+    }
+
+    if (found) __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELAXED);
+    return found;
+}
+
+static void thread_pool_run(Task task) {
+    task.function(task.context);
+    // The group may be gone as soon as this lands, so it is the last touch.
+    if (task.group != NULL) __atomic_sub_fetch(&task.group->pending, 1, __ATOMIC_RELEASE);
+}
+
+// Sleepers check pending under the mutex and spawners check sleepers after raising
+// pending, both sequentially consistent, so either the sleeper sees the task or the
+// spawner sees the sleeper and wakes it.
+static void thread_pool_sleep(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) == 0 &&
+           !__atomic_load_n(&pool->stopping, __ATOMIC_RELAXED)) {
+        pthread_cond_wait(&pool->wake, &pool->mutex);
+    }
+    __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void *thread_pool_worker_main(void *argument) {
+    ThreadPoolWorker *self = (ThreadPoolWorker *)argument;
+    ThreadPool *pool = self->pool;
+    thread_pool_current_worker = self;
+
+    u32 idle = 0;
+    for (;;) {
+        Task task;
+        if (thread_pool_take(pool, self, &task)) {
+            thread_pool_run(task);
+            idle = 0;
+        } else if (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) != 0) {
+            // Someone queued a task that is not visible yet, or lost a race for it.
+            CPU_RELAX();
+        } else if (__atomic_load_n(&pool->stopping, __ATOMIC_ACQUIRE)) {
+            break;
+        } else if (++idle < 64) {
+            CPU_RELAX();
+        } else {
+            thread_pool_sleep(pool);
+            idle = 0;
+        }
+    }
+
+    scratch_free();
+    thread_pool_current_worker = NULL;
+    return NULL;
+}
+
+void thread_pool_start(ThreadPool *pool, u32 worker_count, Allocator *allocator) {
+    if (worker_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cpus > 0 ? (u32)cpus : 1;
+    }
+    memset(pool, 0, sizeof(*pool));
+    pool->allocator = allocator;
+    pool->worker_count = worker_count;
+    pool->queue_capacity = 64;
+    pool->queue = (Task *)allocator_alloc_uninit(allocator, sizeof(Task) * pool->queue_capacity);
+    ASSERT(pthread_mutex_init(&pool->mutex, NULL) == 0);
+    ASSERT(pthread_cond_init(&pool->wake, NULL) == 0);
+
+    pool->workers = (ThreadPoolWorker *)allocator_alloc_aligned(
+        allocator, sizeof(ThreadPoolWorker) * worker_count, CACHE_LINE_SIZE);
+    memset(pool->workers, 0, sizeof(ThreadPoolWorker) * worker_count);
+    for (u32 i = 0; i < worker_count; i++) {
+        ThreadPoolWorker *worker = &pool->workers[i];
+        worker->deque.tasks = (Task *)allocator_alloc_uninit(allocator, sizeof(Task) * TASK_DEQUE_CAPACITY);
+        worker->pool = pool;
+        worker->index = i;
+    }
+    // Every deque exists before any worker can try to steal from it.
+    for (u32 i = 0; i < worker_count; i++) {
+        ASSERT(pthread_create(&pool->workers[i].thread, NULL, thread_pool_worker_main, &pool->workers[i]) == 0);
+    }
+}
+
+void thread_pool_stop(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    __atomic_store_n(&pool->stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (u32 i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        pool->allocator->free(pool->allocator, pool->workers[i].deque.tasks);
+    }
+    pool->allocator->free(pool->allocator, pool->workers);
+    pool->allocator->free(pool->allocator, pool->queue);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+    pool->workers = NULL;
+    pool->queue = NULL;
+    pool->worker_count = 0;
+}
+
+u32 thread_pool_worker_count(ThreadPool *pool) {
+    return pool->worker_count;
+}
+
+i32 thread_pool_worker_index(ThreadPool *pool) {
+    ThreadPoolWorker *worker = thread_pool_worker_of(pool);
+    return worker != NULL ? (i32)worker->index : -1;
+}
+
+TaskGroup task_group_new(ThreadPool *pool) {
+    TaskGroup group = {
+        .pool = pool,
+        .pending = 0
+    };
+    return group;
+}
+
+void task_group_spawn(TaskGroup *group, TaskFunction function, void *context) {
+    ThreadPool *pool = group->pool;
+    Task task = {
+        .function = function,
+        .context = context,
+        .group = group
+    };
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+    ThreadPoolWorker *self = thread_pool_worker_of(pool);
+    if (self != NULL) {
+        __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+        if (!task_deque_push(&self->deque, task)) {
+            __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELAXED);
+            thread_pool_run(task);
+            return;
+        }
+    } else {
+        spin_lock_acquire(&pool->queue_lock);
+        if (pool->queue_length == pool->queue_capacity) {
+            // Unwrap into a buffer twice the size.
+            Task *queue = (Task *)allocator_alloc_uninit(pool->allocator, sizeof(Task) * pool->queue_capacity * 2);
+            for (usize i = 0; i < pool->queue_length; i++) {
+                queue[i] = pool->queue[(pool->queue_head + i) & (pool->queue_capacity - 1)];
+            }
+            pool->allocator->free(pool->allocator, pool->queue);
+            pool->queue = queue;
+            pool->queue_head = 0;
+            pool->queue_capacity *= 2;
+        }
+        pool->queue[(pool->queue_head + pool->queue_length) & (pool->queue_capacity - 1)] = task;
+        __atomic_store_n(&pool->queue_length, pool->queue_length + 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+        spin_lock_release(&pool->queue_lock);
+    }
+
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+void task_group_wait(TaskGroup *group) {
+    ThreadPool *pool = group->pool;
+    ThreadPoolWorker *self = thread_pool_worker_of(pool);
+    u32 idle = 0;
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0) {
+        Task task;
+        if (thread_pool_take(pool, self, &task)) {
+            thread_pool_run(task);
+            idle = 0;
+        } else if (++idle < 64) {
+            CPU_RELAX();
+        } else {
+            // What is left is running on other threads.
+            sched_yield();
+        }
+    }
+}
+
+typedef struct {
+    usize start;
+    usize end;
+    usize grain;
+    usize chunk_count;
+    usize next_chunk;
+    ParallelForFunction function;
+    ParallelReduceFunction reduce;
+    void *context;
+    u8 *partials;
+    usize partial_stride;
+    usize next_partial;
+} ParallelJob;
+
+static void parallel_job_run(void *argument) {
+    ParallelJob *job = (ParallelJob *)argument;
+    void *partial = NULL;
+    if (job->reduce != NULL) {
+        usize slot = __atomic_fetch_add(&job->next_partial, 1, __ATOMIC_RELAXED);
+        partial = job->partials + slot * job->partial_stride;
+    }
+    for (;;) {
+        usize chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= job->chunk_count) break;
+        usize start = job->start + chunk * job->grain;
+        usize end = job->end - start > job->grain ? start + job->grain : job->end;
+        if (job->reduce != NULL) {
+            job->reduce(start, end, partial, job->context);
+        } else {
+            job->function(start, end, job->context);
+        }
+    }
+}
+
+// One task per thread that can take part, each pulling chunks until there are none left.
+static usize parallel_job_prepare(ThreadPool *pool, ParallelJob *job, usize start, usize end, usize grain) {
+    usize count = end - start;
+    usize threads = (usize)pool->worker_count + 1;
+    if (grain == 0) {
+        grain = count / (threads * 8);
+        if (grain == 0) grain = 1;
+    }
+    job->start = start;
+    job->end = end;
+    job->grain = grain;
+    job->chunk_count = count / grain + (count % grain != 0);
+    return job->chunk_count < threads ? job->chunk_count : threads;
+}
+
+static void parallel_job_spawn(ThreadPool *pool, ParallelJob *job, usize task_count) {
+    TaskGroup group = task_group_new(pool);
+    for (usize i = 1; i < task_count; i++) {
+        task_group_spawn(&group, parallel_job_run, job);
+    }
+    parallel_job_run(job);
+    task_group_wait(&group);
+}
+
+void parallel_for(ThreadPool *pool, usize start, usize end, usize grain,
+                  ParallelForFunction function, void *context) {
+    if (start >= end) return;
+    ParallelJob job = {
+        .function = function,
+        .context = context
+    };
+    usize task_count = parallel_job_prepare(pool, &job, start, end, grain);
+    if (task_count == 1) {
+        function(start, end, context);
+        return;
+    }
+    parallel_job_spawn(pool, &job, task_count);
+}
+
+void parallel_reduce(ThreadPool *pool, usize start, usize end, usize grain,
+                     void *result, usize partial_size,
+                     ParallelReduceFunction reduce, ParallelCombineFunction combine, void *context) {
+    if (start >= end) return;
+    ParallelJob job = {
+        .reduce = reduce,
+        .context = context
+    };
+    usize task_count = parallel_job_prepare(pool, &job, start, end, grain);
+    if (task_count == 1) {
+        reduce(start, end, result, context);
+        return;
+    }
+
+    // Partials on cache lines of their own, so tasks do not false-share while folding.
+    Scratch scratch = scratch_begin(NULL, 0);
+    job.partial_stride = (partial_size + CACHE_LINE_SIZE - 1) & ~(usize)(CACHE_LINE_SIZE - 1);
+    job.partials = (u8 *)arena_alloc_aligned(scratch.arena, job.partial_stride * task_count, CACHE_LINE_SIZE);
+    for (usize i = 0; i < task_count; i++) {
+        memcpy(job.partials + i * job.partial_stride, result, partial_size);
+    }
+    parallel_job_spawn(pool, &job, task_count);
+    for (usize i = 0; i < task_count; i++) {
+        combine(result, job.partials + i * job.partial_stride, context);
+    }
+    scratch_end(scratch);
+}
+
 #endif // BASE_IMPLEMENTATION
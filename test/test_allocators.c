@@ -25,7 +25,7 @@ TEST(heap_allocator_realloc) {
 
     TEST_ASSERT((i32)*ptr2 == 42);
 
-    ptr = (i32 *)heap_allocator.realloc(&heap_allocator, ptr, sizeof(i64), sizeof(i32));
+    ptr = (i32 *)heap_allocator.realloc(&heap_allocator, ptr2, sizeof(i64), sizeof(i32));
     *ptr = 420;
 
     TEST_ASSERT(*ptr == 420);
@@ -33,6 +33,29 @@ TEST(heap_allocator_realloc) {
     heap_allocator.free(&heap_allocator, ptr);
 }
 
+TEST(heap_allocator_alloc_uninit) {
+    u8 *ptr = (u8 *)heap_allocator.alloc_uninit(&heap_allocator, 64);
+    memset(ptr, 0xAB, 64);
+
+    TEST_ASSERT(ptr[0] == 0xAB);
+    TEST_ASSERT(ptr[63] == 0xAB);
+
+    heap_allocator.free(&heap_allocator, ptr);
+}
+
+TEST(heap_allocator_alloc_aligned) {
+    u8 *ptr = (u8 *)heap_allocator.alloc_aligned(&heap_allocator, 100, CACHE_LINE_SIZE);
+    u8 *ptr2 = (u8 *)heap_allocator.alloc_aligned(&heap_allocator, 100, 4096);
+    memset(ptr, 1, 100);
+    memset(ptr2, 2, 100);
+
+    TEST_ASSERT((usize)ptr % CACHE_LINE_SIZE == 0);
+    TEST_ASSERT((usize)ptr2 % 4096 == 0);
+
+    heap_allocator.free(&heap_allocator, ptr);
+    heap_allocator.free(&heap_allocator, ptr2);
+}
+
 TEST(arena_new) {
     Arena arena = arena_new(8, &heap_allocator);
 
@@ -147,17 +170,580 @@ TEST(arena_nested) {
     arena_free(&arena);
 }
 
-void test_suite_heap_allocator(void) {
-    TEST_RUN(heap_allocator_alloc);
-    TEST_RUN(heap_allocator_zero);
-    TEST_RUN(heap_allocator_realloc);
+// Counts the allocations that reach the backing heap. Each test makes its own, since tests
+// run side by side and a shared count would pick up the others' allocations.
+typedef struct {
+    Allocator allocator;
+    usize allocs;
+} CountingAllocator;
+
+static void *counting_alloc(Allocator *allocator, usize size) {
+    ((CountingAllocator *)allocator)->allocs++;
+    return heap_allocator.alloc(&heap_allocator, size);
+}
+
+static void *counting_realloc(Allocator *allocator, void *ptr, usize old_size, usize new_size) {
+    ((CountingAllocator *)allocator)->allocs++;
+    return heap_allocator.realloc(&heap_allocator, ptr, old_size, new_size);
+}
+
+static void counting_free(Allocator *allocator, void *ptr) {
+    heap_allocator.free(&heap_allocator, ptr);
+}
+
+static CountingAllocator counting_allocator_new(void) {
+    CountingAllocator counting = {
+        .allocator = {
+            counting_alloc,
+            counting_realloc,
+            counting_free
+        },
+        .allocs = 0
+    };
+    return counting;
+}
+
+TEST(arena_alloc_zeroes_reused_memory) {
+    Arena arena = arena_new(64, &heap_allocator);
+    u8 *ptr = (u8 *)arena_alloc_uninit(&arena, 64);
+    memset(ptr, 0xAB, 64);
+
+    arena_reset(&arena);
+
+    u8 *ptr2 = (u8 *)arena.allocator.alloc(&arena.allocator, 64);
+    TEST_ASSERT(ptr2 == ptr);
+    TEST_ASSERT(ptr2[0] == 0 && ptr2[63] == 0);
+
+    arena_reset(&arena);
+
+    u8 *ptr3 = (u8 *)arena.allocator.alloc_uninit(&arena.allocator, 64);
+    TEST_ASSERT(ptr3 == ptr);
+    TEST_ASSERT(arena.offset == 64);
+
+    arena_free(&arena);
+}
+
+TEST(allocator_alloc_uninit_fallback) {
+    CountingAllocator counting = counting_allocator_new();
+    // The counting allocator predates alloc_uninit and leaves it NULL.
+    u8 *ptr = (u8 *)allocator_alloc_uninit(&counting.allocator, 16);
+
+    TEST_ASSERT(counting.allocs == 1);
+    TEST_ASSERT(ptr[0] == 0);
+
+    counting.allocator.free(&counting.allocator, ptr);
+}
+
+TEST(allocator_alloc_aligned_fallback) {
+    CountingAllocator counting = counting_allocator_new();
+    u8 *ptr = (u8 *)allocator_alloc_aligned(&counting.allocator, 16, ALIGNMENT_DEFAULT);
+
+    TEST_ASSERT((usize)ptr % ALIGNMENT_DEFAULT == 0);
+
+    counting.allocator.free(&counting.allocator, ptr);
+}
+
+TEST(arena_alloc_alignment) {
+    Arena arena = arena_new(256, &heap_allocator);
+
+    u8 *bytes = (u8 *)arena_alloc(&arena, 3);
+    u64 *value = (u64 *)arena_alloc(&arena, sizeof(u64));
+    u8 *bytes2 = (u8 *)arena_alloc(&arena, 1);
+    MaxAlign *widest = (MaxAlign *)arena_alloc(&arena, sizeof(MaxAlign));
+
+    TEST_ASSERT((u8 *)value - bytes == sizeof(u64));
+    TEST_ASSERT((usize)value % sizeof(u64) == 0);
+    TEST_ASSERT(bytes2 == (u8 *)(value + 1));
+    TEST_ASSERT((usize)widest % ALIGNMENT_DEFAULT == 0);
+
+    arena_alloc(&arena, 1);
+    void *line = arena_alloc_aligned(&arena, 32, CACHE_LINE_SIZE);
+
+    TEST_ASSERT((usize)line % CACHE_LINE_SIZE == 0);
+    TEST_ASSERT(arena.offset == (usize)((u8 *)line - arena.buffer) + 32);
+
+    void *line2 = arena.allocator.alloc_aligned(&arena.allocator, 8, CACHE_LINE_SIZE);
+    TEST_ASSERT((usize)line2 % CACHE_LINE_SIZE == 0);
+    TEST_ASSERT((u8 *)line2 - (u8 *)line == CACHE_LINE_SIZE);
+
+    arena_free(&arena);
+}
+
+TEST(arena_growable_alloc_aligned) {
+    Arena arena = arena_new_growable(64, 64, ARENA_RESET_RELEASE, &heap_allocator);
+
+    arena_alloc(&arena, 60);
+    void *ptr = arena_alloc_aligned(&arena, 64, CACHE_LINE_SIZE);
+
+    TEST_ASSERT(arena.block != NULL);
+    TEST_ASSERT((usize)ptr % CACHE_LINE_SIZE == 0);
+    TEST_ASSERT((u8 *)ptr + 64 <= arena.buffer + arena.capacity);
+
+    arena_free(&arena);
+}
+
+TEST(arena_realloc_shrink) {
+    Arena arena = arena_new(16, &heap_allocator);
+    u8 *ptr = (u8 *)arena_alloc(&arena, 8);
+
+    ptr = (u8 *)arena_realloc(&arena, ptr, 8, 4);
+
+    TEST_ASSERT(arena.offset == 4);
+
+    arena_free(&arena);
+}
+
+TEST(arena_growable_alloc) {
+    Arena arena = arena_new_growable(16, 64, ARENA_RESET_RELEASE, &heap_allocator);
+    i64 *ptrs[16];
+
+    for (usize i = 0; i < 16; i++) {
+        ptrs[i] = (i64 *)arena_alloc(&arena, sizeof(i64));
+        *ptrs[i] = i;
+    }
+
+    TEST_ASSERT(arena.block != NULL);
+    TEST_ASSERT(arena.first_capacity == 16);
+    for (usize i = 0; i < 16; i++) {
+        TEST_ASSERT(*ptrs[i] == i);
+    }
+
+    arena_free(&arena);
+}
+
+TEST(arena_growable_block_sizes) {
+    Arena arena = arena_new_growable(16, 64, ARENA_RESET_RELEASE, &heap_allocator);
+
+    arena_alloc(&arena, 16);
+    arena_alloc(&arena, 1);
+    TEST_ASSERT(arena.capacity == 32);
+    arena_alloc(&arena, 32);
+    TEST_ASSERT(arena.capacity == 64);
+    arena_alloc(&arena, 64);
+    TEST_ASSERT(arena.capacity == 64);
+
+    // Requests bigger than the maximum block size get a block of their own.
+    arena_alloc(&arena, 100);
+    TEST_ASSERT(arena.capacity == 100);
+    TEST_ASSERT(arena.offset == 100);
+
+    arena_free(&arena);
+}
+
+TEST(arena_growable_reset_retain) {
+    CountingAllocator counting = counting_allocator_new();
+    Arena arena = arena_new_growable(64, 256, ARENA_RESET_RETAIN, &counting.allocator);
+
+    for (usize i = 0; i < 64; i++) {
+        arena_alloc(&arena, 24);
+    }
+    arena_reset(&arena);
+
+    TEST_ASSERT(arena.block == NULL);
+    TEST_ASSERT(arena.buffer == arena.first_buffer);
+    TEST_ASSERT(arena.offset == 0);
+
+    usize allocs = counting.allocs;
+    for (usize round = 0; round < 4; round++) {
+        for (usize i = 0; i < 64; i++) {
+            arena_alloc(&arena, 24);
+        }
+        arena_reset(&arena);
+    }
+
+    TEST_ASSERT(counting.allocs == allocs);
+
+    arena_free(&arena);
+}
+
+TEST(arena_growable_reset_release) {
+    CountingAllocator counting = counting_allocator_new();
+    Arena arena = arena_new_growable(64, 256, ARENA_RESET_RELEASE, &counting.allocator);
+
+    for (usize i = 0; i < 64; i++) {
+        arena_alloc(&arena, 24);
+    }
+    arena_reset(&arena);
+
+    TEST_ASSERT(arena.block == NULL);
+    TEST_ASSERT(arena.free_blocks == NULL);
+    TEST_ASSERT(arena.capacity == 64);
+
+    arena_free(&arena);
+}
+
+TEST(arena_growable_realloc) {
+    Arena arena = arena_new_growable(16, 64, ARENA_RESET_RELEASE, &heap_allocator);
+    u8 *ptr = (u8 *)arena_alloc(&arena, 8);
+    memcpy(ptr, "abcdefgh", 8);
+
+    u8 *ptr2 = (u8 *)arena_realloc(&arena, ptr, 8, 24);
+
+    TEST_ASSERT(ptr2 != ptr);
+    TEST_ASSERT(memcmp(ptr2, "abcdefgh", 8) == 0);
+    TEST_ASSERT(arena.offset == 24);
+
+    arena_free(&arena);
+}
+
+TEST(arena_mark_restore) {
+    Arena arena = arena_new(1024, &heap_allocator);
+    arena_alloc(&arena, 16);
+
+    ArenaMark outer = arena_mark(&arena);
+    arena_alloc(&arena, 96);
+    ArenaMark inner = arena_mark(&arena);
+    u8 *ptr = (u8 *)arena_alloc(&arena, 200);
+    TEST_ASSERT(arena.offset == 312);
+
+    arena_restore(&arena, inner);
+    TEST_ASSERT(arena.offset == 112);
+    TEST_ASSERT((u8 *)arena_alloc(&arena, 200) == ptr);
+
+    arena_restore(&arena, outer);
+    TEST_ASSERT(arena.offset == 16);
+
+    arena_free(&arena);
+}
+
+TEST(arena_mark_restore_growable) {
+    CountingAllocator counting = counting_allocator_new();
+    Arena arena = arena_new_growable(64, 256, ARENA_RESET_RETAIN, &counting.allocator);
+    arena_alloc(&arena, 48);
+
+    ArenaMark mark = arena_mark(&arena);
+    for (usize i = 0; i < 32; i++) {
+        arena_alloc(&arena, 24);
+    }
+    TEST_ASSERT(arena.block != NULL);
+
+    arena_restore(&arena, mark);
+    TEST_ASSERT(arena.block == NULL);
+    TEST_ASSERT(arena.buffer == arena.first_buffer);
+    TEST_ASSERT(arena.offset == 48);
+    TEST_ASSERT(arena.free_blocks != NULL);
+
+    // A mark inside an overflow block keeps that block and drops the newer ones.
+    usize allocs = counting.allocs;
+    arena_alloc(&arena, 24);
+    ArenaBlock *block = arena.block;
+    ArenaMark block_mark = arena_mark(&arena);
+    for (usize i = 0; i < 32; i++) {
+        arena_alloc(&arena, 24);
+    }
+    arena_restore(&arena, block_mark);
+    TEST_ASSERT(arena.block == block);
+    TEST_ASSERT(arena.offset == 24);
+    TEST_ASSERT(counting.allocs == allocs);
+
+    arena_free(&arena);
+}
+
+TEST(arena_virtual_commit) {
+    Arena arena = arena_new_virtual((usize)1 << 30, 0, ARENA_VIRTUAL_DEFAULT);
+    TEST_ASSERT(arena.buffer != NULL);
+    TEST_ASSERT(arena.reserved == (usize)1 << 30);
+    TEST_ASSERT(arena.capacity == 0);
+
+    u8 *small = (u8 *)arena_alloc(&arena, 16);
+    TEST_ASSERT(small == arena.buffer);
+    TEST_ASSERT(arena.capacity == ARENA_COMMIT_SIZE);
+
+    u8 *large = (u8 *)arena_alloc(&arena, 3 * ARENA_COMMIT_SIZE);
+    memset(large, 0xAB, 3 * ARENA_COMMIT_SIZE);
+    TEST_ASSERT(large == small + 16);
+    TEST_ASSERT(arena.capacity == 4 * ARENA_COMMIT_SIZE);
+
+    arena_free(&arena);
+    TEST_ASSERT(arena.buffer == NULL);
+}
+
+TEST(arena_virtual_realloc_in_place) {
+    Arena arena = arena_new_virtual((usize)1 << 30, 0, ARENA_VIRTUAL_DEFAULT);
+
+    usize size = 64;
+    u8 *ptr = (u8 *)arena_alloc(&arena, size);
+    ptr[0] = 42;
+    while (size < (usize)16 << 20) {
+        TEST_ASSERT(arena_realloc(&arena, ptr, size, size * 2) == ptr);
+        size *= 2;
+        ptr[size - 1] = 1;
+    }
+    TEST_ASSERT(ptr[0] == 42);
+    TEST_ASSERT(arena.offset == size);
+    TEST_ASSERT(arena.capacity == size);
+
+    arena_free(&arena);
+}
+
+TEST(arena_virtual_reset_decommit) {
+    Arena arena = arena_new_virtual((usize)1 << 30, 2 * ARENA_COMMIT_SIZE, ARENA_VIRTUAL_DEFAULT);
+
+    u8 *ptr = (u8 *)arena_alloc(&arena, 10 * ARENA_COMMIT_SIZE);
+    memset(ptr, 0xAB, 10 * ARENA_COMMIT_SIZE);
+    arena_reset(&arena);
+    TEST_ASSERT(arena.offset == 0);
+    TEST_ASSERT(arena.capacity == 2 * ARENA_COMMIT_SIZE);
+
+    // Recommitted pages come back zeroed, the retained ones keep their contents.
+    ptr = (u8 *)arena_alloc_uninit(&arena, 10 * ARENA_COMMIT_SIZE);
+    TEST_ASSERT(ptr[0] == 0xAB);
+    TEST_ASSERT(ptr[5 * ARENA_COMMIT_SIZE] == 0);
+
+    // Restoring a mark keeps what is committed.
+    ArenaMark mark = arena_mark(&arena);
+    arena_alloc(&arena, ARENA_COMMIT_SIZE);
+    arena_restore(&arena, mark);
+    TEST_ASSERT(arena.offset == 10 * ARENA_COMMIT_SIZE);
+    TEST_ASSERT(arena.capacity == 11 * ARENA_COMMIT_SIZE);
+
+    arena_free(&arena);
+}
+
+TEST(arena_virtual_huge_pages) {
+    Arena arena = arena_new_virtual((usize)1 << 30, 0, ARENA_VIRTUAL_HUGE_PAGES | ARENA_VIRTUAL_HUGETLB);
+    TEST_ASSERT(arena.commit_size == ARENA_HUGE_PAGE_SIZE);
+
+    u8 *ptr = (u8 *)arena_alloc(&arena, 100);
+    ptr[99] = 1;
+    TEST_ASSERT(arena.capacity == ARENA_HUGE_PAGE_SIZE);
+
+    arena_free(&arena);
+}
+
+TEST(scratch_begin_end) {
+    Scratch scratch = scratch_begin(NULL, 0);
+    TEST_ASSERT(scratch.arena != NULL);
+    usize offset = scratch.arena->offset;
+
+    u8 *ptr = (u8 *)arena_alloc(scratch.arena, 1 << 20);
+    ptr[(1 << 20) - 1] = 1;
+    scratch_end(scratch);
+    TEST_ASSERT(scratch.arena->offset == offset);
+
+    // The same arena comes back when nothing conflicts.
+    Scratch again = scratch_begin(NULL, 0);
+    TEST_ASSERT(again.arena == scratch.arena);
+    scratch_end(again);
+}
+
+TEST(scratch_conflicts) {
+    Scratch outer = scratch_begin(NULL, 0);
+    i32 *result = (i32 *)arena_alloc(outer.arena, sizeof(i32));
+
+    // A callee writing its result into the outer scratch arena gets a different one.
+    Scratch inner = scratch_begin(&outer.arena, 1);
+    TEST_ASSERT(inner.arena != outer.arena);
+    i32 *temp = (i32 *)arena_alloc(inner.arena, sizeof(i32));
+    *temp = 21;
+    *result = *temp * 2;
+    scratch_end(inner);
+
+    TEST_ASSERT(*result == 42);
+    scratch_end(outer);
+
+    scratch_free();
+    Scratch fresh = scratch_begin(NULL, 0);
+    TEST_ASSERT(fresh.arena->first_buffer != NULL);
+    scratch_end(fresh);
+    scratch_free();
+}
+
+TEST(pool_alloc_release) {
+    Pool pool = pool_new(sizeof(u64), 4, &heap_allocator);
+    u64 *a = (u64 *)pool_alloc(&pool);
+    u64 *b = (u64 *)pool_alloc(&pool);
+    *a = 42;
+    *b = 69;
+
+    TEST_ASSERT(a != b);
+    TEST_ASSERT(*a == 42);
+    TEST_ASSERT(*b == 69);
+
+    pool_release(&pool, a);
+    u64 *c = (u64 *)pool_alloc(&pool);
+
+    TEST_ASSERT(c == a);
+    TEST_ASSERT(*c == 0);
+
+    pool_free(&pool);
+}
+
+TEST(pool_slabs) {
+    Pool pool = pool_new(24, 8, &heap_allocator);
+    u8 *ptrs[100];
+
+    for (usize i = 0; i < 100; i++) {
+        ptrs[i] = (u8 *)pool_alloc(&pool);
+        memset(ptrs[i], (int)i, 24);
+        TEST_ASSERT((usize)ptrs[i] % sizeof(u64) == 0);
+    }
+    for (usize i = 0; i < 100; i++) {
+        TEST_ASSERT(ptrs[i][0] == (u8)i && ptrs[i][23] == (u8)i);
+    }
+
+    pool_free(&pool);
+}
+
+TEST(pool_reset) {
+    CountingAllocator counting = counting_allocator_new();
+    Pool pool = pool_new(16, 8, &counting.allocator);
+
+    for (usize i = 0; i < 64; i++) {
+        pool_alloc(&pool);
+    }
+    pool_reset(&pool);
+
+    usize allocs = counting.allocs;
+    for (usize i = 0; i < 64; i++) {
+        pool_alloc(&pool);
+    }
+
+    TEST_ASSERT(counting.allocs == allocs);
+
+    pool_free(&pool);
+}
+
+TEST(pool_allocator_large) {
+    Pool pool = pool_new(16, 8, &heap_allocator);
+    Allocator *allocator = &pool.allocator;
+
+    u8 *small = (u8 *)allocator->alloc(allocator, 16);
+    u8 *large = (u8 *)allocator->alloc(allocator, 256);
+    TEST_ASSERT(pool.large != NULL);
+    TEST_ASSERT(large[255] == 0);
+
+    memset(large, 7, 256);
+    large = (u8 *)allocator->realloc(allocator, large, 256, 512);
+    TEST_ASSERT(large[255] == 7);
+
+    u8 *line = (u8 *)allocator->alloc_aligned(allocator, 16, CACHE_LINE_SIZE);
+    TEST_ASSERT((usize)line % CACHE_LINE_SIZE == 0);
+
+    allocator->free(allocator, large);
+    allocator->free(allocator, line);
+    allocator->free(allocator, small);
+
+    TEST_ASSERT(pool.large == NULL);
+    TEST_ASSERT(pool.free_list == small);
+
+    pool_free(&pool);
+}
+
+TEST(tracking_allocator_counts) {
+    TrackingAllocator tracker = tracking_allocator_new("test", &heap_allocator);
+    Allocator *allocator = &tracker.allocator;
+
+    u8 *small = (u8 *)allocator->alloc(allocator, 24);
+    u8 *large = (u8 *)allocator_alloc_uninit(allocator, 1 << 20);
+    TEST_ASSERT(small[23] == 0);
+    memset(large, 0xAB, 1 << 20);
+
+    TrackingStats stats = tracking_allocator_stats(&tracker);
+    TEST_ASSERT(stats.allocs == 2);
+    TEST_ASSERT(stats.frees == 0);
+    TEST_ASSERT(stats.live_bytes == 24 + (1 << 20));
+    TEST_ASSERT(stats.size_classes[5] == 1);
+    TEST_ASSERT(stats.size_classes[21] == 1);
+
+    small = (u8 *)allocator->realloc(allocator, small, 24, 100);
+    allocator->free(allocator, large);
+
+    stats = tracking_allocator_stats(&tracker);
+    TEST_ASSERT(stats.allocs == 3);
+    TEST_ASSERT(stats.frees == 2);
+    TEST_ASSERT(stats.live_bytes == 100);
+    TEST_ASSERT(stats.peak_bytes >= (1 << 20));
+    TEST_ASSERT(stats.total_bytes == 24 + (1 << 20) + 100);
+
+    allocator->free(allocator, small);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).live_bytes == 0);
+    TEST_ASSERT(tracking_allocator_check_leaks(&tracker, NULL) == 0);
+}
+
+TEST(tracking_allocator_aligned) {
+    TrackingAllocator tracker = tracking_allocator_new("test", &heap_allocator);
+    Allocator *allocator = &tracker.allocator;
+
+    u8 *ptr = (u8 *)allocator_alloc_aligned(allocator, 100, 256);
+    TEST_ASSERT((usize)ptr % 256 == 0);
+    memset(ptr, 7, 100);
+
+    ptr = (u8 *)allocator->realloc(allocator, ptr, 100, 200);
+    TEST_ASSERT(ptr[99] == 7);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).live_bytes == 200);
+
+    allocator->free(allocator, ptr);
+    TEST_ASSERT(tracking_allocator_check_leaks(&tracker, NULL) == 0);
+}
+
+TEST(tracking_allocator_sites) {
+    TrackingAllocator tracker = tracking_allocator_new("test", &heap_allocator);
+
+    void *ptrs[3];
+    for (usize i = 0; i < 3; i++) {
+        ptrs[i] = TRACKING_ALLOC(&tracker, 16);
+    }
+    void *leaked = TRACKING_ALLOC_UNINIT(&tracker, 48);
+    void *untagged = tracker.allocator.alloc(&tracker.allocator, 8);
+
+    TrackingSite *loop_site = NULL;
+    for (usize i = 0; i < TRACKING_MAX_SITES; i++) {
+        if (tracker.sites[i].allocs == 3) loop_site = &tracker.sites[i];
+    }
+    TEST_ASSERT(loop_site != NULL);
+    TEST_ASSERT(strcmp(loop_site->file, __FILE__) == 0);
+    TEST_ASSERT(loop_site->live_bytes == 48);
+    TEST_ASSERT(tracking_allocator_check_leaks(&tracker, NULL) == 5);
+
+    for (usize i = 0; i < 3; i++) {
+        TRACKING_FREE(&tracker, ptrs[i]);
+    }
+    TRACKING_FREE(&tracker, untagged);
+    TEST_ASSERT(loop_site->live_bytes == 0);
+    TEST_ASSERT(tracking_allocator_check_leaks(&tracker, NULL) == 1);
+
+    TRACKING_FREE(&tracker, leaked);
+    TEST_ASSERT(tracking_allocator_check_leaks(&tracker, NULL) == 0);
+}
+
+#define TRACKING_TEST_ALLOCS 20000
+
+static void *tracking_test_churn(void *argument) {
+    Allocator *allocator = (Allocator *)argument;
+    for (usize i = 0; i < TRACKING_TEST_ALLOCS; i++) {
+        void *ptr = allocator->alloc(allocator, 1 + i % 64);
+        allocator->free(allocator, ptr);
+    }
+    return NULL;
 }
 
-void test_suite_arena(void) {
-    TEST_RUN(arena_new);
-    TEST_RUN(arena_alloc);
-    TEST_RUN(arena_realloc);
-    TEST_RUN(arena_reset);
-    TEST_RUN(arena_allocator_alloc);
-    TEST_RUN(arena_nested);
+TEST(tracking_allocator_threads) {
+    TrackingAllocator tracker = tracking_allocator_new("test", &heap_allocator);
+    Allocator *allocator = &tracker.allocator;
+
+    // Threads that come and go have to hand their slots back for the next ones.
+    for (usize i = 0; i < 2 * TRACKING_SLOTS; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, tracking_test_churn, allocator);
+        pthread_join(thread, NULL);
+    }
+
+    // More live threads than slots, so owners and sharers update side by side.
+    pthread_t threads[TRACKING_SLOTS + 4];
+    usize thread_count = sizeof(threads) / sizeof(threads[0]);
+    for (usize i = 0; i < thread_count; i++) {
+        pthread_create(&threads[i], NULL, tracking_test_churn, allocator);
+    }
+    tracking_test_churn(allocator);
+    for (usize i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    TrackingStats stats = tracking_allocator_stats(&tracker);
+    u64 expected = (u64)(3 * TRACKING_SLOTS + 5) * TRACKING_TEST_ALLOCS;
+    TEST_ASSERT(stats.allocs == expected);
+    TEST_ASSERT(stats.frees == expected);
+    TEST_ASSERT(stats.live_bytes == 0);
+    TEST_ASSERT(tracking_allocator_check_leaks(&tracker, NULL) == 0);
 }
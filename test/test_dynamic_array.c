@@ -3,6 +3,40 @@
 DYNAMIC_ARRAY_DECLARE(DA, array, i32)
 DYNAMIC_ARRAY_IMPLEMENT(DA, array, i32)
 
+#define i32_less(a, b) ((a) < (b))
+DYNAMIC_ARRAY_SORT_DECLARE(DA, array, i32)
+DYNAMIC_ARRAY_SORT_IMPLEMENT(DA, array, i32, i32_less)
+DYNAMIC_ARRAY_RADIX_SORT_DECLARE(DA, array, i32)
+DYNAMIC_ARRAY_RADIX_SORT_IMPLEMENT(DA, array, i32, sort_key_i32)
+
+DYNAMIC_ARRAY_DECLARE(FloatArray, float_array, f64)
+DYNAMIC_ARRAY_IMPLEMENT(FloatArray, float_array, f64)
+DYNAMIC_ARRAY_RADIX_SORT_DECLARE(FloatArray, float_array, f64)
+DYNAMIC_ARRAY_RADIX_SORT_IMPLEMENT(FloatArray, float_array, f64, sort_key_f64)
+
+static i32 compare_i32(const void *a, const void *b) {
+    i32 x = *(const i32 *)a;
+    i32 y = *(const i32 *)b;
+    return (x > y) - (x < y);
+}
+
+// Random, sorted, reversed and few-distinct inputs around the insertion sort threshold.
+static DA sort_test_input(u32 pattern, usize length) {
+    DA array = array_new(&heap_allocator);
+    u32 state = 12345;
+    for (usize i = 0; i < length; i++) {
+        state = state * 1103515245 + 12345;
+        i32 value = (i32)state;
+        switch (pattern) {
+            case 0: array_push(&array, value); break;
+            case 1: array_push(&array, (i32)i); break;
+            case 2: array_push(&array, -(i32)i); break;
+            default: array_push(&array, value % 4); break;
+        }
+    }
+    return array;
+}
+
 TEST(dynamic_array_new) {
     DA array = array_new(&heap_allocator);
 
@@ -91,6 +125,262 @@ TEST(dynamic_array_extend) {
     array_free(&array2);
 }
 
+TEST(dynamic_array_extend_large) {
+    DA array1 = array_new(&heap_allocator);
+    DA array2 = array_new(&heap_allocator);
+
+    array_push(&array1, -1);
+    for (i32 i = 0; i < 1000; i++) {
+        array_push(&array2, i);
+    }
+
+    array_extend(&array1, &array2);
+
+    TEST_ASSERT(array1.length == 1001);
+    TEST_ASSERT(array1.capacity >= 1001);
+    TEST_ASSERT(array1.data[0] == -1);
+    for (i32 i = 0; i < 1000; i++) {
+        TEST_ASSERT(array1.data[i + 1] == i);
+    }
+
+    array_free(&array1);
+    array_free(&array2);
+}
+
+TEST(dynamic_array_extend_self) {
+    DA array = array_new(&heap_allocator);
+    for (i32 i = 0; i < 8; i++) {
+        array_push(&array, i);
+    }
+
+    // Full, so appending has to move the buffer the source points into.
+    array_extend(&array, &array);
+    TEST_ASSERT(array.length == 16);
+    for (i32 i = 0; i < 16; i++) {
+        TEST_ASSERT(array.data[i] == i % 8);
+    }
+
+    // A slice of the array points into it too.
+    array_shrink_to_fit(&array);
+    DA slice = array_slice(&array, 4, 12);
+    array_extend(&array, &slice);
+    TEST_ASSERT(array.length == 24);
+    for (i32 i = 0; i < 8; i++) {
+        TEST_ASSERT(array.data[16 + i] == (4 + i) % 8);
+    }
+
+    array_free(&array);
+}
+
+TEST(dynamic_array_push_many) {
+    TrackingAllocator tracker = tracking_allocator_new("push_many", &heap_allocator);
+    DA array = array_new(&tracker.allocator);
+
+    i32 values[100];
+    for (i32 i = 0; i < 100; i++) {
+        values[i] = i;
+    }
+
+    // One allocation in new, a single realloc for the whole append.
+    array_push_many(&array, values, 100);
+    TEST_ASSERT(array.length == 100);
+    TEST_ASSERT(array.capacity == 100);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).allocs == 2);
+
+    // Appending past capacity again grows geometrically rather than to the exact size.
+    array_push_many(&array, values, 10);
+    TEST_ASSERT(array.length == 110);
+    TEST_ASSERT(array.capacity == 200);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).allocs == 3);
+
+    for (i32 i = 0; i < 110; i++) {
+        TEST_ASSERT(array.data[i] == i % 100);
+    }
+
+    array_push_many(&array, values, 0);
+    TEST_ASSERT(array.length == 110);
+
+    array_free(&array);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).live_bytes == 0);
+}
+
+TEST(dynamic_array_reserve_resize) {
+    DA array = array_new(&heap_allocator);
+
+    array_reserve(&array, 4);
+    TEST_ASSERT(array.capacity == 8);
+
+    array_reserve(&array, 1000);
+    TEST_ASSERT(array.capacity == 1000);
+    TEST_ASSERT(array.length == 0);
+
+    array_push(&array, 7);
+    array_resize(&array, 500);
+    TEST_ASSERT(array.length == 500);
+    TEST_ASSERT(array.capacity == 1000);
+    TEST_ASSERT(array.data[0] == 7);
+    for (usize i = 1; i < 500; i++) {
+        TEST_ASSERT(array.data[i] == 0);
+    }
+
+    array_resize(&array, 2);
+    TEST_ASSERT(array.length == 2);
+
+    array_resize(&array, 3000);
+    TEST_ASSERT(array.length == 3000);
+    TEST_ASSERT(array.capacity == 3000);
+    TEST_ASSERT(array.data[2] == 0);
+
+    array_free(&array);
+}
+
+TEST(dynamic_array_insert_at) {
+    DA array = array_new(&heap_allocator);
+
+    for (i32 i = 0; i < 8; i++) {
+        array_push(&array, i);
+    }
+
+    array_insert_at(&array, 0, -1);
+    array_insert_at(&array, 5, 100);
+    array_insert_at(&array, array.length, 200);
+
+    i32 expected[] = {-1, 0, 1, 2, 3, 100, 4, 5, 6, 7, 200};
+    TEST_ASSERT(array.length == 11);
+    for (usize i = 0; i < 11; i++) {
+        TEST_ASSERT(array.data[i] == expected[i]);
+    }
+
+    array_free(&array);
+}
+
+TEST(dynamic_array_remove) {
+    DA array = array_new(&heap_allocator);
+
+    for (i32 i = 0; i < 6; i++) {
+        array_push(&array, i);
+    }
+
+    TEST_ASSERT(array_remove_swap(&array, 1) == 1);
+    TEST_ASSERT(array.length == 5);
+    TEST_ASSERT(array.data[1] == 5);
+
+    TEST_ASSERT(array_remove_ordered(&array, 0) == 0);
+    i32 expected[] = {5, 2, 3, 4};
+    TEST_ASSERT(array.length == 4);
+    for (usize i = 0; i < 4; i++) {
+        TEST_ASSERT(array.data[i] == expected[i]);
+    }
+
+    TEST_ASSERT(array_remove_swap(&array, 3) == 4);
+    TEST_ASSERT(array_remove_ordered(&array, 2) == 3);
+    TEST_ASSERT(array.length == 2);
+
+    array_free(&array);
+}
+
+TEST(dynamic_array_shrink_to_fit) {
+    DA array = array_new(&heap_allocator);
+
+    for (i32 i = 0; i < 100; i++) {
+        array_push(&array, i);
+    }
+    TEST_ASSERT(array.capacity == 128);
+
+    array_shrink_to_fit(&array);
+    TEST_ASSERT(array.capacity == 100);
+    TEST_ASSERT(array.data[99] == 99);
+
+    array_reset(&array);
+    array_shrink_to_fit(&array);
+    TEST_ASSERT(array.capacity == 1);
+
+    array_push(&array, 1);
+    array_push(&array, 2);
+    TEST_ASSERT(array.capacity == 8);
+    TEST_ASSERT(array.data[1] == 2);
+
+    array_free(&array);
+}
+
+TEST(dynamic_array_sort) {
+    usize lengths[] = {0, 1, 2, 15, 16, 17, 100, 10000};
+    for (u32 pattern = 0; pattern < 4; pattern++) {
+        for (usize l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            DA array = sort_test_input(pattern, lengths[l]);
+            DA radix = sort_test_input(pattern, lengths[l]);
+            DA expected = sort_test_input(pattern, lengths[l]);
+
+            array_sort(&array);
+            array_radix_sort(&radix);
+            qsort(expected.data, expected.length, sizeof(i32), compare_i32);
+
+            TEST_ASSERT(memcmp(array.data, expected.data, sizeof(i32) * expected.length) == 0);
+            TEST_ASSERT(memcmp(radix.data, expected.data, sizeof(i32) * expected.length) == 0);
+
+            array_free(&array);
+            array_free(&radix);
+            array_free(&expected);
+        }
+    }
+}
+
+TEST(dynamic_array_radix_sort_f64) {
+    FloatArray array = float_array_new(&heap_allocator);
+
+    f64 values[] = {3.5, -0.0, -1e300, 1.0 / 0.0, 2.0, -2.5, 0.0, -1.0 / 0.0, 1e-300, -1e-300,
+                    7.0, 7.0, -3.0, 100.0, 0.25, -0.25, 42.0, -42.0};
+    usize count = sizeof(values) / sizeof(values[0]);
+    float_array_push_many(&array, values, count);
+    float_array_radix_sort(&array);
+
+    TEST_ASSERT(array.length == count);
+    TEST_ASSERT(array.data[0] == -1.0 / 0.0);
+    TEST_ASSERT(array.data[count - 1] == 1.0 / 0.0);
+    for (usize i = 1; i < count; i++) {
+        TEST_ASSERT(array.data[i - 1] <= array.data[i]);
+    }
+
+    float_array_free(&array);
+}
+
+TEST(dynamic_array_binary_search) {
+    DA array = array_new(&heap_allocator);
+    usize index = 0;
+
+    TEST_ASSERT(array_lower_bound(&array, 5) == 0);
+    TEST_ASSERT(!array_binary_search(&array, 5, &index));
+
+    i32 values[] = {1, 3, 3, 3, 5, 8, 13};
+    array_push_many(&array, values, 7);
+
+    TEST_ASSERT(array_lower_bound(&array, 0) == 0);
+    TEST_ASSERT(array_lower_bound(&array, 1) == 0);
+    TEST_ASSERT(array_lower_bound(&array, 3) == 1);
+    TEST_ASSERT(array_lower_bound(&array, 4) == 4);
+    TEST_ASSERT(array_lower_bound(&array, 13) == 6);
+    TEST_ASSERT(array_lower_bound(&array, 14) == 7);
+
+    TEST_ASSERT(array_binary_search(&array, 8, &index));
+    TEST_ASSERT(index == 5);
+    TEST_ASSERT(!array_binary_search(&array, 9, &index));
+    TEST_ASSERT(index == 6);
+    TEST_ASSERT(!array_binary_search(&array, 100, &index));
+    TEST_ASSERT(index == 7);
+
+    for (i32 i = 0; i < 1000; i++) {
+        array_push(&array, 20 + 2 * i);
+    }
+    for (i32 i = 0; i < 1000; i++) {
+        TEST_ASSERT(array_binary_search(&array, 20 + 2 * i, &index));
+        TEST_ASSERT(index == 7 + (usize)i);
+        TEST_ASSERT(!array_binary_search(&array, 21 + 2 * i, &index));
+        TEST_ASSERT(index == 8 + (usize)i);
+    }
+
+    array_free(&array);
+}
+
 TEST(dynamic_array_slice) {
     DA array = array_new(&heap_allocator);
 
@@ -111,12 +401,3 @@ TEST(dynamic_array_slice) {
 
     array_free(&array);
 }
-
-void test_suite_dynamic_array(void) {
-    TEST_RUN(dynamic_array_new);
-    TEST_RUN(dynamic_array_push);
-    TEST_RUN(dynamic_array_push_grow);
-    TEST_RUN(dynamic_array_push_pop);
-    TEST_RUN(dynamic_array_extend);
-    TEST_RUN(dynamic_array_slice);
-}
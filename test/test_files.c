@@ -0,0 +1,200 @@
+#include "../lib/base.h"
+
+// Writes contents to a fresh temporary file and stores its path in path.
+static bool test_write_temp_file(char *path, const char *contents, usize length) {
+    strcpy(path, "/tmp/c-toolkit-test-XXXXXX");
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    bool written = write(fd, contents, length) == (ssize_t)length;
+    close(fd);
+    return written;
+}
+
+TEST(string_split) {
+    String str = string("a,,b,", &heap_allocator);
+    StringSplitter splitter = string_split(str, ',');
+    const char *expected[] = {"a", "", "b", ""};
+
+    String piece;
+    usize count = 0;
+    while (string_split_next(&splitter, &piece)) {
+        TEST_ASSERT(count < 4 && string_eq_cstr(piece, expected[count]));
+        TEST_ASSERT(piece.allocator == NULL);
+        count++;
+    }
+    TEST_ASSERT(count == 4);
+    TEST_ASSERT(!string_split_next(&splitter, &piece));
+
+    splitter = string_split(string_slice(str, 0, 0), ',');
+    TEST_ASSERT(string_split_next(&splitter, &piece));
+    TEST_ASSERT(piece.length == 0);
+    TEST_ASSERT(!string_split_next(&splitter, &piece));
+
+    string_free(&str);
+}
+
+TEST(string_lines) {
+    String str = string("first\r\nsecond\n\nlast\n", &heap_allocator);
+    StringSplitter lines = string_lines(str);
+    const char *expected[] = {"first", "second", "", "last"};
+
+    String line;
+    usize count = 0;
+    while (string_split_next(&lines, &line)) {
+        TEST_ASSERT(count < 4 && string_eq_cstr(line, expected[count]));
+        count++;
+    }
+    TEST_ASSERT(count == 4);
+
+    // No trailing newline, the last line still counts.
+    lines = string_lines(string_slice(str, 0, str.length - 1));
+    count = 0;
+    while (string_split_next(&lines, &line)) count++;
+    TEST_ASSERT(count == 4);
+    TEST_ASSERT(string_eq_cstr(line, "last"));
+
+    lines = string_lines(string_slice(str, 0, 0));
+    TEST_ASSERT(!string_split_next(&lines, &line));
+
+    string_free(&str);
+}
+
+TEST(file_map) {
+    char path[64];
+    const char *contents = "line one\nline two\nline three\n";
+    TEST_ASSERT(test_write_temp_file(path, contents, strlen(contents)));
+
+    String file;
+    TEST_ASSERT(file_map(path, FILE_MAP_SEQUENTIAL | FILE_MAP_WILLNEED, &file));
+    TEST_ASSERT(file.length == strlen(contents));
+    TEST_ASSERT(file.allocator == NULL);
+    TEST_ASSERT(memcmp(file.buffer, contents, file.length) == 0);
+
+    StringSplitter lines = string_lines(file);
+    String line;
+    usize count = 0;
+    while (string_split_next(&lines, &line)) {
+        TEST_ASSERT(line.buffer >= file.buffer && line.buffer < file.buffer + file.length);
+        count++;
+    }
+    TEST_ASSERT(count == 3);
+    TEST_ASSERT(string_eq_cstr(line, "line three"));
+
+    file_unmap(&file);
+    TEST_ASSERT(file.buffer == NULL);
+    unlink(path);
+}
+
+TEST(file_map_empty_and_missing) {
+    char path[64];
+    TEST_ASSERT(test_write_temp_file(path, "", 0));
+
+    String file;
+    TEST_ASSERT(file_map(path, FILE_MAP_DEFAULT, &file));
+    TEST_ASSERT(file.length == 0);
+    file_unmap(&file);
+    unlink(path);
+
+    TEST_ASSERT(!file_map(path, FILE_MAP_DEFAULT, &file));
+    TEST_ASSERT(!file_map("/tmp", FILE_MAP_DEFAULT, &file));
+}
+
+TEST(reader_lines) {
+    char path[64];
+    const char *contents = "short\r\na line longer than the buffer\n\nlast without newline";
+    TEST_ASSERT(test_write_temp_file(path, contents, strlen(contents)));
+
+    // A tiny buffer so records span refills and one needs the buffer to grow.
+    int fd = open(path, O_RDONLY);
+    Reader reader = reader_new(fd, 8, &heap_allocator);
+    const char *expected[] = {"short", "a line longer than the buffer", "", "last without newline"};
+
+    String line;
+    usize count = 0;
+    while (reader_read_line(&reader, &line)) {
+        TEST_ASSERT(count < 4 && string_eq_cstr(line, expected[count]));
+        count++;
+    }
+    TEST_ASSERT(count == 4);
+    TEST_ASSERT(reader.eof && !reader.error);
+    TEST_ASSERT(!reader_read_line(&reader, &line));
+
+    reader_free(&reader);
+    close(fd);
+    unlink(path);
+}
+
+TEST(reader_peek_skip_read) {
+    int fds[2];
+    TEST_ASSERT(pipe(fds) == 0);
+    const char *contents = "0123456789abcdefghij";
+    TEST_ASSERT(write(fds[1], contents, 20) == 20);
+    close(fds[1]);
+
+    Reader reader = reader_new(fds[0], 4, &heap_allocator);
+    TEST_ASSERT(string_eq_cstr(reader_peek(&reader, 6), "012345"));
+    TEST_ASSERT(string_eq_cstr(reader_peek(&reader, 2), "01"));
+    reader_skip(&reader, 3);
+
+    char buffer[8];
+    TEST_ASSERT(reader_read(&reader, buffer, 5) == 5);
+    TEST_ASSERT(memcmp(buffer, "34567", 5) == 0);
+
+    String record;
+    TEST_ASSERT(reader_read_until(&reader, 'c', &record));
+    TEST_ASSERT(string_eq_cstr(record, "89ab"));
+
+    reader_skip(&reader, 100);
+    TEST_ASSERT(reader_peek(&reader, 1).length == 0);
+    TEST_ASSERT(reader_read(&reader, buffer, 8) == 0);
+
+    reader_free(&reader);
+    close(fds[0]);
+}
+
+TEST(writer_write) {
+    char path[64];
+    TEST_ASSERT(test_write_temp_file(path, "", 0));
+    int fd = open(path, O_WRONLY | O_TRUNC);
+
+    // Small writes are batched, ones past half the buffer bypass it.
+    Writer writer = writer_new(fd, 16, &heap_allocator);
+    StringBuilder expected = string_builder_new(0, &heap_allocator);
+    String large = string_new(100, &heap_allocator);
+    memset(large.buffer, 'L', large.length);
+    for (u32 i = 0; i < 50; i++) {
+        writer_write_cstr(&writer, "abc");
+        writer_write_byte(&writer, (u8)('0' + i % 10));
+        string_builder_append_cstr(&expected, "abc");
+        string_builder_append_byte(&expected, (u8)('0' + i % 10));
+        if (i % 10 == 0) {
+            writer_write(&writer, large);
+            string_builder_append(&expected, large);
+        }
+    }
+    TEST_ASSERT(writer_free(&writer));
+    close(fd);
+
+    String file;
+    TEST_ASSERT(file_map(path, FILE_MAP_DEFAULT, &file));
+    TEST_ASSERT(file.length == expected.length);
+    TEST_ASSERT(memcmp(file.buffer, expected.buffer, expected.length) == 0);
+    file_unmap(&file);
+
+    string_free(&large);
+    string_builder_free(&expected);
+    unlink(path);
+}
+
+TEST(writer_error) {
+    // Opened read-only, so writes fail for as long as the descriptor is held. A closed
+    // descriptor could be reused by a test running alongside and receive the bytes.
+    int fd = open("/dev/null", O_RDONLY);
+    TEST_ASSERT(fd >= 0);
+
+    Writer writer = writer_new(fd, 0, &heap_allocator);
+    writer_write_cstr(&writer, "lost");
+    TEST_ASSERT(!writer_flush(&writer));
+    TEST_ASSERT(!writer_free(&writer));
+    close(fd);
+}
@@ -1,8 +1,28 @@
 #include "../lib/base.h"
 
+#include <pthread.h>
+
 HASH_TABLE_DECLARE(HashTable, hash_table, const char *, i32)
 HASH_TABLE_IMPLEMENT(HashTable, hash_table, const char *, i32)
 
+HASH_TABLE_DECLARE_INLINE(IntTable, int_table, u64, u64)
+HASH_TABLE_IMPLEMENT_INLINE(IntTable, int_table, u64, u64, integer_hash, integer_eq)
+
+FLAT_HASH_TABLE_DECLARE(FlatHashTable, flat_hash_table, const char *, i32)
+FLAT_HASH_TABLE_IMPLEMENT(FlatHashTable, flat_hash_table, const char *, i32)
+
+FLAT_HASH_TABLE_DECLARE(FlatIntTable, flat_int_table, u64, u64)
+FLAT_HASH_TABLE_IMPLEMENT(FlatIntTable, flat_int_table, u64, u64)
+
+HASH_SET_DECLARE(NameSet, name_set, const char *)
+HASH_SET_IMPLEMENT(NameSet, name_set, const char *)
+
+HASH_SET_DECLARE(IntSet, int_set, u64)
+HASH_SET_IMPLEMENT(IntSet, int_set, u64)
+
+CONCURRENT_HASH_TABLE_DECLARE(ConcurrentTable, concurrent_table, u64, u64)
+CONCURRENT_HASH_TABLE_IMPLEMENT(ConcurrentTable, concurrent_table, u64, u64)
+
 TEST(hash_table_new) {
     HashTable table = hash_table_new(cstr_hash, cstr_eq, &heap_allocator);
 
@@ -48,10 +68,11 @@ TEST(hash_table_set_get_remove) {
 TEST(hash_table_grow) {
     HashTable table = hash_table_new(cstr_hash, cstr_eq, &heap_allocator);
 
+    // The table stores the key pointers, so each key needs its own storage.
+    char keys[10][6];
     for (usize i = 0; i < 10; i++) {
-        char buffer[6];
-        snprintf(buffer, sizeof(buffer), "foo%zu", i);
-        hash_table_set(&table, buffer, i);
+        snprintf(keys[i], sizeof(keys[i]), "foo%zu", i);
+        hash_table_set(&table, keys[i], i);
     }
 
     TEST_ASSERT(table.bucket_count == 16);
@@ -82,11 +103,512 @@ TEST(hash_table_contains) {
     hash_table_free(&table);
 }
 
-void test_suite_hash_table(void) {
-    TEST_RUN(hash_table_new);
-    TEST_RUN(hash_table_set_get);
-    TEST_RUN(hash_table_set_get_remove);
-    TEST_RUN(hash_table_grow);
-    TEST_RUN(hash_table_reset);
-    TEST_RUN(hash_table_contains);
+TEST(hash_table_incremental) {
+    IntTable table = int_table_new(&heap_allocator);
+    int_table_set_incremental(&table, true);
+
+    bool migrating = false;
+    for (u64 i = 0; i < 1000; i++) {
+        int_table_set(&table, i, i * 2);
+        if (table.old_buckets != NULL) {
+            migrating = true;
+            // Entries in both bucket arrays stay reachable while the migration runs.
+            TEST_ASSERT(int_table_get(&table, 0) == 0);
+            TEST_ASSERT(int_table_get(&table, i) == i * 2);
+        }
+    }
+    TEST_ASSERT(migrating);
+    TEST_ASSERT(table.size == 1000);
+
+    for (u64 i = 0; i < 1000; i += 2) {
+        TEST_ASSERT(int_table_remove(&table, i));
+    }
+    TEST_ASSERT(table.size == 500);
+    for (u64 i = 0; i < 1000; i++) {
+        TEST_ASSERT(int_table_contains(&table, i) == (i % 2 == 1));
+    }
+
+    // Growing again mid-migration finishes the previous one first.
+    for (u64 i = 1000; i < 5000; i++) {
+        int_table_set(&table, i, i * 2);
+    }
+    TEST_ASSERT(table.size == 4500);
+    TEST_ASSERT(int_table_get(&table, 4999) == 9998);
+
+    int_table_set_incremental(&table, false);
+    TEST_ASSERT(table.old_buckets == NULL);
+
+    int_table_free(&table);
+}
+
+TEST(hash_table_with_capacity) {
+    HashTable table = hash_table_with_capacity(cstr_hash, cstr_eq, 100, &heap_allocator);
+    TEST_ASSERT(table.bucket_count == 256);
+    hash_table_free(&table);
+
+    IntTable ints = int_table_with_capacity(6, &heap_allocator);
+    TEST_ASSERT(ints.bucket_count == 8);
+
+    for (u64 i = 0; i < 10; i++) {
+        int_table_set(&ints, i, i);
+    }
+    int_table_reserve(&ints, 1000);
+    TEST_ASSERT(ints.bucket_count == 2048);
+    TEST_ASSERT(ints.old_buckets == NULL);
+    TEST_ASSERT(ints.size == 10);
+    TEST_ASSERT(int_table_get(&ints, 9) == 9);
+
+    // Reserving less than the current capacity never shrinks.
+    int_table_reserve(&ints, 10);
+    TEST_ASSERT(ints.bucket_count == 2048);
+
+    int_table_free(&ints);
+}
+
+TEST(hash_table_set_get_many) {
+    IntTable table = int_table_new(&heap_allocator);
+
+    u64 keys[100];
+    u64 values[100];
+    for (u64 i = 0; i < 100; i++) {
+        keys[i] = i * 2;
+        values[i] = i * 10;
+    }
+    int_table_set_many(&table, keys, values, 100);
+    TEST_ASSERT(table.size == 100);
+    TEST_ASSERT(int_table_get(&table, 198) == 990);
+
+    // Odd keys are missing and keep their sentinel value.
+    u64 lookup[100];
+    u64 results[100];
+    bool found[100];
+    for (u64 i = 0; i < 100; i++) {
+        lookup[i] = i;
+        results[i] = 12345;
+    }
+    TEST_ASSERT(int_table_get_many(&table, lookup, results, found, 100) == 50);
+    for (u64 i = 0; i < 100; i++) {
+        TEST_ASSERT(found[i] == (i % 2 == 0));
+        TEST_ASSERT(results[i] == (i % 2 == 0 ? i * 5 : 12345));
+    }
+    TEST_ASSERT(int_table_get_many(&table, lookup, results, NULL, 3) == 2);
+
+    int_table_free(&table);
+}
+
+TEST(hash_table_inline_new) {
+    IntTable table = int_table_new(&heap_allocator);
+
+    TEST_ASSERT(table.buckets != NULL);
+    TEST_ASSERT(table.bucket_count == 8);
+    TEST_ASSERT(table.size == 0);
+    TEST_ASSERT(table.allocator == &heap_allocator);
+    TEST_ASSERT(sizeof(IntTable) == sizeof(HashTable) - 2 * sizeof(void *));
+
+    int_table_free(&table);
+}
+
+TEST(hash_table_inline_set_get_remove) {
+    IntTable table = int_table_new(&heap_allocator);
+
+    for (u64 i = 0; i < 100; i++) {
+        int_table_set(&table, i, i * 3);
+    }
+    int_table_set(&table, 7, 42);
+
+    TEST_ASSERT(table.size == 100);
+    TEST_ASSERT(table.bucket_count == 256);
+    TEST_ASSERT(int_table_get(&table, 7) == 42);
+    TEST_ASSERT(int_table_get(&table, 99) == 297);
+    TEST_ASSERT(!int_table_contains(&table, 100));
+
+    TEST_ASSERT(int_table_remove(&table, 7));
+    TEST_ASSERT(!int_table_remove(&table, 7));
+    TEST_ASSERT(!int_table_contains(&table, 7));
+    TEST_ASSERT(table.size == 99);
+
+    int_table_reset(&table);
+    TEST_ASSERT(table.size == 0);
+    TEST_ASSERT(!int_table_contains(&table, 1));
+
+    int_table_free(&table);
+}
+
+TEST(flat_hash_table_new) {
+    FlatHashTable table = flat_hash_table_new(cstr_hash, cstr_eq, &heap_allocator);
+
+    TEST_ASSERT(table.control != NULL);
+    TEST_ASSERT(table.slots != NULL);
+    TEST_ASSERT(table.capacity == FLAT_GROUP_WIDTH);
+    TEST_ASSERT(table.size == 0);
+    TEST_ASSERT(table.hash == cstr_hash);
+    TEST_ASSERT(table.eq == cstr_eq);
+    TEST_ASSERT(table.allocator == &heap_allocator);
+
+    flat_hash_table_free(&table);
+}
+
+TEST(flat_hash_table_set_get_remove) {
+    FlatHashTable table = flat_hash_table_new(cstr_hash, cstr_eq, &heap_allocator);
+
+    flat_hash_table_set(&table, "foo", 42);
+    flat_hash_table_set(&table, "bar", 69);
+    TEST_ASSERT(flat_hash_table_get(&table, "foo") == 42);
+    TEST_ASSERT(flat_hash_table_get(&table, "bar") == 69);
+
+    flat_hash_table_set(&table, "foo", 420);
+    TEST_ASSERT(flat_hash_table_get(&table, "foo") == 420);
+    TEST_ASSERT(table.size == 2);
+
+    TEST_ASSERT(flat_hash_table_remove(&table, "foo"));
+    TEST_ASSERT(!flat_hash_table_remove(&table, "foo"));
+    TEST_ASSERT(!flat_hash_table_contains(&table, "foo"));
+    TEST_ASSERT(flat_hash_table_contains(&table, "bar"));
+    TEST_ASSERT(table.size == 1);
+
+    flat_hash_table_free(&table);
+}
+
+TEST(flat_hash_table_grow) {
+    FlatIntTable table = flat_int_table_new(integer_hash, integer_eq, &heap_allocator);
+
+    for (u64 i = 0; i < 10000; i++) {
+        flat_int_table_set(&table, i, i * 2);
+    }
+
+    TEST_ASSERT(table.size == 10000);
+    TEST_ASSERT(table.capacity >= 10000 + 10000 / 7);
+
+    bool all_found = true;
+    for (u64 i = 0; i < 10000; i++) {
+        all_found &= flat_int_table_get(&table, i) == i * 2;
+    }
+    TEST_ASSERT(all_found);
+    TEST_ASSERT(!flat_int_table_contains(&table, 10000));
+
+    flat_int_table_free(&table);
+}
+
+TEST(flat_hash_table_get_many) {
+    FlatIntTable table = flat_int_table_new(integer_hash, integer_eq, &heap_allocator);
+    for (u64 i = 0; i < 100; i++) {
+        flat_int_table_set(&table, i * 2, i * 10);
+    }
+
+    // Odd keys are missing and keep their sentinel value.
+    u64 lookup[100];
+    u64 results[100];
+    bool found[100];
+    for (u64 i = 0; i < 100; i++) {
+        lookup[i] = i;
+        results[i] = 12345;
+    }
+    TEST_ASSERT(flat_int_table_get_many(&table, lookup, results, found, 100) == 50);
+    for (u64 i = 0; i < 100; i++) {
+        TEST_ASSERT(found[i] == (i % 2 == 0));
+        TEST_ASSERT(results[i] == (i % 2 == 0 ? i * 5 : 12345));
+    }
+    TEST_ASSERT(flat_int_table_get_many(&table, lookup, results, NULL, 3) == 2);
+
+    flat_int_table_free(&table);
+}
+
+TEST(flat_hash_table_churn) {
+    FlatIntTable table = flat_int_table_new(integer_hash, integer_eq, &heap_allocator);
+
+    // Keep the live set small while cycling through many keys so the table has to
+    // reclaim tombstones instead of growing.
+    for (u64 i = 0; i < 100000; i++) {
+        flat_int_table_set(&table, i, i);
+        if (i >= 32) {
+            TEST_ASSERT(flat_int_table_remove(&table, i - 32));
+        }
+    }
+
+    TEST_ASSERT(table.size == 32);
+    TEST_ASSERT(table.capacity <= 256);
+    for (u64 i = 100000 - 32; i < 100000; i++) {
+        TEST_ASSERT(flat_int_table_get(&table, i) == i);
+    }
+    TEST_ASSERT(!flat_int_table_contains(&table, 100000 - 33));
+
+    flat_int_table_free(&table);
+}
+
+TEST(flat_hash_table_reset) {
+    FlatHashTable table = flat_hash_table_new(cstr_hash, cstr_eq, &heap_allocator);
+
+    flat_hash_table_set(&table, "foo", 42);
+    TEST_ASSERT(flat_hash_table_get(&table, "foo") == 42);
+
+    flat_hash_table_reset(&table);
+    TEST_ASSERT(table.size == 0);
+    TEST_ASSERT(!flat_hash_table_contains(&table, "foo"));
+
+    flat_hash_table_set(&table, "foo", 69);
+    TEST_ASSERT(flat_hash_table_get(&table, "foo") == 69);
+
+    flat_hash_table_free(&table);
+}
+
+TEST(hash_table_pool_allocator) {
+    Pool pool = pool_new(sizeof(HashTableEntry), 64, &heap_allocator);
+    HashTable table = hash_table_new(cstr_hash, cstr_eq, &pool.allocator);
+    const char *keys[] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+
+    for (usize i = 0; i < 10; i++) {
+        hash_table_set(&table, keys[i], i);
+    }
+    TEST_ASSERT(table.bucket_count == 16);
+    for (usize i = 0; i < 10; i++) {
+        TEST_ASSERT(hash_table_get(&table, keys[i]) == i);
+    }
+    TEST_ASSERT(hash_table_remove(&table, "a"));
+    TEST_ASSERT(!hash_table_contains(&table, "a"));
+
+    hash_table_free(&table);
+    TEST_ASSERT(pool.large == NULL);
+
+    pool_free(&pool);
+}
+
+TEST(hash_set_insert_contains_remove) {
+    NameSet set = name_set_new(cstr_hash, cstr_eq, &heap_allocator);
+
+    TEST_ASSERT(name_set_insert(&set, "foo"));
+    TEST_ASSERT(name_set_insert(&set, "bar"));
+    TEST_ASSERT(!name_set_insert(&set, "foo"));
+    TEST_ASSERT(set.size == 2);
+    TEST_ASSERT(name_set_contains(&set, "foo"));
+    TEST_ASSERT(!name_set_contains(&set, "baz"));
+
+    TEST_ASSERT(name_set_remove(&set, "foo"));
+    TEST_ASSERT(!name_set_remove(&set, "foo"));
+    TEST_ASSERT(!name_set_contains(&set, "foo"));
+    TEST_ASSERT(set.size == 1);
+
+    name_set_reset(&set);
+    TEST_ASSERT(set.size == 0);
+    TEST_ASSERT(!name_set_contains(&set, "bar"));
+
+    name_set_free(&set);
+}
+
+TEST(hash_set_grow_iterate) {
+    IntSet set = int_set_new(integer_hash, integer_eq, &heap_allocator);
+
+    IntSetIterator empty = int_set_iterator(&set);
+    u64 key;
+    TEST_ASSERT(!int_set_next(&empty, &key));
+
+    for (u64 i = 0; i < 100000; i++) {
+        int_set_insert(&set, i * 7);
+    }
+    // Removing every other key leaves tombstones for the iterator to skip.
+    for (u64 i = 0; i < 100000; i += 2) {
+        TEST_ASSERT(int_set_remove(&set, i * 7));
+    }
+    TEST_ASSERT(set.size == 50000);
+
+    usize count = 0;
+    u64 sum = 0;
+    bool all_odd = true;
+    IntSetIterator iterator = int_set_iterator(&set);
+    while (int_set_next(&iterator, &key)) {
+        count++;
+        sum += key;
+        if ((key / 7) % 2 != 1) all_odd = false;
+    }
+    TEST_ASSERT(count == 50000);
+    TEST_ASSERT(all_odd);
+    TEST_ASSERT(sum == 7ULL * 50000 * 50000);
+
+    int_set_free(&set);
+}
+
+TEST(hash_set_reserve) {
+    IntSet set = int_set_new(integer_hash, integer_eq, &heap_allocator);
+    int_set_reserve(&set, 1000);
+    usize capacity = set.capacity;
+    TEST_ASSERT(capacity - capacity / 8 >= 1000);
+    for (u64 i = 0; i < 1000; i++) {
+        int_set_insert(&set, i);
+    }
+    TEST_ASSERT(set.capacity == capacity);
+    int_set_reserve(&set, 10);
+    TEST_ASSERT(set.capacity == capacity);
+    int_set_free(&set);
+}
+
+static IntSet test_int_set_range(u64 start, u64 end) {
+    IntSet set = int_set_new(integer_hash, integer_eq, &heap_allocator);
+    for (u64 i = start; i < end; i++) {
+        int_set_insert(&set, i);
+    }
+    return set;
+}
+
+static bool test_int_set_is_range(IntSet *set, u64 start, u64 end) {
+    if (set->size != end - start) return false;
+    for (u64 i = start; i < end; i++) {
+        if (!int_set_contains(set, i)) return false;
+    }
+    return true;
+}
+
+TEST(hash_set_algebra) {
+    // Both ways round, since the smaller side picks the strategy.
+    u64 sizes[][2] = { { 1000, 100 }, { 100, 1000 } };
+    for (usize i = 0; i < 2; i++) {
+        u64 a_end = sizes[i][0];
+        u64 b_start = a_end / 2;
+        u64 b_end = b_start + sizes[i][1];
+        u64 overlap_end = a_end < b_end ? a_end : b_end;
+
+        IntSet a = test_int_set_range(0, a_end);
+        IntSet b = test_int_set_range(b_start, b_end);
+        int_set_union(&a, &b);
+        TEST_ASSERT(test_int_set_is_range(&a, 0, a_end > b_end ? a_end : b_end));
+        int_set_free(&a);
+
+        a = test_int_set_range(0, a_end);
+        int_set_intersect(&a, &b);
+        TEST_ASSERT(test_int_set_is_range(&a, b_start, overlap_end));
+        int_set_free(&a);
+
+        a = test_int_set_range(0, a_end);
+        int_set_difference(&a, &b);
+        bool difference = a.size == b_start + (a_end > b_end ? a_end - b_end : 0);
+        for (u64 k = 0; k < a_end; k++) {
+            if (int_set_contains(&a, k) != (k < b_start || k >= b_end)) difference = false;
+        }
+        TEST_ASSERT(difference);
+        int_set_free(&a);
+
+        int_set_free(&b);
+    }
+
+    IntSet a = test_int_set_range(0, 10);
+    IntSet empty = int_set_new(integer_hash, integer_eq, &heap_allocator);
+    int_set_intersect(&a, &empty);
+    TEST_ASSERT(a.size == 0);
+    int_set_union(&a, &empty);
+    TEST_ASSERT(a.size == 0);
+    int_set_free(&a);
+    int_set_free(&empty);
+}
+
+TEST(concurrent_hash_table_set_get_remove) {
+    ConcurrentTable table = concurrent_table_new(integer_hash, integer_eq, &heap_allocator);
+    TEST_ASSERT(sizeof(ConcurrentStripe) == CACHE_LINE_SIZE);
+
+    for (u64 i = 0; i < 1000; i++) {
+        concurrent_table_set(&table, i, i * 2);
+    }
+    concurrent_table_set(&table, 7, 42);
+
+    TEST_ASSERT(concurrent_table_size(&table) == 1000);
+    TEST_ASSERT(table.array->capacity >= 1000);
+    TEST_ASSERT(concurrent_table_get(&table, 7) == 42);
+    TEST_ASSERT(concurrent_table_get(&table, 999) == 1998);
+
+    u64 value = 0;
+    TEST_ASSERT(!concurrent_table_try_get(&table, 1000, &value));
+    TEST_ASSERT(value == 0);
+
+    TEST_ASSERT(concurrent_table_remove(&table, 7));
+    TEST_ASSERT(!concurrent_table_remove(&table, 7));
+    TEST_ASSERT(!concurrent_table_contains(&table, 7));
+    concurrent_table_set(&table, 7, 43);
+    TEST_ASSERT(concurrent_table_get(&table, 7) == 43);
+    TEST_ASSERT(concurrent_table_size(&table) == 1000);
+    TEST_ASSERT(concurrent_table_get(&table, 500) == 1000);
+
+    concurrent_table_free(&table);
+}
+
+// Replacing keys one by one leaves a tombstone per step. They are purged in place and
+// grown-out arrays are freed straight away, so the table holds one array the whole time.
+TEST(concurrent_hash_table_churn) {
+    TrackingAllocator tracker = tracking_allocator_new("concurrent", &heap_allocator);
+    ConcurrentTable table = concurrent_table_new(integer_hash, integer_eq, &tracker.allocator);
+
+    for (u64 i = 0; i < 300; i++) {
+        concurrent_table_set(&table, i, i);
+    }
+    TrackingStats stats = tracking_allocator_stats(&tracker);
+    TEST_ASSERT(stats.allocs == stats.frees + 1);
+    usize capacity = table.array->capacity;
+    u64 live_bytes = stats.live_bytes;
+
+    for (u64 i = 300; i < 100000; i++) {
+        TEST_ASSERT(concurrent_table_remove(&table, i - 300));
+        concurrent_table_set(&table, i, i);
+    }
+    stats = tracking_allocator_stats(&tracker);
+    TEST_ASSERT(stats.allocs == stats.frees + 1);
+    TEST_ASSERT(stats.live_bytes == live_bytes);
+    TEST_ASSERT(table.array->capacity == capacity);
+    TEST_ASSERT(concurrent_table_size(&table) == 300);
+    TEST_ASSERT(!concurrent_table_contains(&table, 99699));
+    TEST_ASSERT(concurrent_table_get(&table, 99700) == 99700);
+    TEST_ASSERT(concurrent_table_get(&table, 99999) == 99999);
+
+    concurrent_table_free(&table);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).live_bytes == 0);
+}
+
+#define CONCURRENT_TEST_THREADS 4
+#define CONCURRENT_TEST_KEYS 20000
+
+typedef struct {
+    ConcurrentTable *table;
+    u64 thread;
+    u64 errors;
+} ConcurrentTestWorker;
+
+// Each thread owns the keys equal to its index mod CONCURRENT_TEST_THREADS, writes them
+// twice, removes every other one and reads back the whole key range as it goes.
+static void *concurrent_test_worker(void *argument) {
+    ConcurrentTestWorker *worker = (ConcurrentTestWorker *)argument;
+    for (u64 key = worker->thread; key < CONCURRENT_TEST_KEYS; key += CONCURRENT_TEST_THREADS) {
+        concurrent_table_set(worker->table, key, key);
+        concurrent_table_set(worker->table, key, key + 1);
+        if (concurrent_table_get(worker->table, key) != key + 1) worker->errors++;
+        if (key % 2 == 0 && !concurrent_table_remove(worker->table, key)) worker->errors++;
+
+        // Other threads' keys are absent, or hold either of the two values written.
+        u64 other = (key * 7919) % CONCURRENT_TEST_KEYS;
+        u64 value;
+        if (concurrent_table_try_get(worker->table, other, &value) &&
+            value != other && value != other + 1) {
+            worker->errors++;
+        }
+    }
+    return NULL;
+}
+
+TEST(concurrent_hash_table_threads) {
+    ConcurrentTable table = concurrent_table_new(integer_hash, integer_eq, &heap_allocator);
+
+    pthread_t threads[CONCURRENT_TEST_THREADS];
+    ConcurrentTestWorker workers[CONCURRENT_TEST_THREADS];
+    for (u64 i = 0; i < CONCURRENT_TEST_THREADS; i++) {
+        workers[i] = (ConcurrentTestWorker){ .table = &table, .thread = i };
+        TEST_ASSERT(pthread_create(&threads[i], NULL, concurrent_test_worker, &workers[i]) == 0);
+    }
+    for (u64 i = 0; i < CONCURRENT_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        TEST_ASSERT(workers[i].errors == 0);
+    }
+
+    TEST_ASSERT(concurrent_table_size(&table) == CONCURRENT_TEST_KEYS / 2);
+    for (u64 key = 0; key < CONCURRENT_TEST_KEYS; key++) {
+        u64 value = 0;
+        bool found = concurrent_table_try_get(&table, key, &value);
+        TEST_ASSERT(found == (key % 2 == 1));
+        if (found) TEST_ASSERT(value == key + 1);
+    }
+
+    concurrent_table_free(&table);
 }
@@ -1,5 +1,7 @@
 #include "../lib/base.h"
 
+#include <pthread.h>
+
 TEST(string_from_cstr) {
     String str = string("Hello, world!", &heap_allocator);
 
@@ -66,11 +68,542 @@ TEST(string_not_eq_cstr) {
     string_free(&a);
 }
 
-void test_suite_string(void) {
-    TEST_RUN(string_from_cstr);
-    TEST_RUN(string_concat);
-    TEST_RUN(string_slice);
-    TEST_RUN(string_eq);
-    TEST_RUN(string_not_eq);
-    TEST_RUN(string_not_eq_cstr);
+TEST(string_hash) {
+    String a = string("Hello, world!", &heap_allocator);
+    String b = string("Hello, world!", &heap_allocator);
+    String c = string("Hello, world?", &heap_allocator);
+
+    TEST_ASSERT(string_hash(a) == string_hash(b));
+    TEST_ASSERT(string_hash(a) != string_hash(c));
+    TEST_ASSERT(string_hash(a) == cstr_hash("Hello, world!"));
+    TEST_ASSERT(string_hash(string_slice(a, 0, 5)) == cstr_hash("Hello"));
+
+    string_free(&a);
+    string_free(&b);
+    string_free(&c);
+}
+
+TEST(string_hash_lengths) {
+    // Every length takes a different read path up to 100 bytes, flip each byte in turn.
+    u8 buffer[100];
+    for (usize i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (u8)(i * 7);
+    }
+
+    bool all_differ = true;
+    for (usize length = 1; length <= sizeof(buffer); length++) {
+        String str = {buffer, length, NULL};
+        u64 hash = string_hash(str);
+        all_differ &= hash != string_hash(string_slice(str, 0, length - 1));
+        for (usize i = 0; i < length; i++) {
+            buffer[i] ^= 1;
+            all_differ &= string_hash(str) != hash;
+            buffer[i] ^= 1;
+        }
+    }
+    TEST_ASSERT(all_differ);
+}
+
+TEST(string_hash_seeded) {
+    String str = string("Hello, world!", &heap_allocator);
+
+    TEST_ASSERT(string_hash_seeded(str, 0) == string_hash(str));
+    TEST_ASSERT(string_hash_seeded(str, 1) != string_hash(str));
+    TEST_ASSERT(string_hash_seeded(str, 1) == hash_bytes("Hello, world!", 13, 1));
+    TEST_ASSERT(hash_random_seed() != hash_random_seed());
+
+    string_free(&str);
+}
+
+// Small alphabets so searches see many partial matches.
+static void test_fill_random(u8 *buffer, usize length, u32 alphabet, u64 *state) {
+    for (usize i = 0; i < length; i++) {
+        *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+        buffer[i] = (u8)('a' + (*state >> 33) % alphabet);
+    }
+}
+
+static void *test_read_simd_level(void *level) {
+    *(SimdLevel *)level = simd_level();
+    return NULL;
+}
+
+TEST(simd_set_level_per_thread) {
+    SimdLevel detected = simd_level();
+    simd_set_level(SIMD_SCALAR);
+    TEST_ASSERT(simd_level() == SIMD_SCALAR);
+
+    // Other threads, like the ones running other tests, keep the best level.
+    SimdLevel other = SIMD_SCALAR;
+    pthread_t thread;
+    pthread_create(&thread, NULL, test_read_simd_level, &other);
+    pthread_join(thread, NULL);
+    TEST_ASSERT(other == detected);
+
+    simd_set_level(SIMD_AVX2);
+    TEST_ASSERT(simd_level() == detected);
+}
+
+TEST(string_search_matches_scalar) {
+    u8 haystack[600];
+    u8 needle[40];
+    u64 state = 1;
+    for (SimdLevel level = SIMD_SCALAR; level <= SIMD_AVX2; level++) {
+        simd_set_level(level);
+        for (usize length = 0; length < sizeof(haystack); length += 1 + length / 8) {
+            for (u32 round = 0; round < 8; round++) {
+                test_fill_random(haystack, length, 2 + round % 3, &state);
+                String h = { .buffer = haystack, .length = length };
+                usize needle_length = (state >> 40) % 12;
+                if (round == 7) needle_length = 33;
+                test_fill_random(needle, needle_length, 2 + round % 3, &state);
+                String n = { .buffer = needle, .length = needle_length };
+                String copy = { .buffer = needle, .length = needle_length };
+                u8 byte = (u8)('a' + round % 4);
+
+                TEST_ASSERT(string_find(h, n) == string_find_scalar(h, n));
+                TEST_ASSERT(string_rfind(h, n) == string_rfind_scalar(h, n));
+                TEST_ASSERT(string_find_byte(h, byte) == string_find_byte_scalar(h, byte));
+                TEST_ASSERT(string_count_byte(h, byte) == string_count_byte_scalar(h, byte));
+                TEST_ASSERT(string_eq(h, h) && string_eq(n, copy));
+
+                // Needles taken from the haystack itself always match.
+                if (length > 0) {
+                    usize start = (state >> 20) % length;
+                    usize end = start + (state >> 45) % (length - start + 1);
+                    String slice = string_slice(h, start, end);
+                    TEST_ASSERT(string_find(h, slice) <= start);
+                    TEST_ASSERT(string_rfind(h, slice) >= start);
+                    TEST_ASSERT(string_find(h, slice) == string_find_scalar(h, slice));
+                    TEST_ASSERT(string_rfind(h, slice) == string_rfind_scalar(h, slice));
+
+                    // A difference at any position, including the overlapping tail.
+                    u8 other[600];
+                    memcpy(other, haystack, length);
+                    other[(state >> 10) % length] ^= 1;
+                    String o = { .buffer = other, .length = length };
+                    TEST_ASSERT(!string_eq(h, o));
+                    TEST_ASSERT(string_eq(h, o) == string_eq_scalar(h, o));
+                }
+            }
+        }
+    }
+    simd_set_level(SIMD_AVX2);
+}
+
+TEST(string_count_byte_large) {
+    // Long enough for the per-byte counters to have to be flushed many times.
+    String str = string_new(1 << 20, &heap_allocator);
+    memset(str.buffer, 'x', str.length);
+    for (SimdLevel level = SIMD_SCALAR; level <= SIMD_AVX2; level++) {
+        simd_set_level(level);
+        TEST_ASSERT(string_count_byte(str, 'x') == str.length);
+        TEST_ASSERT(string_count_byte(str, 'y') == 0);
+        TEST_ASSERT(utf8_count(str) == str.length);
+    }
+    simd_set_level(SIMD_AVX2);
+    string_free(&str);
+}
+
+TEST(utf8_validate) {
+    const char *valid[] = {
+        "", "ascii only", "caf\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+        "\xED\x9F\xBF", "\xF4\x8F\xBF\xBF", "\xEF\xBB\xBF" "0123456789abcdef0123456789abcdef\xC3\xA9"
+    };
+    const char *invalid[] = {
+        "\x80", "\xC0\xAF", "\xC1\xBF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF0\x80\x80\xAF",
+        "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\xC3", "\xE2\x82",
+        "0123456789abcdef0123456789abcdef\xE2\x82", "0123456789abcdef0123456789abcde\xC3("
+    };
+    for (SimdLevel level = SIMD_SCALAR; level <= SIMD_AVX2; level++) {
+        simd_set_level(level);
+        for (usize i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+            String str = { .buffer = (u8 *)valid[i], .length = strlen(valid[i]) };
+            TEST_ASSERT(utf8_validate(str));
+        }
+        for (usize i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            String str = { .buffer = (u8 *)invalid[i], .length = strlen(invalid[i]) };
+            TEST_ASSERT(!utf8_validate(str));
+        }
+
+        String mixed = { .buffer = (u8 *)"a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80z", .length = 11 };
+        TEST_ASSERT(utf8_count(mixed) == 5);
+    }
+
+    // Random mixes of ASCII and multi-byte sequences, some with a byte flipped.
+    const char *pieces[] = {"abcdefgh", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", " "};
+    u8 buffer[512];
+    u64 state = 7;
+    for (u32 round = 0; round < 500; round++) {
+        usize length = 0;
+        while (length < 400) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            const char *piece = pieces[(state >> 33) % 5];
+            memcpy(buffer + length, piece, strlen(piece));
+            length += strlen(piece);
+        }
+        if (round % 2 == 1) buffer[(state >> 20) % length] ^= (u8)(1 << (state >> 50) % 8);
+        String str = { .buffer = buffer, .length = length };
+        for (SimdLevel level = SIMD_SCALAR; level <= SIMD_AVX2; level++) {
+            simd_set_level(level);
+            TEST_ASSERT(utf8_validate(str) == utf8_validate_scalar(str));
+            TEST_ASSERT(utf8_count(str) == utf8_count_scalar(str));
+        }
+    }
+    simd_set_level(SIMD_AVX2);
+}
+
+TEST(string_builder_append) {
+    StringBuilder builder = string_builder_new(0, &heap_allocator);
+
+    string_builder_append_cstr(&builder, "Hello");
+    string_builder_append_byte(&builder, ',');
+    String world = string(" world!", &heap_allocator);
+    string_builder_append(&builder, world);
+    string_free(&world);
+
+    String str = string_builder_finish(&builder);
+    TEST_ASSERT(string_eq_cstr(str, "Hello, world!"));
+    TEST_ASSERT(str.allocator == &heap_allocator);
+    TEST_ASSERT(builder.buffer == NULL);
+    TEST_ASSERT(builder.length == 0);
+
+    string_free(&str);
+}
+
+TEST(string_builder_grow) {
+    TrackingAllocator tracker = tracking_allocator_new("string_builder", &heap_allocator);
+    StringBuilder builder = string_builder_new(0, &tracker.allocator);
+
+    for (usize i = 0; i < 10000; i++) {
+        string_builder_append_byte(&builder, (u8)('a' + i % 26));
+    }
+    TEST_ASSERT(builder.length == 10000);
+    for (usize i = 0; i < 10000; i++) {
+        TEST_ASSERT(builder.buffer[i] == (u8)('a' + i % 26));
+    }
+    // Geometric growth, not one reallocation per append.
+    TEST_ASSERT(tracking_allocator_stats(&tracker).allocs < 16);
+
+    string_builder_free(&builder);
+    TEST_ASSERT(tracking_allocator_stats(&tracker).live_bytes == 0);
+}
+
+TEST(string_builder_numbers) {
+    Arena arena = arena_new(1024, &heap_allocator);
+    StringBuilder builder = string_builder_new(4, &arena.allocator);
+
+    string_builder_append_u64(&builder, 0);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_u64(&builder, 7);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_u64(&builder, 1234567890);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_u64(&builder, UINT64_MAX);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_i64(&builder, -42);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_i64(&builder, INT64_MIN);
+    TEST_ASSERT(string_eq_cstr(string_builder_finish(&builder),
+                               "0 7 1234567890 18446744073709551615 -42 -9223372036854775808"));
+
+    builder = string_builder_new(0, &arena.allocator);
+    string_builder_append_f64(&builder, 3.14159, 2);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_f64(&builder, -0.5, 0);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_f64(&builder, 9.9996, 3);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_f64(&builder, 0.05, 3);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_f64(&builder, 1e20, 1);
+    string_builder_append_byte(&builder, ' ');
+    string_builder_append_f64(&builder, -1.0 / 0.0, 1);
+    TEST_ASSERT(string_eq_cstr(string_builder_finish(&builder),
+                               "3.14 -1 10.000 0.050 100000000000000000000.0 -inf"));
+
+    arena_free(&arena);
+}
+
+TEST(string_builder_appendf) {
+    StringBuilder builder = string_builder_new(8, &heap_allocator);
+
+    string_builder_appendf(&builder, "%d-%s", 12, "ab");
+    TEST_ASSERT(builder.length == 5);
+    // Longer than the spare capacity, so it has to grow and format again.
+    string_builder_appendf(&builder, " %s %05.1f", "a much longer fragment", 2.25);
+
+    String str = string_builder_finish(&builder);
+    TEST_ASSERT(string_eq_cstr(str, "12-ab a much longer fragment 002.2"));
+    string_free(&str);
+
+    String empty = string_builder_finish(&builder);
+    TEST_ASSERT(empty.length == 0);
+    string_free(&empty);
+}
+
+// Views a literal without copying it, so nothing is terminated past length.
+static String test_view(const char *cstr) {
+    String str = { .buffer = (u8 *)cstr, .length = strlen(cstr) };
+    return str;
+}
+
+TEST(string_parse_integers) {
+    u64 u;
+    i64 i;
+    TEST_ASSERT(string_parse_u64(test_view("0"), &u) && u == 0);
+    TEST_ASSERT(string_parse_u64(test_view("+42"), &u) && u == 42);
+    TEST_ASSERT(string_parse_u64(test_view("12345678901234"), &u) && u == 12345678901234ULL);
+    TEST_ASSERT(string_parse_u64(test_view("18446744073709551615"), &u) && u == UINT64_MAX);
+    TEST_ASSERT(string_parse_u64(test_view("00000000000000000000000000018446744073709551615"), &u) &&
+                u == UINT64_MAX);
+    TEST_ASSERT(!string_parse_u64(test_view("18446744073709551616"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view("28446744073709551615"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view("100000000000000000000"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view(""), &u));
+    TEST_ASSERT(!string_parse_u64(test_view("+"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view("-1"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view(" 1"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view("12345678x"), &u));
+    TEST_ASSERT(!string_parse_u64(test_view("1234567:"), &u));
+
+    TEST_ASSERT(string_parse_i64(test_view("-42"), &i) && i == -42);
+    TEST_ASSERT(string_parse_i64(test_view("9223372036854775807"), &i) && i == INT64_MAX);
+    TEST_ASSERT(string_parse_i64(test_view("-9223372036854775808"), &i) && i == INT64_MIN);
+    TEST_ASSERT(!string_parse_i64(test_view("9223372036854775808"), &i));
+    TEST_ASSERT(!string_parse_i64(test_view("-9223372036854775809"), &i));
+    TEST_ASSERT(!string_parse_i64(test_view("--1"), &i));
+    TEST_ASSERT(!string_parse_i64(test_view("-"), &i));
+
+    // The view is bounded by its length, not a terminator.
+    String digits = test_view("123456789");
+    TEST_ASSERT(string_parse_u64(string_slice(digits, 2, 7), &u) && u == 34567);
+
+    u64 state = 7;
+    for (u32 round = 0; round < 100000; round++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        u64 value = state >> (state % 64);
+        char buffer[NUMBER_FORMAT_MAX];
+        usize length = format_u64(buffer, value);
+        String str = { .buffer = (u8 *)buffer, .length = length };
+        TEST_ASSERT(string_parse_u64(str, &u) && u == value);
+    }
+}
+
+static bool test_parse_matches_strtod(const char *text) {
+    f64 value;
+    if (!string_parse_f64(test_view(text), &value)) return false;
+    f64 expected = strtod(text, NULL);
+    return memcmp(&value, &expected, sizeof(value)) == 0;
+}
+
+TEST(string_parse_f64) {
+    const char *cases[] = {
+        "0", "-0", "1", "-1.5", ".5", "5.", "+2.5e-3", "1E10", "0.1", "1e23", "4.35e-7",
+        "9007199254740993", "9007199254740992.9999999999999999999",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9e-324",
+        "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400", "1e400", "0e999999999",
+        "123456789012345678901", "1234567890123456789012345678901234567890e-30",
+        "0.000000000000000000000000000000000000000000000000001e50", "7.2057594037927933e16"
+    };
+    for (usize i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        TEST_ASSERT(test_parse_matches_strtod(cases[i]));
+    }
+
+    f64 value;
+    TEST_ASSERT(string_parse_f64(test_view("-inf"), &value) && value == -1.0 / 0.0);
+    TEST_ASSERT(string_parse_f64(test_view("Infinity"), &value) && value == 1.0 / 0.0);
+    TEST_ASSERT(string_parse_f64(test_view("NaN"), &value) && value != value);
+    const char *invalid[] = { "", "-", ".", "e5", "1e", "1e+", "1.2.3", "0x10", " 1", "1 ", "in", "nanx" };
+    for (usize i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        TEST_ASSERT(!string_parse_f64(test_view(invalid[i]), &value));
+    }
+
+    // Random doubles printed at every precision, and long mantissas that take the
+    // truncated path.
+    u64 state = 11;
+    char text[64];
+    for (u32 round = 0; round < 200000; round++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        u64 bits = state ^ (state >> 29);
+        f64 random;
+        memcpy(&random, &bits, sizeof(random));
+        if (random != random) continue;
+        if (round % 3 == 2) {
+            snprintf(text, sizeof(text), "%llu%llue%d", (unsigned long long)state,
+                     (unsigned long long)bits, (int)(state % 700) - 370);
+        } else {
+            snprintf(text, sizeof(text), "%.*g", (int)(round % 17) + 1, random);
+        }
+        TEST_ASSERT(test_parse_matches_strtod(text));
+    }
+}
+
+static bool test_format_f64(f64 value, const char *expected) {
+    char buffer[NUMBER_FORMAT_MAX];
+    usize length = format_f64(buffer, value);
+    String str = { .buffer = (u8 *)buffer, .length = length };
+    return string_eq_cstr(str, expected);
+}
+
+TEST(format_numbers) {
+    char buffer[NUMBER_FORMAT_MAX];
+    TEST_ASSERT(format_u64(buffer, 0) == 1 && buffer[0] == '0');
+    TEST_ASSERT(format_i64(buffer, INT64_MIN) == 20 && memcmp(buffer, "-9223372036854775808", 20) == 0);
+
+    TEST_ASSERT(test_format_f64(0.0, "0"));
+    TEST_ASSERT(test_format_f64(-0.0, "-0"));
+    TEST_ASSERT(test_format_f64(0.1, "0.1"));
+    TEST_ASSERT(test_format_f64(0.3, "0.3"));
+    TEST_ASSERT(test_format_f64(-12.5, "-12.5"));
+    TEST_ASSERT(test_format_f64(100, "100"));
+    TEST_ASSERT(test_format_f64(123.456, "123.456"));
+    TEST_ASSERT(test_format_f64(2.0 / 3.0, "0.6666666666666666"));
+    TEST_ASSERT(test_format_f64(1e-6, "0.000001"));
+    TEST_ASSERT(test_format_f64(1e-7, "1e-7"));
+    TEST_ASSERT(test_format_f64(1e20, "100000000000000000000"));
+    TEST_ASSERT(test_format_f64(1e21, "1e21"));
+    TEST_ASSERT(test_format_f64(1.5e300, "1.5e300"));
+    TEST_ASSERT(test_format_f64(5e-324, "5e-324"));
+    TEST_ASSERT(test_format_f64(1e-323, "1e-323"));
+    TEST_ASSERT(test_format_f64(5e-323, "5e-323"));
+    TEST_ASSERT(test_format_f64(2.2250738585072014e-308, "2.2250738585072014e-308"));
+    TEST_ASSERT(test_format_f64(1e23, "1e23"));
+    TEST_ASSERT(test_format_f64(30892612233637952.0, "30892612233637950"));
+    TEST_ASSERT(test_format_f64(9007199254740992.0, "9007199254740992"));
+    TEST_ASSERT(test_format_f64(1.7976931348623157e308, "1.7976931348623157e308"));
+    TEST_ASSERT(test_format_f64(-1.0 / 0.0, "-inf"));
+    TEST_ASSERT(test_format_f64(0.0 / 0.0, "nan"));
+
+    // Every finite double reads back as itself.
+    u64 state = 3;
+    for (u32 round = 0; round < 200000; round++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        u64 bits = state ^ (state >> 29);
+        f64 value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value != value || value - value != 0) continue;
+        usize length = format_f64(buffer, value);
+        TEST_ASSERT(length <= NUMBER_FORMAT_MAX);
+        String str = { .buffer = (u8 *)buffer, .length = length };
+        f64 parsed;
+        TEST_ASSERT(string_parse_f64(str, &parsed) && memcmp(&parsed, &value, sizeof(value)) == 0);
+    }
+
+    Arena arena = arena_new(256, &heap_allocator);
+    TEST_ASSERT(string_eq_cstr(string_from_u64(UINT64_MAX, &arena.allocator), "18446744073709551615"));
+    TEST_ASSERT(string_eq_cstr(string_from_i64(-7, &arena.allocator), "-7"));
+    TEST_ASSERT(string_eq_cstr(string_from_f64(0.25, &arena.allocator), "0.25"));
+    arena_free(&arena);
+}
+
+TEST(interner_intern) {
+    Interner interner = interner_new(&heap_allocator);
+
+    u32 hello = interner_intern_cstr(&interner, "hello");
+    u32 world = interner_intern_cstr(&interner, "world");
+    u32 empty = interner_intern_cstr(&interner, "");
+    TEST_ASSERT(hello == 0);
+    TEST_ASSERT(world == 1);
+    TEST_ASSERT(empty == 2);
+    TEST_ASSERT(interner_count(&interner) == 3);
+
+    String str = string("hello", &heap_allocator);
+    TEST_ASSERT(interner_intern(&interner, str) == hello);
+    TEST_ASSERT(interner_count(&interner) == 3);
+
+    // The canonical copy is the interner's, not the caller's.
+    String canonical = interner_string(&interner, hello);
+    TEST_ASSERT(string_eq(canonical, str));
+    TEST_ASSERT(canonical.buffer != str.buffer);
+    TEST_ASSERT(canonical.allocator == NULL);
+    TEST_ASSERT(strcmp(interner_cstr(&interner, world), "world") == 0);
+    TEST_ASSERT(interner_string(&interner, empty).length == 0);
+    string_free(&str);
+
+    u32 id = 0;
+    TEST_ASSERT(interner_find(&interner, string_slice(canonical, 0, 5), &id));
+    TEST_ASSERT(id == hello);
+    TEST_ASSERT(!interner_find(&interner, string_slice(canonical, 0, 4), &id));
+    TEST_ASSERT(interner_count(&interner) == 3);
+
+    interner_free(&interner);
+}
+
+TEST(interner_grow) {
+    Interner interner = interner_new(&heap_allocator);
+
+    // Enough to grow the index several times and fill more than one entry chunk.
+    char buffer[32];
+    for (u32 i = 0; i < 10000; i++) {
+        snprintf(buffer, sizeof(buffer), "name_%u", i);
+        TEST_ASSERT(interner_intern_cstr(&interner, buffer) == i);
+    }
+    for (u32 i = 0; i < 10000; i++) {
+        snprintf(buffer, sizeof(buffer), "name_%u", i);
+        TEST_ASSERT(interner_intern_cstr(&interner, buffer) == i);
+        TEST_ASSERT(strcmp(interner_cstr(&interner, i), buffer) == 0);
+    }
+    TEST_ASSERT(interner_count(&interner) == 10000);
+
+    // Longer than an arena block.
+    String large = string_new(4 * INTERNER_BLOCK_SIZE, &heap_allocator);
+    memset(large.buffer, 'x', large.length);
+    u32 id = interner_intern(&interner, large);
+    TEST_ASSERT(string_eq(interner_string(&interner, id), large));
+    string_free(&large);
+
+    interner_reclaim(&interner);
+    TEST_ASSERT(interner.retired == NULL);
+    interner_free(&interner);
+}
+
+#define INTERNER_TEST_THREADS 4
+#define INTERNER_TEST_STRINGS 5000
+
+typedef struct {
+    Interner *interner;
+    u32 thread;
+    u32 ids[INTERNER_TEST_STRINGS];
+} InternerTestWorker;
+
+// All threads intern the same strings, each starting at a different point.
+static void *interner_test_worker(void *argument) {
+    InternerTestWorker *worker = (InternerTestWorker *)argument;
+    u32 start = worker->thread * (INTERNER_TEST_STRINGS / INTERNER_TEST_THREADS);
+    char buffer[32];
+    for (u32 n = 0; n < INTERNER_TEST_STRINGS; n++) {
+        u32 i = (start + n * 7) % INTERNER_TEST_STRINGS;
+        snprintf(buffer, sizeof(buffer), "key_%u", i);
+        worker->ids[i] = interner_intern_cstr(worker->interner, buffer);
+    }
+    return NULL;
+}
+
+TEST(interner_threads) {
+    Interner interner = interner_new(&heap_allocator);
+
+    pthread_t threads[INTERNER_TEST_THREADS];
+    static InternerTestWorker workers[INTERNER_TEST_THREADS];
+    for (u32 i = 0; i < INTERNER_TEST_THREADS; i++) {
+        workers[i].interner = &interner;
+        workers[i].thread = i;
+        TEST_ASSERT(pthread_create(&threads[i], NULL, interner_test_worker, &workers[i]) == 0);
+    }
+    for (u32 i = 0; i < INTERNER_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    TEST_ASSERT(interner_count(&interner) == INTERNER_TEST_STRINGS);
+    char buffer[32];
+    for (u32 i = 0; i < INTERNER_TEST_STRINGS; i++) {
+        for (u32 t = 1; t < INTERNER_TEST_THREADS; t++) {
+            TEST_ASSERT(workers[t].ids[i] == workers[0].ids[i]);
+        }
+        snprintf(buffer, sizeof(buffer), "key_%u", i);
+        TEST_ASSERT(strcmp(interner_cstr(&interner, workers[0].ids[i]), buffer) == 0);
+    }
+
+    interner_free(&interner);
 }
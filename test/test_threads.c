@@ -0,0 +1,166 @@
+#include "../lib/base.h"
+
+#define THREAD_POOL_TEST_WORKERS 4
+
+static void thread_pool_test_increment(void *context) {
+    __atomic_add_fetch((u64 *)context, 1, __ATOMIC_RELAXED);
+}
+
+TEST(task_group_spawn_from_outside) {
+    ThreadPool pool;
+    thread_pool_start(&pool, THREAD_POOL_TEST_WORKERS, &heap_allocator);
+    TEST_ASSERT(thread_pool_worker_count(&pool) == THREAD_POOL_TEST_WORKERS);
+    TEST_ASSERT(thread_pool_worker_index(&pool) == -1);
+
+    // More than the shared queue starts with, so it has to grow while workers drain it.
+    u64 counter = 0;
+    TaskGroup group = task_group_new(&pool);
+    for (u32 i = 0; i < 10000; i++) {
+        task_group_spawn(&group, thread_pool_test_increment, &counter);
+    }
+    task_group_wait(&group);
+    TEST_ASSERT(counter == 10000);
+
+    // Spawned and never waited on: stopping still runs them.
+    for (u32 i = 0; i < 100; i++) {
+        task_group_spawn(&group, thread_pool_test_increment, &counter);
+    }
+    thread_pool_stop(&pool);
+    TEST_ASSERT(counter == 10100);
+}
+
+// Recursive fork/join, so tasks spawn onto their own deques, get stolen, and wait inside
+// workers.
+typedef struct {
+    ThreadPool *pool;
+    u32 n;
+    u64 result;
+} FibonacciTask;
+
+static void thread_pool_test_fibonacci(void *context) {
+    FibonacciTask *task = (FibonacciTask *)context;
+    if (task->n < 2) {
+        task->result = task->n;
+        return;
+    }
+    FibonacciTask left = { .pool = task->pool, .n = task->n - 1 };
+    FibonacciTask right = { .pool = task->pool, .n = task->n - 2 };
+    TaskGroup group = task_group_new(task->pool);
+    task_group_spawn(&group, thread_pool_test_fibonacci, &left);
+    thread_pool_test_fibonacci(&right);
+    task_group_wait(&group);
+    task->result = left.result + right.result;
+}
+
+TEST(task_group_nested) {
+    ThreadPool pool;
+    thread_pool_start(&pool, THREAD_POOL_TEST_WORKERS, &heap_allocator);
+
+    FibonacciTask root = { .pool = &pool, .n = 22 };
+    TaskGroup group = task_group_new(&pool);
+    task_group_spawn(&group, thread_pool_test_fibonacci, &root);
+    task_group_wait(&group);
+    TEST_ASSERT(root.result == 17711);
+
+    thread_pool_stop(&pool);
+}
+
+typedef struct {
+    ThreadPool *pool;
+    u8 *visits;
+    u64 bad_calls;
+} ParallelForTest;
+
+static void thread_pool_test_visit(usize start, usize end, void *context) {
+    ParallelForTest *test = (ParallelForTest *)context;
+    if (start >= end) __atomic_add_fetch(&test->bad_calls, 1, __ATOMIC_RELAXED);
+    // Tasks only ever run on the workers or the calling thread.
+    i32 index = thread_pool_worker_index(test->pool);
+    if (index >= (i32)thread_pool_worker_count(test->pool)) {
+        __atomic_add_fetch(&test->bad_calls, 1, __ATOMIC_RELAXED);
+    }
+    for (usize i = start; i < end; i++) {
+        __atomic_add_fetch(&test->visits[i], 1, __ATOMIC_RELAXED);
+    }
+}
+
+TEST(parallel_for_covers_range) {
+    ThreadPool pool;
+    thread_pool_start(&pool, THREAD_POOL_TEST_WORKERS, &heap_allocator);
+
+    usize lengths[] = { 1, 7, 1000, 100003 };
+    usize grains[] = { 0, 1, 3, 64, 1000000 };
+    for (usize l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (usize g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+            usize length = lengths[l];
+            ParallelForTest test = {
+                .pool = &pool,
+                .visits = (u8 *)heap_allocator.alloc(&heap_allocator, length + 10)
+            };
+            parallel_for(&pool, 10, length + 10, grains[g], thread_pool_test_visit, &test);
+
+            bool exact = test.bad_calls == 0;
+            for (usize i = 0; i < length + 10; i++) {
+                if (test.visits[i] != (i >= 10)) exact = false;
+            }
+            TEST_ASSERT(exact);
+            heap_allocator.free(&heap_allocator, test.visits);
+        }
+    }
+
+    ParallelForTest empty = { .pool = &pool };
+    parallel_for(&pool, 5, 5, 1, thread_pool_test_visit, &empty);
+    TEST_ASSERT(empty.bad_calls == 0);
+
+    thread_pool_stop(&pool);
+}
+
+typedef struct {
+    u64 sum;
+    u64 max;
+    usize count;
+} ReduceTestPartial;
+
+// Squares each index into a scratch buffer first, so tasks allocate as they go.
+static void thread_pool_test_reduce(usize start, usize end, void *partial, void *context) {
+    ReduceTestPartial *result = (ReduceTestPartial *)partial;
+    Scratch scratch = scratch_begin(NULL, 0);
+    u64 *squares = (u64 *)arena_alloc_uninit(scratch.arena, sizeof(u64) * (end - start));
+    for (usize i = start; i < end; i++) {
+        squares[i - start] = (u64)i * i;
+    }
+    for (usize i = 0; i < end - start; i++) {
+        result->sum += squares[i];
+        if (squares[i] > result->max) result->max = squares[i];
+    }
+    result->count += end - start;
+    scratch_end(scratch);
+    (void)context;
+}
+
+static void thread_pool_test_combine(void *result, const void *partial, void *context) {
+    ReduceTestPartial *into = (ReduceTestPartial *)result;
+    const ReduceTestPartial *from = (const ReduceTestPartial *)partial;
+    into->sum += from->sum;
+    if (from->max > into->max) into->max = from->max;
+    into->count += from->count;
+    (void)context;
+}
+
+TEST(parallel_reduce) {
+    ThreadPool pool;
+    thread_pool_start(&pool, THREAD_POOL_TEST_WORKERS, &heap_allocator);
+
+    usize grains[] = { 0, 1, 997, 1 << 20 };
+    for (usize g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+        ReduceTestPartial result = {0};
+        parallel_reduce(&pool, 0, 100000, grains[g], &result, sizeof(result),
+                        thread_pool_test_reduce, thread_pool_test_combine, NULL);
+        u64 n = 99999;
+        TEST_ASSERT(result.sum == n * (n + 1) * (2 * n + 1) / 6);
+        TEST_ASSERT(result.max == n * n);
+        TEST_ASSERT(result.count == 100000);
+    }
+
+    thread_pool_stop(&pool);
+}